@@ -0,0 +1,189 @@
+// Stress test for ConcurrentPool, meant to run under ThreadSanitizer
+// (configure with -DRUTHEN_STRESS_TSAN=ON). Worker threads allocate blocks,
+// stamp them, keep some, free some locally and hand the rest to the next
+// worker, which checks the stamp and frees them. Workers are restarted
+// every round so thread exit and slot reuse are exercised as well. A pool
+// smaller than the demand keeps it running out. Every block is marked in
+// use while held, a block handed out twice fails the run, and after the
+// last round every block must be allocatable again.
+//
+// usage: ruthenium_testing_ground-stress-concurrent-pool [threads] [rounds] [operations]
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "allocators/concurrent_pool.h"
+
+namespace
+{
+
+using namespace ruthen::memory;
+
+constexpr std::size_t kBlockSize = 64;
+constexpr std::size_t kKeptBlocks = 64;
+
+typedef ConcurrentPool<kBlockSize> Pool;
+
+struct Stamp
+{
+  std::uint64_t thread;
+  std::uint64_t sequence;
+};
+
+struct Inbox
+{
+  std::mutex mutex;
+  std::vector<void*> blocks;
+};
+
+class Stress
+{
+public:
+  Stress(std::size_t block_count, bool deferred, std::size_t threads) :
+    pool_{block_count, deferred},
+    in_use_(block_count),
+    inboxes_(threads),
+    failures_{0},
+    first_{pool_.Allocate(kBlockSize)}
+  {
+    // A fresh pool starts at its first block, which gives the indices
+    pool_.Free(first_, kBlockSize);
+  }
+
+public:
+  void Round(std::size_t round, std::size_t operations) {
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < inboxes_.size(); ++i) {
+      workers.emplace_back([this, round, operations, i] { Work(round * inboxes_.size() + i, i, operations); });
+    }
+    for (std::thread& worker : workers) worker.join();
+  }
+
+  // Frees what is left in the inboxes, then takes every block once
+  bool Finish() {
+    for (Inbox& inbox : inboxes_) {
+      for (void* pointer : inbox.blocks) Release(pointer);
+      inbox.blocks.clear();
+    }
+    pool_.FlushThreadCache();
+    std::size_t count = 0;
+    std::vector<void*> all;
+    while (void* pointer = Acquire(0, count)) {
+      all.push_back(pointer);
+      ++count;
+    }
+    for (void* pointer : all) Release(pointer);
+    if (count != pool_.BlockCount()) {
+      std::cerr << "recovered " << count << " of " << pool_.BlockCount() << " blocks\n";
+      failures_.fetch_add(1);
+    }
+    return failures_.load() == 0;
+  }
+
+private:
+  void Work(std::size_t thread, std::size_t index, std::size_t operations) {
+    std::mt19937 random{static_cast<std::uint32_t>(thread + 1)};
+    std::vector<void*> kept;
+    Inbox& next = inboxes_[(index + 1) % inboxes_.size()];
+    Inbox& own = inboxes_[index];
+    for (std::size_t i = 0; i < operations; ++i) {
+      std::uint32_t action = random() % 8;
+      if (action < 4) {
+        void* pointer = Acquire(thread, i);
+        if (pointer == nullptr) continue;
+        if (kept.size() < kKeptBlocks) kept.push_back(pointer);
+        else {
+          std::lock_guard<std::mutex> lock{next.mutex};
+          next.blocks.push_back(pointer);
+        }
+      }
+      else if (action < 6 && !kept.empty()) {
+        std::size_t pick = random() % kept.size();
+        Release(kept[pick]);
+        kept[pick] = kept.back();
+        kept.pop_back();
+      }
+      else {
+        std::vector<void*> received;
+        {
+          std::lock_guard<std::mutex> lock{own.mutex};
+          received.swap(own.blocks);
+        }
+        for (void* pointer : received) Release(pointer);
+      }
+    }
+    for (void* pointer : kept) Release(pointer);
+  }
+
+  void* Acquire(std::size_t thread, std::size_t sequence) {
+    void* pointer = pool_.Allocate(kBlockSize);
+    if (pointer == nullptr) return nullptr;
+    if (!pool_.Owns(pointer) || in_use_[Index(pointer)].exchange(true, std::memory_order_relaxed)) {
+      std::cerr << "block " << pointer << " handed out twice\n";
+      failures_.fetch_add(1);
+      return nullptr;
+    }
+    Stamp stamp{thread, sequence};
+    std::memcpy(pointer, &stamp, sizeof(stamp));
+    std::memset(static_cast<unsigned char*>(pointer) + sizeof(stamp), static_cast<int>(thread), kBlockSize - sizeof(stamp));
+    return pointer;
+  }
+
+  void Release(void* pointer) {
+    Stamp stamp;
+    std::memcpy(&stamp, pointer, sizeof(stamp));
+    unsigned char fill = static_cast<unsigned char*>(pointer)[kBlockSize - 1];
+    if (fill != static_cast<unsigned char>(stamp.thread)) {
+      std::cerr << "block " << pointer << " overwritten while in use\n";
+      failures_.fetch_add(1);
+    }
+    if (!in_use_[Index(pointer)].exchange(false, std::memory_order_relaxed)) {
+      std::cerr << "block " << pointer << " freed twice\n";
+      failures_.fetch_add(1);
+    }
+    pool_.Free(pointer, kBlockSize);
+  }
+
+  std::size_t Index(void* pointer) const {
+    return static_cast<std::size_t>(static_cast<unsigned char*>(pointer) - static_cast<unsigned char*>(first_)) / kBlockSize;
+  }
+
+private:
+  Pool pool_;
+  std::vector<std::atomic<bool>> in_use_;
+  std::vector<Inbox> inboxes_;
+  std::atomic<std::size_t> failures_;
+  void* first_;
+};
+
+bool Run(std::size_t threads, std::size_t rounds, std::size_t operations, bool deferred) {
+  // Less than the workers could hold at once, allocations fail regularly
+  std::size_t block_count = threads * kKeptBlocks;
+  Stress stress{block_count, deferred, threads};
+  for (std::size_t round = 0; round < rounds; ++round) stress.Round(round, operations);
+  return stress.Finish();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8;
+  std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+  std::size_t operations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000;
+  bool passed = true;
+  for (bool deferred : {false, true}) {
+    bool result = Run(threads, rounds, operations, deferred);
+    std::cout << (deferred ? "deferred" : "shared") << ": " << (result ? "passed" : "FAILED") << '\n';
+    passed = passed && result;
+  }
+  return passed ? 0 : 1;
+}
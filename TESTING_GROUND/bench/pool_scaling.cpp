@@ -0,0 +1,89 @@
+// Cost of PoolAllocator operations as the pool grows. Each pool is filled
+// to half its size with randomly freed holes, then a live allocation is
+// freed and a new one of the same size made in a loop. Single blocks should
+// cost the same at every size, runs are found by a word scan from the start
+// of the pool.
+//
+// usage: ruthenium_testing_ground-bench-pool [max blocks]
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "memory/pool_allocator.h"
+
+namespace
+{
+
+using namespace ruthen::memory;
+
+constexpr std::size_t kBlockSize = 32;
+constexpr std::size_t kOperations = 1000000;
+constexpr std::size_t kRunBlocks = 4;
+
+typedef PoolAllocator<kBlockSize> Pool;
+
+struct Live
+{
+  void* pointer;
+  std::size_t size;
+};
+
+// Half full, with the free blocks scattered over the whole pool
+std::vector<Live> Fill(Pool& pool, std::mt19937_64& random, std::size_t size) {
+  std::vector<Live> live;
+  std::size_t count = pool.BlockCount() * kBlockSize / size;
+  live.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    live.push_back(Live{pool.Allocate(size), size});
+  }
+  for (std::size_t i = 0; i < count / 2; ++i) {
+    std::size_t index = random() % live.size();
+    pool.Free(live[index].pointer, live[index].size);
+    live[index] = live.back();
+    live.pop_back();
+  }
+  return live;
+}
+
+double Churn(Pool& pool, std::vector<Live>& live, std::mt19937_64& random, std::size_t size) {
+  std::vector<std::size_t> picks(kOperations);
+  for (std::size_t& pick : picks) pick = random() % live.size();
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t pick : picks) {
+    pool.Free(live[pick].pointer, live[pick].size);
+    void* pointer = pool.Allocate(size);
+    if (pointer == nullptr) {
+      std::cerr << "pool exhausted\n";
+      std::exit(1);
+    }
+    live[pick] = Live{pointer, size};
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+  return elapsed.count() / static_cast<double>(kOperations);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t max_blocks = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  std::cout << std::setw(12) << "blocks" << std::setw(16) << "block ns/op" << std::setw(16) << "run ns/op" << '\n';
+  std::mt19937_64 random{42};
+  for (std::size_t blocks = 1000; blocks <= max_blocks; blocks *= 10) {
+    Pool pool{blocks};
+    std::vector<Live> live = Fill(pool, random, kBlockSize);
+    double single = Churn(pool, live, random, kBlockSize);
+    pool.Reset();
+    live = Fill(pool, random, kRunBlocks * kBlockSize);
+    double run = Churn(pool, live, random, kRunBlocks * kBlockSize);
+    std::cout << std::setw(12) << blocks << std::setw(16) << std::fixed << std::setprecision(1) << single
+              << std::setw(16) << run << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Throughput of a shared 64-byte pool as threads are added, a PoolAllocator
+// behind one mutex against ThreadCachedPool. Every thread keeps a small set
+// of live blocks and frees and allocates them in a loop.
+//
+// usage: ruthenium_testing_ground-bench-thread-cache [max threads] [batch size]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "memory/pool_allocator.h"
+#include "allocators/thread_cached_pool.h"
+
+namespace
+{
+
+using namespace ruthen::memory;
+
+constexpr std::size_t kBlockSize = 64;
+constexpr std::size_t kLiveBlocks = 256;
+constexpr std::size_t kOperations = 2000000;
+
+class LockedPool
+{
+public:
+  LockedPool(std::size_t block_count) : pool_{block_count}, mutex_{} {}
+
+  void* Allocate(std::size_t size_bytes) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return pool_.Allocate(size_bytes);
+  }
+
+  void Free(void* pointer, std::size_t size_bytes) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    pool_.Free(pointer, size_bytes);
+  }
+
+private:
+  PoolAllocator<kBlockSize> pool_;
+  std::mutex mutex_;
+};
+
+template<typename Pool>
+void Work(Pool& pool) {
+  std::vector<void*> live(kLiveBlocks);
+  for (void*& pointer : live) pointer = pool.Allocate(kBlockSize);
+  for (std::size_t i = 0; i < kOperations; ++i) {
+    void*& pointer = live[(i * 7) % kLiveBlocks];
+    pool.Free(pointer, kBlockSize);
+    pointer = pool.Allocate(kBlockSize);
+  }
+  for (void* pointer : live) pool.Free(pointer, kBlockSize);
+}
+
+// Millions of free and allocate pairs per second over all threads
+template<typename Pool>
+double Run(Pool& pool, std::size_t threads) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < threads; ++i) workers.emplace_back([&pool] { Work(pool); });
+  for (std::thread& worker : workers) worker.join();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(threads * kOperations) / elapsed.count() / 1e6;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  std::size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : hardware;
+  std::size_t batch_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : ThreadCachedPool<kBlockSize>::kDefaultBatchSize;
+  std::size_t block_count = max_threads * (kLiveBlocks + 4 * batch_size);
+  std::cout << "hardware threads " << hardware << ", batch size " << batch_size << '\n';
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "locked Mops/s" << std::setw(16) << "cached Mops/s" << '\n';
+  std::vector<std::size_t> counts;
+  for (std::size_t threads = 1; threads < max_threads; threads *= 2) counts.push_back(threads);
+  counts.push_back(max_threads);
+  for (std::size_t threads : counts) {
+    LockedPool locked{block_count};
+    ThreadCachedPool<kBlockSize> cached{block_count, batch_size};
+    double locked_rate = Run(locked, threads);
+    double cached_rate = Run(cached, threads);
+    std::cout << std::setw(8) << threads << std::setw(16) << std::fixed << std::setprecision(1) << locked_rate
+              << std::setw(16) << cached_rate << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,449 @@
+#ifndef RUTHEN_CONCURRENT_POOL_H
+#define RUTHEN_CONCURRENT_POOL_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "memory/memory_tracker.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+// Fixed-size block pool any thread may allocate from and free to without
+// locking. Free blocks form a Treiber stack of block indices whose head
+// carries a version bumped by every update, so a pop that raced with a
+// pop and push of the same block fails its CAS instead of corrupting the
+// list. Links live in an array of their own, a losing pop may read the
+// link of a block that is already in use. Blocks never handed out are
+// taken from a frontier.
+//
+// With deferred remote frees every thread owns a slot with a private free
+// list. A block remembers the slot that allocated it. Frees by the owner go
+// to its private list, frees by other threads are collected per thread and
+// pushed onto the owner's remote list kRemoteBatch at a time, where the
+// owner takes them all with one exchange once its private list is empty.
+// Threads past kMaxOwners, and all threads without deferral, use the
+// shared stack directly.
+//
+// An exiting thread returns its lists to the shared stack. Remote frees
+// reaching a slot after that wait there for the next thread to take the
+// slot, or for an allocation that finds the pool otherwise empty.
+template<std::size_t kBlockSize>
+class ConcurrentPool
+{
+public:
+  typedef std::uint32_t BlockIndex;
+  constexpr static BlockIndex kNoBlock = std::numeric_limits<BlockIndex>::max();
+  constexpr static std::size_t kMaxOwners = 64;
+  constexpr static std::size_t kRemoteBatch = 32;
+
+public:
+  explicit ConcurrentPool(std::size_t block_count, bool deferred_remote_frees = false, MemoryTag tag = GetCurrentMemoryTag());
+  ConcurrentPool(const ConcurrentPool& src) = delete;
+  ConcurrentPool& operator=(const ConcurrentPool& rhs) = delete;
+  ~ConcurrentPool();
+
+public:
+  // Returns nullptr for more than one block or when the pool is empty
+  [[nodiscard]] void* Allocate(std::size_t size_bytes);
+  void Free(void* pointer, std::size_t size_bytes);
+  // Pushes the calling thread's collected remote frees to their owners
+  void FlushThreadCache();
+
+public:
+  std::size_t BlockCount() const;
+  bool DefersRemoteFrees() const;
+  bool Owns(const void* pointer) const;
+
+private:
+  constexpr static std::uint8_t kNoOwner = std::numeric_limits<std::uint8_t>::max();
+
+  struct alignas(64) Owner
+  {
+    // Pushed to by other threads, emptied with an exchange
+    std::atomic<BlockIndex> remote_head{kNoBlock};
+    std::atomic<bool> in_use{false};
+    // Touched by the owning thread only
+    alignas(64) BlockIndex local_head = kNoBlock;
+  };
+
+  struct ThreadState
+  {
+    std::uint64_t pool_id;
+    // Guarded by RegistryMutex(), cleared when the pool goes away
+    ConcurrentPool* pool;
+    std::uint8_t slot;
+    // Remote frees collected for one owner, linked like the free lists
+    std::uint8_t pending_owner;
+    BlockIndex pending_head;
+    BlockIndex pending_tail;
+    std::size_t pending_count;
+  };
+
+  struct ThreadCache
+  {
+    ~ThreadCache();
+
+    std::uint64_t last_id = 0;
+    ThreadState* last = nullptr;
+    std::vector<std::shared_ptr<ThreadState>> states;
+  };
+
+private:
+  void* AllocateDeferred();
+  void FreeDeferred(BlockIndex index);
+  BlockIndex PopShared();
+  void PushShared(BlockIndex first, BlockIndex last);
+  void PushRemote(Owner& owner, BlockIndex first, BlockIndex last);
+  BlockIndex StealRemote();
+  void FlushPending(ThreadState& state);
+  void Detach(ThreadState& state);
+  BlockIndex GetTail(BlockIndex first) const;
+
+private:
+  ThreadState& GetState();
+  ThreadState& AddState(ThreadCache& cache);
+  std::uint8_t AcquireSlot();
+  void* GetBlock(BlockIndex index) const;
+  BlockIndex GetIndex(const void* pointer) const;
+
+private:
+  static std::uint64_t Pack(BlockIndex index, std::uint32_t version);
+  static BlockIndex GetHeadIndex(std::uint64_t head);
+  static std::uint32_t GetHeadVersion(std::uint64_t head);
+  static std::mutex& RegistryMutex();
+  static ThreadCache& GetThreadCache();
+  static std::uint64_t NextID();
+
+private:
+  std::size_t block_count_;
+  bool deferred_;
+  MemoryTag tag_;
+  std::uint64_t id_;
+  unsigned char* data_;
+  std::unique_ptr<std::atomic<BlockIndex>[]> links_;
+  // Slot that allocated each block, kNoOwner for the shared stack
+  std::unique_ptr<std::uint8_t[]> owners_of_;
+  alignas(64) std::atomic<std::uint64_t> head_;
+  alignas(64) std::atomic<std::size_t> frontier_;
+  std::array<Owner, kMaxOwners> owners_;
+  // Guarded by RegistryMutex()
+  std::vector<std::shared_ptr<ThreadState>> states_;
+};
+
+template<std::size_t kBlockSize>
+ConcurrentPool<kBlockSize>::ConcurrentPool(std::size_t block_count, bool deferred_remote_frees, MemoryTag tag) :
+  block_count_{block_count},
+  deferred_{deferred_remote_frees},
+  tag_{tag},
+  id_{NextID()},
+  data_{nullptr},
+  links_{},
+  owners_of_{},
+  head_{Pack(kNoBlock, 0)},
+  frontier_{0},
+  owners_{},
+  states_{}
+{
+  if (block_count >= kNoBlock) throw std::length_error{"pool block count out of range"};
+  data_ = static_cast<unsigned char*>(std::malloc(block_count * kBlockSize));
+  if (data_ == nullptr) throw std::bad_alloc{};
+  links_ = std::make_unique<std::atomic<BlockIndex>[]>(block_count);
+  owners_of_ = std::make_unique<std::uint8_t[]>(block_count);
+  TrackAllocation(tag_, block_count * (kBlockSize + sizeof(BlockIndex) + 1));
+}
+
+template<std::size_t kBlockSize>
+ConcurrentPool<kBlockSize>::~ConcurrentPool() {
+  {
+    std::lock_guard<std::mutex> lock{RegistryMutex()};
+    for (const std::shared_ptr<ThreadState>& state : states_) {
+      state->pool = nullptr;
+    }
+  }
+  TrackFree(tag_, block_count_ * (kBlockSize + sizeof(BlockIndex) + 1));
+  std::free(data_);
+}
+
+template<std::size_t kBlockSize>
+void* ConcurrentPool<kBlockSize>::Allocate(std::size_t size_bytes) {
+  if (size_bytes > kBlockSize) return nullptr;
+  if (deferred_) return AllocateDeferred();
+  BlockIndex index = PopShared();
+  return index != kNoBlock ? GetBlock(index) : nullptr;
+}
+
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::Free(void* pointer, std::size_t) {
+  if (pointer == nullptr) return;
+  BlockIndex index = GetIndex(pointer);
+  if (deferred_) FreeDeferred(index);
+  else PushShared(index, index);
+}
+
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::FlushThreadCache() {
+  if (deferred_) FlushPending(GetState());
+}
+
+template<std::size_t kBlockSize>
+std::size_t ConcurrentPool<kBlockSize>::BlockCount() const {
+  return block_count_;
+}
+
+template<std::size_t kBlockSize>
+bool ConcurrentPool<kBlockSize>::DefersRemoteFrees() const {
+  return deferred_;
+}
+
+template<std::size_t kBlockSize>
+bool ConcurrentPool<kBlockSize>::Owns(const void* pointer) const {
+  std::uintptr_t start = reinterpret_cast<std::uintptr_t>(data_);
+  std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+  if (address < start || address >= start + block_count_ * kBlockSize) return false;
+  return (address - start) % kBlockSize == 0;
+}
+
+// Private list first, then everything other threads handed back, then the
+// shared stack
+template<std::size_t kBlockSize>
+void* ConcurrentPool<kBlockSize>::AllocateDeferred() {
+  ThreadState& state = GetState();
+  if (state.slot == kNoOwner) {
+    BlockIndex index = PopShared();
+    if (index == kNoBlock) return nullptr;
+    owners_of_[index] = kNoOwner;
+    return GetBlock(index);
+  }
+  Owner& owner = owners_[state.slot];
+  if (owner.local_head == kNoBlock) owner.local_head = owner.remote_head.exchange(kNoBlock, std::memory_order_acquire);
+  BlockIndex index = owner.local_head;
+  if (index != kNoBlock) owner.local_head = links_[index].load(std::memory_order_relaxed);
+  else {
+    index = PopShared();
+    if (index == kNoBlock) {
+      index = StealRemote();
+      if (index == kNoBlock) return nullptr;
+      // A stolen list beyond its first block becomes the private one
+      owner.local_head = links_[index].load(std::memory_order_relaxed);
+    }
+  }
+  owners_of_[index] = state.slot;
+  return GetBlock(index);
+}
+
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::FreeDeferred(BlockIndex index) {
+  std::uint8_t owner = owners_of_[index];
+  if (owner == kNoOwner) {
+    PushShared(index, index);
+    return;
+  }
+  ThreadState& state = GetState();
+  if (owner == state.slot) {
+    links_[index].store(owners_[owner].local_head, std::memory_order_relaxed);
+    owners_[owner].local_head = index;
+    return;
+  }
+  if (state.pending_count > 0 && state.pending_owner != owner) FlushPending(state);
+  if (state.pending_count == 0) {
+    state.pending_owner = owner;
+    state.pending_tail = index;
+  }
+  links_[index].store(state.pending_head, std::memory_order_relaxed);
+  state.pending_head = index;
+  if (++state.pending_count == kRemoteBatch) FlushPending(state);
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::BlockIndex ConcurrentPool<kBlockSize>::PopShared() {
+  std::uint64_t head = head_.load(std::memory_order_acquire);
+  while (GetHeadIndex(head) != kNoBlock) {
+    BlockIndex next = links_[GetHeadIndex(head)].load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, Pack(next, GetHeadVersion(head) + 1), std::memory_order_acquire, std::memory_order_acquire)) {
+      return GetHeadIndex(head);
+    }
+  }
+  if (frontier_.load(std::memory_order_relaxed) >= block_count_) return kNoBlock;
+  std::size_t index = frontier_.fetch_add(1, std::memory_order_relaxed);
+  return index < block_count_ ? static_cast<BlockIndex>(index) : kNoBlock;
+}
+
+// The chain from first to last is already linked
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::PushShared(BlockIndex first, BlockIndex last) {
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    links_[last].store(GetHeadIndex(head), std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(head, Pack(first, GetHeadVersion(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
+
+// Only pushes and whole-list exchanges touch a remote list, so it needs no version
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::PushRemote(Owner& owner, BlockIndex first, BlockIndex last) {
+  BlockIndex head = owner.remote_head.load(std::memory_order_relaxed);
+  do {
+    links_[last].store(head, std::memory_order_relaxed);
+  } while (!owner.remote_head.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::BlockIndex ConcurrentPool<kBlockSize>::StealRemote() {
+  for (Owner& owner : owners_) {
+    if (owner.remote_head.load(std::memory_order_relaxed) == kNoBlock) continue;
+    BlockIndex index = owner.remote_head.exchange(kNoBlock, std::memory_order_acquire);
+    if (index != kNoBlock) return index;
+  }
+  return kNoBlock;
+}
+
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::FlushPending(ThreadState& state) {
+  if (state.pending_count == 0) return;
+  PushRemote(owners_[state.pending_owner], state.pending_head, state.pending_tail);
+  state.pending_head = kNoBlock;
+  state.pending_tail = kNoBlock;
+  state.pending_count = 0;
+}
+
+template<std::size_t kBlockSize>
+void ConcurrentPool<kBlockSize>::Detach(ThreadState& state) {
+  FlushPending(state);
+  if (state.slot == kNoOwner) return;
+  Owner& owner = owners_[state.slot];
+  if (owner.local_head != kNoBlock) PushShared(owner.local_head, GetTail(owner.local_head));
+  owner.local_head = kNoBlock;
+  BlockIndex remote = owner.remote_head.exchange(kNoBlock, std::memory_order_acquire);
+  if (remote != kNoBlock) PushShared(remote, GetTail(remote));
+  owner.in_use.store(false, std::memory_order_release);
+  state.slot = kNoOwner;
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::BlockIndex ConcurrentPool<kBlockSize>::GetTail(BlockIndex first) const {
+  BlockIndex tail = first;
+  for (BlockIndex next = links_[tail].load(std::memory_order_relaxed); next != kNoBlock; next = links_[tail].load(std::memory_order_relaxed)) {
+    tail = next;
+  }
+  return tail;
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::ThreadState& ConcurrentPool<kBlockSize>::GetState() {
+  ThreadCache& cache = GetThreadCache();
+  if (cache.last_id == id_) return *cache.last;
+  ThreadState* found = nullptr;
+  for (const std::shared_ptr<ThreadState>& state : cache.states) {
+    if (state->pool_id == id_) found = state.get();
+  }
+  if (found == nullptr) found = &AddState(cache);
+  cache.last_id = id_;
+  cache.last = found;
+  return *found;
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::ThreadState& ConcurrentPool<kBlockSize>::AddState(ThreadCache& cache) {
+  std::shared_ptr<ThreadState> state{new ThreadState{id_, this, AcquireSlot(), kNoOwner, kNoBlock, kNoBlock, 0}};
+  std::lock_guard<std::mutex> lock{RegistryMutex()};
+  // Pool IDs are never reused, states of destroyed pools can only be dropped
+  std::vector<std::shared_ptr<ThreadState>>& states = cache.states;
+  for (std::size_t i = 0; i < states.size();) {
+    if (states[i]->pool != nullptr) ++i;
+    else {
+      states[i] = states.back();
+      states.pop_back();
+    }
+  }
+  states.push_back(state);
+  states_.push_back(state);
+  return *state;
+}
+
+template<std::size_t kBlockSize>
+std::uint8_t ConcurrentPool<kBlockSize>::AcquireSlot() {
+  if (!deferred_) return kNoOwner;
+  for (std::size_t i = 0; i < owners_.size(); ++i) {
+    bool in_use = false;
+    if (owners_[i].in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) return static_cast<std::uint8_t>(i);
+  }
+  return kNoOwner;
+}
+
+template<std::size_t kBlockSize>
+void* ConcurrentPool<kBlockSize>::GetBlock(BlockIndex index) const {
+  return data_ + static_cast<std::size_t>(index) * kBlockSize;
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::BlockIndex ConcurrentPool<kBlockSize>::GetIndex(const void* pointer) const {
+  return static_cast<BlockIndex>((static_cast<const unsigned char*>(pointer) - data_) / kBlockSize);
+}
+
+template<std::size_t kBlockSize>
+std::uint64_t ConcurrentPool<kBlockSize>::Pack(BlockIndex index, std::uint32_t version) {
+  return static_cast<std::uint64_t>(version) << 32 | index;
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::BlockIndex ConcurrentPool<kBlockSize>::GetHeadIndex(std::uint64_t head) {
+  return static_cast<BlockIndex>(head);
+}
+
+template<std::size_t kBlockSize>
+std::uint32_t ConcurrentPool<kBlockSize>::GetHeadVersion(std::uint64_t head) {
+  return static_cast<std::uint32_t>(head >> 32);
+}
+
+template<std::size_t kBlockSize>
+ConcurrentPool<kBlockSize>::ThreadCache::~ThreadCache() {
+  std::lock_guard<std::mutex> lock{RegistryMutex()};
+  for (const std::shared_ptr<ThreadState>& state : states) {
+    ConcurrentPool* pool = state->pool;
+    if (pool == nullptr) continue;
+    pool->Detach(*state);
+    std::vector<std::shared_ptr<ThreadState>>& owned = pool->states_;
+    for (std::size_t i = 0; i < owned.size(); ++i) {
+      if (owned[i] != state) continue;
+      owned[i] = owned.back();
+      owned.pop_back();
+      break;
+    }
+  }
+}
+
+template<std::size_t kBlockSize>
+std::mutex& ConcurrentPool<kBlockSize>::RegistryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+template<std::size_t kBlockSize>
+typename ConcurrentPool<kBlockSize>::ThreadCache& ConcurrentPool<kBlockSize>::GetThreadCache() {
+  thread_local ThreadCache cache;
+  return cache;
+}
+
+template<std::size_t kBlockSize>
+std::uint64_t ConcurrentPool<kBlockSize>::NextID() {
+  static std::atomic<std::uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef RUTHEN_THREAD_CACHED_POOL_H
+#define RUTHEN_THREAD_CACHED_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "memory/pool_allocator.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+// PoolAllocator shared between threads. Every thread keeps a magazine of
+// free blocks per pool and serves single blocks from it without locking.
+// An empty magazine takes batch_size blocks from the shared pool, a full
+// one (twice the batch) gives batch_size back, both under one lock. A block
+// may be freed on any thread, it simply lands in that thread's magazine.
+// Runs larger than one block always go through the shared pool.
+//
+// Magazines of exited threads are returned to the pool, magazines still
+// held by threads when the pool is destroyed are dropped.
+template<std::size_t kBlockSize>
+class ThreadCachedPool
+{
+public:
+  constexpr static std::size_t kDefaultBatchSize = 32;
+
+public:
+  ThreadCachedPool(std::size_t block_count, std::size_t batch_size = kDefaultBatchSize);
+  ThreadCachedPool(const ThreadCachedPool& src) = delete;
+  ThreadCachedPool& operator=(const ThreadCachedPool& rhs) = delete;
+  ~ThreadCachedPool();
+
+public:
+  [[nodiscard]] void* Allocate(std::size_t size_bytes);
+  void Free(void* pointer, std::size_t size_bytes);
+  // Returns the calling thread's cached blocks to the shared pool
+  void FlushThreadCache();
+
+public:
+  std::size_t BlockCount() const;
+  std::size_t GetBatchSize() const;
+  // Blocks handed out by the shared pool, including the ones sitting in magazines
+  std::size_t UsedCount() const;
+
+private:
+  struct Magazine
+  {
+    std::uint64_t pool_id;
+    // Guarded by RegistryMutex(), cleared when the pool goes away
+    ThreadCachedPool* owner;
+    std::vector<void*> blocks;
+    std::size_t count;
+  };
+
+  struct ThreadCache
+  {
+    ~ThreadCache();
+
+    std::uint64_t last_id = 0;
+    Magazine* last = nullptr;
+    std::vector<std::shared_ptr<Magazine>> magazines;
+  };
+
+private:
+  Magazine& GetMagazine();
+  Magazine& AddMagazine(ThreadCache& cache);
+  void Refill(Magazine& magazine);
+  void Drain(Magazine& magazine, std::size_t count);
+
+private:
+  static std::mutex& RegistryMutex();
+  static ThreadCache& GetThreadCache();
+  static std::uint64_t NextID();
+
+private:
+  PoolAllocator<kBlockSize> pool_;
+  mutable std::mutex mutex_;
+  std::size_t batch_size_;
+  std::uint64_t id_;
+  // Guarded by RegistryMutex()
+  std::vector<std::shared_ptr<Magazine>> magazines_;
+};
+
+template<std::size_t kBlockSize>
+ThreadCachedPool<kBlockSize>::ThreadCachedPool(std::size_t block_count, std::size_t batch_size) :
+  pool_{block_count},
+  mutex_{},
+  batch_size_{batch_size > 0 ? batch_size : 1},
+  id_{NextID()},
+  magazines_{}
+{}
+
+template<std::size_t kBlockSize>
+ThreadCachedPool<kBlockSize>::~ThreadCachedPool() {
+  std::lock_guard<std::mutex> lock{RegistryMutex()};
+  for (const std::shared_ptr<Magazine>& magazine : magazines_) {
+    magazine->owner = nullptr;
+  }
+}
+
+template<std::size_t kBlockSize>
+void* ThreadCachedPool<kBlockSize>::Allocate(std::size_t size_bytes) {
+  if (size_bytes > kBlockSize) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return pool_.Allocate(size_bytes);
+  }
+  Magazine& magazine = GetMagazine();
+  if (magazine.count == 0) Refill(magazine);
+  if (magazine.count == 0) return nullptr;
+  return magazine.blocks[--magazine.count];
+}
+
+template<std::size_t kBlockSize>
+void ThreadCachedPool<kBlockSize>::Free(void* pointer, std::size_t size_bytes) {
+  if (pointer == nullptr) return;
+  if (size_bytes > kBlockSize) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    pool_.Free(pointer, size_bytes);
+    return;
+  }
+  Magazine& magazine = GetMagazine();
+  if (magazine.count == magazine.blocks.size()) Drain(magazine, batch_size_);
+  magazine.blocks[magazine.count++] = pointer;
+}
+
+template<std::size_t kBlockSize>
+void ThreadCachedPool<kBlockSize>::FlushThreadCache() {
+  Magazine& magazine = GetMagazine();
+  Drain(magazine, magazine.count);
+}
+
+template<std::size_t kBlockSize>
+std::size_t ThreadCachedPool<kBlockSize>::BlockCount() const {
+  return pool_.BlockCount();
+}
+
+template<std::size_t kBlockSize>
+std::size_t ThreadCachedPool<kBlockSize>::GetBatchSize() const {
+  return batch_size_;
+}
+
+template<std::size_t kBlockSize>
+std::size_t ThreadCachedPool<kBlockSize>::UsedCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return pool_.UsedCount();
+}
+
+template<std::size_t kBlockSize>
+typename ThreadCachedPool<kBlockSize>::Magazine& ThreadCachedPool<kBlockSize>::GetMagazine() {
+  ThreadCache& cache = GetThreadCache();
+  if (cache.last_id == id_) return *cache.last;
+  Magazine* found = nullptr;
+  for (const std::shared_ptr<Magazine>& magazine : cache.magazines) {
+    if (magazine->pool_id == id_) found = magazine.get();
+  }
+  if (found == nullptr) found = &AddMagazine(cache);
+  cache.last_id = id_;
+  cache.last = found;
+  return *found;
+}
+
+template<std::size_t kBlockSize>
+typename ThreadCachedPool<kBlockSize>::Magazine& ThreadCachedPool<kBlockSize>::AddMagazine(ThreadCache& cache) {
+  std::shared_ptr<Magazine> magazine{new Magazine{id_, this, std::vector<void*>(2 * batch_size_), 0}};
+  std::lock_guard<std::mutex> lock{RegistryMutex()};
+  // Pool IDs are never reused, magazines of destroyed pools can only be dropped
+  std::vector<std::shared_ptr<Magazine>>& magazines = cache.magazines;
+  for (std::size_t i = 0; i < magazines.size();) {
+    if (magazines[i]->owner != nullptr) ++i;
+    else {
+      magazines[i] = magazines.back();
+      magazines.pop_back();
+    }
+  }
+  magazines.push_back(magazine);
+  magazines_.push_back(magazine);
+  return *magazine;
+}
+
+template<std::size_t kBlockSize>
+void ThreadCachedPool<kBlockSize>::Refill(Magazine& magazine) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  while (magazine.count < batch_size_) {
+    void* pointer = pool_.Allocate(kBlockSize);
+    if (pointer == nullptr) break;
+    magazine.blocks[magazine.count++] = pointer;
+  }
+}
+
+template<std::size_t kBlockSize>
+void ThreadCachedPool<kBlockSize>::Drain(Magazine& magazine, std::size_t count) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  for (; count > 0 && magazine.count > 0; --count) {
+    pool_.Free(magazine.blocks[--magazine.count], kBlockSize);
+  }
+}
+
+template<std::size_t kBlockSize>
+ThreadCachedPool<kBlockSize>::ThreadCache::~ThreadCache() {
+  std::lock_guard<std::mutex> lock{RegistryMutex()};
+  for (const std::shared_ptr<Magazine>& magazine : magazines) {
+    ThreadCachedPool* owner = magazine->owner;
+    if (owner == nullptr) continue;
+    owner->Drain(*magazine, magazine->count);
+    std::vector<std::shared_ptr<Magazine>>& owned = owner->magazines_;
+    for (std::size_t i = 0; i < owned.size(); ++i) {
+      if (owned[i] != magazine) continue;
+      owned[i] = owned.back();
+      owned.pop_back();
+      break;
+    }
+  }
+}
+
+template<std::size_t kBlockSize>
+std::mutex& ThreadCachedPool<kBlockSize>::RegistryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+template<std::size_t kBlockSize>
+typename ThreadCachedPool<kBlockSize>::ThreadCache& ThreadCachedPool<kBlockSize>::GetThreadCache() {
+  thread_local ThreadCache cache;
+  return cache;
+}
+
+template<std::size_t kBlockSize>
+std::uint64_t ThreadCachedPool<kBlockSize>::NextID() {
+  static std::atomic<std::uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
+}
+
+#endif
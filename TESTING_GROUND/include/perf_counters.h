@@ -0,0 +1,76 @@
+#ifndef RUTHEN_PERF_COUNTERS_H
+#define RUTHEN_PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ruthen
+{
+
+// Hardware cache references and misses of the calling thread and the
+// threads it starts afterwards, through perf_event_open. Unavailable
+// when the kernel or perf_event_paranoid refuses the counters, as in most
+// containers and virtual machines.
+class CacheCounters
+{
+public:
+  CacheCounters() : fds_{Open(PERF_COUNT_HW_CACHE_REFERENCES), Open(PERF_COUNT_HW_CACHE_MISSES)}, start_{}, values_{} {}
+  CacheCounters(const CacheCounters&) = delete;
+  CacheCounters& operator=(const CacheCounters&) = delete;
+  ~CacheCounters() {
+    for (int fd : fds_) if (fd >= 0) ::close(fd);
+  }
+
+public:
+  bool Available() const { return fds_[0] >= 0 && fds_[1] >= 0; }
+
+  // The counters run from construction on. Counts of exited child threads
+  // are folded in without regard to PERF_EVENT_IOC_RESET, so a measurement
+  // is the difference of two reads.
+  void Start() { start_ = Read(); }
+
+  void Stop() {
+    std::array<std::uint64_t, 2> now = Read();
+    for (std::size_t i = 0; i < values_.size(); ++i) values_[i] = now[i] - start_[i];
+  }
+
+  std::uint64_t References() const { return values_[0]; }
+  std::uint64_t Misses() const { return values_[1]; }
+
+private:
+  std::array<std::uint64_t, 2> Read() const {
+    std::array<std::uint64_t, 2> values{};
+    for (std::size_t i = 0; i < fds_.size(); ++i) {
+      if (fds_[i] < 0 || ::read(fds_[i], &values[i], sizeof(values[i])) != sizeof(values[i])) values[i] = 0;
+    }
+    return values;
+  }
+
+  static int Open(std::uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+private:
+  std::array<int, 2> fds_;
+  std::array<std::uint64_t, 2> start_;
+  std::array<std::uint64_t, 2> values_;
+};
+
+}
+
+#endif
@@ -1,12 +1,461 @@
-#include "allocators/linear_allocator.h"
-#include "allocators/pool_allocator.h"
+// Allocator benchmark suite. Runs LinearAllocator, PoolAllocator and its
+// thread-safe variants, StackAllocator and glibc malloc through the
+// patterns the engine produces:
+//   churn          small objects freed and replaced at random, and the same
+//                  per thread as threads are added
+//   frame          a burst of allocations every frame, dropped at its end
+//   producer       blocks allocated on one thread and freed on another
+//   fragmentation  long-lived objects interleaved with short-lived ones of
+//                  widely mixed sizes
+// An allocator only runs the patterns it supports. Every result carries
+// ns/op, the resident memory the pattern added and, where perf_event_open
+// is allowed, cache references and misses. Prints JSON on stdout.
+//
+// usage: ruthenium_testing_ground [--iterations N] [--threads N] [--filter name]
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
-#include <limits>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+#include <unistd.h>
+
+#include "memory/linear_allocator.h"
+#include "memory/pool_allocator.h"
+#include "memory/stack_allocator.h"
+#include "allocators/concurrent_pool.h"
+#include "allocators/thread_cached_pool.h"
+#include "perf_counters.h"
+
+namespace
+{
+
+using namespace ruthen;
 using namespace ruthen::memory;
 
-int main([[maybe_unused]]int argc, [[maybe_unused]]char** argv)
+constexpr std::size_t kSmallBlock = 64;
+constexpr std::size_t kFrameBlock = 256;
+constexpr std::size_t kChurnObjects = 4096;
+constexpr std::size_t kFrameObjects = 2000;
+constexpr std::size_t kFrameBytes = std::size_t{1} << 20;
+constexpr std::size_t kQueueCapacity = 1024;
+constexpr std::size_t kFragmentationObjects = 50000;
+constexpr std::size_t kFragmentationMaxSize = 1024;
+constexpr std::size_t kSizeCount = 1 << 16;
+
+struct Options
 {
+  std::size_t iterations = 1000000;
+  std::size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+  std::string filter;
+};
+
+// Accepts --iterations N, --threads N and --filter substring
+bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string_view argument{argv[i]};
+    if (i + 1 >= argc) return false;
+    if (argument == "--iterations") options.iterations = std::strtoull(argv[++i], nullptr, 10);
+    else if (argument == "--threads") options.max_threads = std::strtoull(argv[++i], nullptr, 10);
+    else if (argument == "--filter") options.filter = argv[++i];
+    else return false;
+  }
+  return options.iterations > 0 && options.max_threads > 0;
+}
+
+double ResidentBytes() {
+  std::ifstream statm{"/proc/self/statm"};
+  std::size_t size = 0;
+  std::size_t resident = 0;
+  statm >> size >> resident;
+  return static_cast<double>(resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)));
+}
+
+std::vector<std::size_t> MakeSizes(std::uint32_t seed, std::size_t min, std::size_t max) {
+  std::mt19937 random{seed};
+  std::vector<std::size_t> sizes(kSizeCount);
+  for (std::size_t& size : sizes) size = min + random() % (max - min + 1);
+  return sizes;
+}
+
+//----------------------------------------------------------------------
+
+// What one measured run produced, the pattern fills operations and the
+// resident memory it holds at its peak
+struct Measurement
+{
+  std::size_t operations;
+  double rss_bytes;
+};
+
+class Report
+{
+public:
+  explicit Report(const Options& options) : options_{options}, counters_{}, results_{} {}
+
+public:
+  bool Selected(const std::string& name) const {
+    return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+  }
+
+  void Run(const std::string& pattern, const std::string& allocator, std::size_t threads, const std::function<Measurement()>& body) {
+    std::string name = pattern + "." + allocator;
+    if (!Selected(name)) return;
+    std::cerr << name << " x" << threads << '\n';
+    counters_.Start();
+    auto start = std::chrono::steady_clock::now();
+    Measurement measurement = body();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    counters_.Stop();
+    std::ostringstream out;
+    out << "{\"name\": \"" << name << "\", \"pattern\": \"" << pattern << "\", \"allocator\": \"" << allocator
+        << "\", \"threads\": " << threads << ", \"operations\": " << measurement.operations
+        << ", \"ns_per_op\": " << elapsed.count() / static_cast<double>(measurement.operations)
+        << ", \"rss_bytes\": " << measurement.rss_bytes;
+    if (counters_.Available()) {
+      out << ", \"cache_references\": " << counters_.References() << ", \"cache_misses\": " << counters_.Misses();
+    }
+    else out << ", \"cache_references\": null, \"cache_misses\": null";
+    out << "}";
+    results_.push_back(out.str());
+  }
+
+  void Print(std::ostream& out) const {
+    out << "{\n  \"suite\": \"allocators\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+        << ",\n  \"perf_counters\": " << (counters_.Available() ? "true" : "false") << ",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < results_.size(); ++i) out << "    " << results_[i] << (i + 1 < results_.size() ? ",\n" : "\n");
+    out << "  ]\n}\n";
+  }
+
+  const Options& GetOptions() const { return options_; }
+
+  std::vector<std::size_t> ThreadCounts() const {
+    std::vector<std::size_t> counts;
+    for (std::size_t threads = 1; threads < options_.max_threads; threads *= 2) counts.push_back(threads);
+    counts.push_back(options_.max_threads);
+    return counts;
+  }
+
+private:
+  Options options_;
+  CacheCounters counters_;
+  std::vector<std::string> results_;
+};
+
+//----------------------------------------------------------------------
+
+// Allocators behind one interface. Reset drops everything at once for the
+// ones that can, the others free what the frame pattern hands back.
+
+class MallocHeap
+{
+public:
+  void* Allocate(std::size_t size_bytes) { return std::malloc(size_bytes); }
+  void Free(void* pointer, std::size_t) { std::free(pointer); }
+};
+
+template<std::size_t kBlockSize>
+class PoolHeap
+{
+public:
+  explicit PoolHeap(std::size_t block_count) : pool_{block_count} {}
+
+  void* Allocate(std::size_t size_bytes) { return pool_.Allocate(size_bytes); }
+  void Free(void* pointer, std::size_t size_bytes) { pool_.Free(pointer, size_bytes); }
+  void Reset() { pool_.Reset(); }
+
+private:
+  PoolAllocator<kBlockSize> pool_;
+};
+
+template<std::size_t kBlockSize>
+class LockedPoolHeap
+{
+public:
+  explicit LockedPoolHeap(std::size_t block_count) : pool_{block_count}, mutex_{} {}
+
+  void* Allocate(std::size_t size_bytes) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return pool_.Allocate(size_bytes);
+  }
+
+  void Free(void* pointer, std::size_t size_bytes) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    pool_.Free(pointer, size_bytes);
+  }
+
+private:
+  PoolAllocator<kBlockSize> pool_;
+  std::mutex mutex_;
+};
+
+class LinearHeap
+{
+public:
+  explicit LinearHeap(std::size_t size_bytes) : allocator_{size_bytes} {}
+
+  void* Allocate(std::size_t size_bytes) { return allocator_.Allocate(size_bytes); }
+  void Reset() { allocator_.Reset(); }
+
+private:
+  LinearAllocator allocator_;
+};
+
+class StackHeap
+{
+public:
+  explicit StackHeap(std::size_t size_bytes) : allocator_{size_bytes} {}
+
+  void* Allocate(std::size_t size_bytes) { return allocator_.Allocate(size_bytes); }
+  void Reset() { allocator_.Clear(); }
+
+private:
+  StackAllocator allocator_;
+};
+
+void* Touch(void* pointer, std::size_t size_bytes) {
+  if (pointer == nullptr) {
+    std::cerr << "allocator exhausted\n";
+    std::exit(1);
+  }
+  std::memset(pointer, 0x5a, std::min<std::size_t>(size_bytes, 64));
+  return pointer;
+}
+
+//----------------------------------------------------------------------
+
+// One thread's live set, every step frees a random slot and refills it
+template<typename Heap>
+void Churn(Heap& heap, std::size_t iterations, std::uint32_t seed) {
+  std::vector<std::size_t> sizes = MakeSizes(seed, 16, kSmallBlock);
+  std::vector<void*> live(kChurnObjects);
+  std::vector<std::size_t> live_sizes(kChurnObjects);
+  for (std::size_t i = 0; i < kChurnObjects; ++i) {
+    live_sizes[i] = sizes[i];
+    live[i] = Touch(heap.Allocate(live_sizes[i]), live_sizes[i]);
+  }
+  std::mt19937 random{seed};
+  for (std::size_t i = 0; i < iterations; ++i) {
+    std::size_t slot = random() % kChurnObjects;
+    heap.Free(live[slot], live_sizes[slot]);
+    live_sizes[slot] = sizes[i % kSizeCount];
+    live[slot] = Touch(heap.Allocate(live_sizes[slot]), live_sizes[slot]);
+  }
+  for (std::size_t i = 0; i < kChurnObjects; ++i) heap.Free(live[i], live_sizes[i]);
+}
+
+template<typename Heap, typename Make>
+void RunChurn(Report& report, const std::string& allocator, Make make) {
+  std::size_t iterations = report.GetOptions().iterations;
+  for (std::size_t threads : report.ThreadCounts()) {
+    report.Run("churn", allocator, threads, [&] {
+      double base = ResidentBytes();
+      Heap heap = make(threads);
+      std::vector<std::thread> workers;
+      for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&heap, iterations, i] { Churn(heap, iterations, static_cast<std::uint32_t>(i + 1)); });
+      }
+      for (std::thread& worker : workers) worker.join();
+      return Measurement{threads * iterations, ResidentBytes() - base};
+    });
+  }
+}
+
+//----------------------------------------------------------------------
+
+// Allocates a frame's worth of objects, then drops them all. Heaps without
+// Reset free them one by one as a malloc-based frame would.
+template<typename Heap>
+Measurement Frames(Heap& heap, std::size_t iterations) {
+  std::vector<std::size_t> sizes = MakeSizes(3, 16, kFrameBlock);
+  std::vector<std::pair<void*, std::size_t>> frame;
+  frame.reserve(kFrameObjects);
+  std::size_t frames = std::max<std::size_t>(iterations / kFrameObjects, 1);
+  double base = ResidentBytes();
+  double peak = 0.0;
+  for (std::size_t f = 0; f < frames; ++f) {
+    for (std::size_t i = 0; i < kFrameObjects; ++i) {
+      std::size_t size = sizes[(f * kFrameObjects + i) % kSizeCount];
+      frame.emplace_back(Touch(heap.Allocate(size), size), size);
+    }
+    if (f == 0) peak = ResidentBytes() - base;
+    if constexpr(requires { heap.Reset(); }) heap.Reset();
+    else for (const auto& [pointer, size] : frame) heap.Free(pointer, size);
+    frame.clear();
+  }
+  return Measurement{frames * kFrameObjects, peak};
+}
+
+template<typename Heap, typename Make>
+void RunFrame(Report& report, const std::string& allocator, Make make) {
+  report.Run("frame", allocator, 1, [&] {
+    Heap heap = make();
+    return Frames(heap, report.GetOptions().iterations);
+  });
+}
+
+//----------------------------------------------------------------------
+
+// Single producer, single consumer ring of pointers
+class PointerQueue
+{
+public:
+  PointerQueue() : slots_(kQueueCapacity), head_{0}, tail_{0} {}
+
+  void Push(void* pointer) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    while (tail - head_.load(std::memory_order_acquire) == kQueueCapacity) std::this_thread::yield();
+    slots_[tail % kQueueCapacity] = pointer;
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  void* Pop() {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    while (tail_.load(std::memory_order_acquire) == head) std::this_thread::yield();
+    void* pointer = slots_[head % kQueueCapacity];
+    head_.store(head + 1, std::memory_order_release);
+    return pointer;
+  }
+
+private:
+  std::vector<void*> slots_;
+  alignas(64) std::atomic<std::size_t> head_;
+  alignas(64) std::atomic<std::size_t> tail_;
+};
+
+// Pairs of threads, every block is allocated by the producer and freed by
+// the consumer of its pair
+template<typename Heap, typename Make>
+void RunProducer(Report& report, const std::string& allocator, Make make) {
+  std::size_t iterations = report.GetOptions().iterations;
+  for (std::size_t threads : report.ThreadCounts()) {
+    if (threads % 2 != 0 && report.GetOptions().max_threads > 1) continue;
+    std::size_t pairs = std::max<std::size_t>(threads / 2, 1);
+    report.Run("producer", allocator, pairs * 2, [&] {
+      double base = ResidentBytes();
+      Heap heap = make(pairs);
+      std::vector<PointerQueue> queues(pairs);
+      std::vector<std::thread> workers;
+      for (std::size_t i = 0; i < pairs; ++i) {
+        PointerQueue& queue = queues[i];
+        workers.emplace_back([&heap, &queue, iterations] {
+          for (std::size_t n = 0; n < iterations; ++n) queue.Push(Touch(heap.Allocate(kSmallBlock), kSmallBlock));
+        });
+        workers.emplace_back([&heap, &queue, iterations] {
+          for (std::size_t n = 0; n < iterations; ++n) heap.Free(queue.Pop(), kSmallBlock);
+        });
+      }
+      for (std::thread& worker : workers) worker.join();
+      return Measurement{pairs * iterations, ResidentBytes() - base};
+    });
+  }
+}
+
+//----------------------------------------------------------------------
+
+// Every eighth object lives until the end, the rest are replaced at random,
+// sizes spread from 16 bytes to 1KB with most of them small
+template<typename Heap>
+Measurement Fragment(Heap& heap, std::size_t iterations) {
+  std::mt19937 random{11};
+  std::vector<std::size_t> sizes(kSizeCount);
+  for (std::size_t& size : sizes) {
+    std::uint32_t bucket = random() % 100;
+    if (bucket < 60) size = 16 + random() % 49;
+    else if (bucket < 90) size = 65 + random() % 192;
+    else size = 257 + random() % (kFragmentationMaxSize - 256);
+  }
+  double base = ResidentBytes();
+  std::vector<std::pair<void*, std::size_t>> pinned;
+  std::vector<std::pair<void*, std::size_t>> live;
+  for (std::size_t i = 0; i < kFragmentationObjects; ++i) {
+    std::size_t size = sizes[i % kSizeCount];
+    void* pointer = Touch(heap.Allocate(size), size);
+    if (i % 8 == 0) pinned.emplace_back(pointer, size);
+    else live.emplace_back(pointer, size);
+  }
+  for (std::size_t i = 0; i < iterations; ++i) {
+    auto& [pointer, size] = live[random() % live.size()];
+    heap.Free(pointer, size);
+    size = sizes[i % kSizeCount];
+    pointer = Touch(heap.Allocate(size), size);
+  }
+  double rss = ResidentBytes() - base;
+  for (const auto& [pointer, size] : live) heap.Free(pointer, size);
+  for (const auto& [pointer, size] : pinned) heap.Free(pointer, size);
+  return Measurement{kFragmentationObjects + iterations, rss};
+}
+
+template<typename Heap, typename Make>
+void RunFragmentation(Report& report, const std::string& allocator, Make make) {
+  report.Run("fragmentation", allocator, 1, [&] {
+    Heap heap = make();
+    return Fragment(heap, report.GetOptions().iterations);
+  });
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0] << " [--iterations N] [--threads N] [--filter name]\n";
+    return 2;
+  }
+  Report report{options};
+  typedef ThreadCachedPool<kSmallBlock> CachedPool;
+  typedef ConcurrentPool<kSmallBlock> SharedPool;
+  std::size_t batch = CachedPool::kDefaultBatchSize;
+
+  // Fragmentation first so the malloc arena starts out clean
+  RunFragmentation<MallocHeap>(report, "malloc", [] { return MallocHeap{}; });
+  RunFragmentation<PoolHeap<kSmallBlock>>(report, "pool", [] {
+    return PoolHeap<kSmallBlock>{4 * kFragmentationObjects * kFragmentationMaxSize / kSmallBlock};
+  });
+
+  RunChurn<MallocHeap>(report, "malloc", [](std::size_t) { return MallocHeap{}; });
+  RunChurn<LockedPoolHeap<kSmallBlock>>(report, "pool", [](std::size_t threads) {
+    return LockedPoolHeap<kSmallBlock>{threads * kChurnObjects};
+  });
+  RunChurn<CachedPool>(report, "thread_cached_pool", [batch](std::size_t threads) {
+    return CachedPool{threads * (kChurnObjects + 4 * batch), batch};
+  });
+  RunChurn<SharedPool>(report, "concurrent_pool", [](std::size_t threads) { return SharedPool{threads * kChurnObjects}; });
+  RunChurn<SharedPool>(report, "concurrent_pool_deferred", [](std::size_t threads) { return SharedPool{threads * kChurnObjects, true}; });
+
+  RunFrame<MallocHeap>(report, "malloc", [] { return MallocHeap{}; });
+  RunFrame<PoolHeap<kFrameBlock>>(report, "pool", [] { return PoolHeap<kFrameBlock>{kFrameObjects}; });
+  RunFrame<LinearHeap>(report, "linear", [] { return LinearHeap{kFrameBytes}; });
+  RunFrame<StackHeap>(report, "stack", [] { return StackHeap{kFrameBytes}; });
+
+  RunProducer<MallocHeap>(report, "malloc", [](std::size_t) { return MallocHeap{}; });
+  RunProducer<LockedPoolHeap<kSmallBlock>>(report, "pool", [](std::size_t pairs) {
+    return LockedPoolHeap<kSmallBlock>{pairs * (kQueueCapacity + 2)};
+  });
+  RunProducer<CachedPool>(report, "thread_cached_pool", [batch](std::size_t pairs) {
+    return CachedPool{pairs * (kQueueCapacity + 8 * batch), batch};
+  });
+  RunProducer<SharedPool>(report, "concurrent_pool", [](std::size_t pairs) {
+    return SharedPool{pairs * (kQueueCapacity + 2)};
+  });
+  RunProducer<SharedPool>(report, "concurrent_pool_deferred", [](std::size_t pairs) {
+    return SharedPool{pairs * (kQueueCapacity + 2 * SharedPool::kRemoteBatch), true};
+  });
+
+  report.Print(std::cout);
   return 0;
-}
\ No newline at end of file
+}
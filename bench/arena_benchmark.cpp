@@ -0,0 +1,124 @@
+// Malloc-backed allocators against ones over a VirtualArena, sized like a
+// per-level arena: a large reservation of which a level only fills a part.
+// Reports construction time and resident memory after construction, after
+// filling, after Reset and after Decommit. Prints JSON.
+//
+// usage: ruthenium-bench-arena [--filter name]
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <unistd.h>
+
+#include "bench_common.h"
+#include "memory/linear_allocator.h"
+#include "memory/pool_allocator.h"
+#include "memory/virtual_arena.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+constexpr std::size_t kArenaSize = std::size_t{256} << 20;
+constexpr std::size_t kFillSize = std::size_t{32} << 20;
+constexpr std::size_t kObjectSize = 64;
+constexpr std::size_t kConstructions = 20;
+
+typedef memory::PoolAllocator<kObjectSize> Pool;
+
+double ResidentBytes()
+{
+    std::ifstream statm{"/proc/self/statm"};
+    std::size_t size = 0;
+    std::size_t resident = 0;
+    statm >> size >> resident;
+    return static_cast<double>(resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)));
+}
+
+// Allocates the fill in objects and writes each one, as loading a level would
+template<typename Allocator>
+void Fill(Allocator& allocator)
+{
+    for (std::size_t i = 0; i < kFillSize / kObjectSize; ++i)
+    {
+        void* pointer = allocator.Allocate(kObjectSize);
+        if (pointer == nullptr) break;
+        std::memset(pointer, static_cast<int>(i), kObjectSize);
+    }
+}
+
+// Make builds the allocator, and the arena it sits in when it has one
+template<typename Make>
+void RunLevel(bench::BenchReport& report, const std::string& name, Make make)
+{
+    if (!report.Selected(name)) return;
+    std::cerr << name << '\n';
+    double seconds = 0.0;
+    for (std::size_t i = 0; i < kConstructions; ++i)
+    {
+        bench::BenchClock::time_point begin = bench::BenchClock::now();
+        auto level = make();
+        seconds += std::chrono::duration<double>(bench::BenchClock::now() - begin).count();
+    }
+    double base = ResidentBytes();
+    auto level = make();
+    double constructed = ResidentBytes() - base;
+    Fill(*level.second);
+    double filled = ResidentBytes() - base;
+    level.second->Reset();
+    double reset = ResidentBytes() - base;
+    level.second->Decommit();
+    double decommitted = ResidentBytes() - base;
+    report.Value(name, {
+        {"construct_us", seconds * 1e6 / static_cast<double>(kConstructions)},
+        {"rss_constructed_bytes", constructed},
+        {"rss_filled_bytes", filled},
+        {"rss_reset_bytes", reset},
+        {"rss_decommitted_bytes", decommitted}
+    });
+}
+
+template<typename Allocator>
+auto MakeMalloc(std::size_t size)
+{
+    if constexpr(std::is_same_v<Allocator, Pool>) return std::make_pair(nullptr, std::make_unique<Pool>(size / kObjectSize));
+    else return std::make_pair(nullptr, std::make_unique<memory::LinearAllocator>(size));
+}
+
+template<typename Allocator>
+auto MakeVirtual(std::size_t size, bool huge_pages)
+{
+    std::unique_ptr<memory::VirtualArena> arena = std::make_unique<memory::VirtualArena>(size + (size >> 8), huge_pages);
+    std::unique_ptr<Allocator> allocator;
+    if constexpr(std::is_same_v<Allocator, Pool>) allocator = std::make_unique<Pool>(*arena, size / kObjectSize);
+    else allocator = std::make_unique<memory::LinearAllocator>(*arena);
+    // Pair members are destroyed in reverse, the allocator before its arena
+    return std::make_pair(std::move(arena), std::move(allocator));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bench::BenchOptions options;
+    if (!bench::ParseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0] << " [--filter name]\n";
+        return 2;
+    }
+    bench::BenchReport report{"arena", options};
+    RunLevel(report, "level.linear.malloc", [] { return MakeMalloc<memory::LinearAllocator>(kArenaSize); });
+    RunLevel(report, "level.linear.arena", [] { return MakeVirtual<memory::LinearAllocator>(kArenaSize, false); });
+    RunLevel(report, "level.linear.arena_huge", [] { return MakeVirtual<memory::LinearAllocator>(kArenaSize, true); });
+    RunLevel(report, "level.pool.malloc", [] { return MakeMalloc<Pool>(kArenaSize); });
+    RunLevel(report, "level.pool.arena", [] { return MakeVirtual<Pool>(kArenaSize, false); });
+    RunLevel(report, "level.pool.arena_huge", [] { return MakeVirtual<Pool>(kArenaSize, true); });
+    report.Print(std::cout);
+    return 0;
+}
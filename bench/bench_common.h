@@ -0,0 +1,175 @@
+#ifndef RUTHEN_BENCH_COMMON_H
+#define RUTHEN_BENCH_COMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ruthen
+{
+
+namespace bench
+{
+
+//----------------------------------------------------------------------
+
+// Allocations made by the calling thread, counted by the operator new
+// replacements in alloc_hook.cpp
+std::uint64_t ThreadAllocations();
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct BenchOptions
+{
+    std::size_t iterations = 200000;
+    std::size_t latency_samples = 100000;
+    std::size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+    std::string filter;
+};
+
+// Accepts --iterations N, --samples N, --threads N and --filter substring
+inline bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument{argv[i]};
+        if (i + 1 >= argc) return false;
+        if (argument == "--iterations") options.iterations = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--samples") options.latency_samples = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--threads") options.max_threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--filter") options.filter = argv[++i];
+        else return false;
+    }
+    return options.iterations > 0 && options.latency_samples > 0 && options.max_threads > 0;
+}
+
+//----------------------------------------------------------------------
+
+// Collects results and prints them as one JSON document, progress goes to
+// stderr so stdout can be redirected into a file
+class BenchReport
+{
+public:
+    BenchReport(std::string suite, const BenchOptions& options) : suite_{std::move(suite)}, options_{options}, results_{} {}
+
+public:
+    bool Selected(std::string_view name) const
+    {
+        return options_.filter.empty() || name.find(options_.filter) != std::string_view::npos;
+    }
+
+    // Single thread, reports the mean time and the allocations per call. A
+    // non-zero limit caps the iteration count.
+    void Throughput(const std::string& name, const std::function<void(std::size_t)>& body, std::size_t limit = 0)
+    {
+        if (!Selected(name)) return;
+        std::cerr << name << '\n';
+        std::size_t count = limit > 0 ? std::min(limit, options_.iterations) : options_.iterations;
+        std::size_t warmup = std::min<std::size_t>(count / 10 + 1, 10000);
+        for (std::size_t i = 0; i < warmup; ++i) body(i);
+        std::uint64_t allocations = ThreadAllocations();
+        BenchClock::time_point begin = BenchClock::now();
+        for (std::size_t i = 0; i < count; ++i) body(i);
+        double seconds = std::chrono::duration<double>(BenchClock::now() - begin).count();
+        allocations = ThreadAllocations() - allocations;
+        double iterations = static_cast<double>(count);
+        std::ostringstream out;
+        out << "{\"name\": \"" << name << "\", \"kind\": \"throughput\", \"threads\": 1, \"iterations\": " << count
+            << ", \"ns_per_op\": " << seconds * 1e9 / iterations << ", \"ops_per_second\": " << iterations / seconds
+            << ", \"allocations_per_op\": " << static_cast<double>(allocations) / iterations << "}";
+        results_.push_back(out.str());
+    }
+
+    // Times every call on its own, the clock overhead is included
+    void Latency(const std::string& name, const std::function<void(std::size_t)>& body)
+    {
+        if (!Selected(name)) return;
+        std::cerr << name << '\n';
+        std::vector<std::int64_t> samples(options_.latency_samples);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            BenchClock::time_point begin = BenchClock::now();
+            body(i);
+            samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - begin).count();
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double fraction) { return samples[std::min(samples.size() - 1, static_cast<std::size_t>(fraction * static_cast<double>(samples.size())))]; };
+        std::ostringstream out;
+        out << "{\"name\": \"" << name << "\", \"kind\": \"latency\", \"samples\": " << samples.size()
+            << ", \"p50_ns\": " << percentile(0.5) << ", \"p99_ns\": " << percentile(0.99) << ", \"p999_ns\": " << percentile(0.999)
+            << ", \"max_ns\": " << samples.back() << "}";
+        results_.push_back(out.str());
+    }
+
+    // Runs the body on 1, 2, 4 ... max_threads producers at once, each doing
+    // the full iteration count. The body gets the thread and iteration index.
+    void Scaling(const std::string& name, const std::function<void(std::size_t, std::size_t)>& body, const std::function<void()>& after = {})
+    {
+        if (!Selected(name)) return;
+        std::vector<std::size_t> counts;
+        for (std::size_t threads = 1; threads < options_.max_threads; threads *= 2) counts.push_back(threads);
+        counts.push_back(options_.max_threads);
+        for (std::size_t threads : counts)
+        {
+            std::cerr << name << " x" << threads << '\n';
+            std::vector<std::thread> producers;
+            BenchClock::time_point begin = BenchClock::now();
+            for (std::size_t thread = 0; thread < threads; ++thread)
+            {
+                producers.emplace_back([&body, thread, this] { for (std::size_t i = 0; i < options_.iterations; ++i) body(thread, i); });
+            }
+            for (std::thread& producer : producers) producer.join();
+            if (after) after();
+            double seconds = std::chrono::duration<double>(BenchClock::now() - begin).count();
+            double operations = static_cast<double>(options_.iterations * threads);
+            std::ostringstream out;
+            out << "{\"name\": \"" << name << "\", \"kind\": \"scaling\", \"threads\": " << threads << ", \"iterations\": " << options_.iterations
+                << ", \"ns_per_op\": " << seconds * 1e9 / operations << ", \"ops_per_second\": " << operations / seconds << "}";
+            results_.push_back(out.str());
+        }
+    }
+
+    // Free-form measurements that are not timings
+    void Value(const std::string& name, const std::vector<std::pair<std::string, double>>& values)
+    {
+        if (!Selected(name)) return;
+        std::ostringstream out;
+        out << "{\"name\": \"" << name << "\", \"kind\": \"value\"";
+        for (const std::pair<std::string, double>& value : values) out << ", \"" << value.first << "\": " << value.second;
+        out << "}";
+        results_.push_back(out.str());
+    }
+
+    void Print(std::ostream& out) const
+    {
+        out << "{\n  \"suite\": \"" << suite_ << "\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results_.size(); ++i)
+        {
+            out << "    " << results_[i] << (i + 1 < results_.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    std::string suite_;
+    BenchOptions options_;
+    std::vector<std::string> results_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
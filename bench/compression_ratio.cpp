@@ -0,0 +1,47 @@
+// Compression ratio of the log block codec on generated log text and on
+// any files passed on the command line.
+//
+// usage: ruthenium-bench-compression-ratio [file...]
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "log_corpus.h"
+#include "logging/compression.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+void Report(const std::string& name, const std::string& data)
+{
+    std::vector<char> compressed(logging::CompressBound(logging::kCompressedBlockSize));
+    std::size_t stored = 0;
+    std::size_t blocks = 0;
+    for (std::size_t offset = 0; offset < data.size(); offset += logging::kCompressedBlockSize, ++blocks)
+    {
+        std::size_t size = std::min(logging::kCompressedBlockSize, data.size() - offset);
+        std::size_t result = logging::CompressBlock(data.data() + offset, size, compressed.data(), compressed.size());
+        stored += result == 0 || result >= size ? size : result;
+    }
+    double ratio = stored > 0 ? static_cast<double>(data.size()) / static_cast<double>(stored) : 0.0;
+    std::cout << std::left << std::setw(32) << name << std::right
+              << std::setw(12) << data.size() << std::setw(12) << stored << std::setw(8) << blocks
+              << std::setw(10) << std::fixed << std::setprecision(2) << ratio << '\n';
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << std::left << std::setw(32) << "input" << std::right << std::setw(12) << "raw" << std::setw(12)
+              << "stored" << std::setw(8) << "blocks" << std::setw(10) << "ratio" << '\n';
+    Report("generated log text (16 MB)", bench::MakeLogCorpus(16 * 1024 * 1024));
+    for (int i = 1; i < argc; ++i) Report(argv[i], bench::ReadFile(argv[i]));
+    return 0;
+}
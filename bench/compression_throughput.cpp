@@ -0,0 +1,105 @@
+// Throughput of the log block codec and of compressing a whole rotated
+// segment file, which is what the background compressor does.
+//
+// usage: ruthenium-bench-compression-throughput [corpus size in MB]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "log_corpus.h"
+#include "logging/compression.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+typedef std::chrono::steady_clock BenchClock;
+
+double Seconds(BenchClock::time_point begin)
+{
+    return std::chrono::duration<double>(BenchClock::now() - begin).count();
+}
+
+void Report(const char* name, std::size_t bytes, double seconds)
+{
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds << " MB/s\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t megabytes = argc > 1 ? static_cast<std::size_t>(std::atoi(argv[1])) : 64;
+    std::string corpus = bench::MakeLogCorpus(megabytes * 1024 * 1024);
+    constexpr int kRounds = 3;
+
+    // Blocks are compressed one after another into a single buffer
+    std::vector<char> compressed(corpus.size() + corpus.size() / 255 + 64 * (corpus.size() / logging::kCompressedBlockSize + 1));
+    std::vector<std::size_t> sizes;
+    double best = 1e30;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        sizes.clear();
+        char* out = compressed.data();
+        BenchClock::time_point begin = BenchClock::now();
+        for (std::size_t offset = 0; offset < corpus.size(); offset += logging::kCompressedBlockSize)
+        {
+            std::size_t size = std::min(logging::kCompressedBlockSize, corpus.size() - offset);
+            std::size_t result = logging::CompressBlock(corpus.data() + offset, size, out, logging::CompressBound(size));
+            sizes.push_back(result);
+            out += result;
+        }
+        best = std::min(best, Seconds(begin));
+    }
+    Report("compress", corpus.size(), best);
+
+    std::string restored(corpus.size(), '\0');
+    best = 1e30;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        const char* in = compressed.data();
+        char* out = restored.data();
+        BenchClock::time_point begin = BenchClock::now();
+        for (std::size_t size : sizes)
+        {
+            out += logging::DecompressBlock(in, size, out, logging::kCompressedBlockSize);
+            in += size;
+        }
+        best = std::min(best, Seconds(begin));
+    }
+    Report("decompress", corpus.size(), best);
+    if (restored != corpus)
+    {
+        std::cerr << "round trip mismatch\n";
+        return 1;
+    }
+
+    std::string path = "ruthenium-bench-segment.log";
+    std::ofstream{path, std::ios::binary} << corpus;
+    BenchClock::time_point begin = BenchClock::now();
+    bool ok = logging::CompressLogFile(path, {}, path + std::string{logging::kCompressedLogExtension});
+    Report("compress segment file", corpus.size(), Seconds(begin));
+    begin = BenchClock::now();
+    std::string text;
+    if (ok) logging::CompressedLogReader{path + std::string{logging::kCompressedLogExtension}}.ReadRange(std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max(), text);
+    Report("read segment file", corpus.size(), Seconds(begin));
+    std::remove(path.c_str());
+    std::remove((path + std::string{logging::kCompressedLogExtension}).c_str());
+    if (!ok || text != corpus)
+    {
+        std::cerr << "segment file round trip failed\n";
+        return 1;
+    }
+    return 0;
+}
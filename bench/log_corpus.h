@@ -0,0 +1,60 @@
+#ifndef RUTHEN_BENCH_LOG_CORPUS_H
+#define RUTHEN_BENCH_LOG_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+#include "format.h"
+#include "logging/log_record.h"
+#include "logging/timestamp.h"
+
+namespace ruthen
+{
+
+namespace bench
+{
+
+// Text a debug session produces: the regular entry layout, a handful of
+// loggers and message shapes with varying numbers in them.
+inline std::string MakeLogCorpus(std::size_t size, std::uint32_t seed = 1)
+{
+    constexpr const char* kLoggers[] = {"SystemLogger", "DebugLogger", "GraphicsLogger", "ClientLogger"};
+    constexpr LogLevel kLevels[] = {LogLevel::kTrace, LogLevel::kDebug, LogLevel::kInfo, LogLevel::kWarn};
+    std::mt19937 random{seed};
+    std::string corpus;
+    std::string message;
+    std::int64_t timestamp = logging::CurrentTimestamp();
+    while (corpus.size() < size)
+    {
+        timestamp += static_cast<std::int64_t>(random() % 2000000);
+        std::uint32_t value = random();
+        switch (value % 5)
+        {
+            case 0: message = Format("Frame %1 took %2 us", value % 100000, value % 20000); break;
+            case 1: message = Format("Uploaded texture %1 (%2x%3)", value % 512, 64 << (value % 5), 64 << (value % 4)); break;
+            case 2: message = Format("Entity %1 moved to %2, %3, %4", value % 4096, value % 1000, (value >> 8) % 1000, (value >> 16) % 1000); break;
+            case 3: message = Format("Streaming chunk %1 of %2 from assets/level%3.pak", value % 64, 64, value % 8); break;
+            default: message = Format("Cache miss for shader %1", value); break;
+        }
+        logging::LogEntry entry{timestamp, value % 4, kLevels[value % 4], kLoggers[value % 4], "Debug.txt", message, false, 0};
+        logging::AppendEntryText(corpus, entry);
+    }
+    corpus.resize(size);
+    return corpus;
+}
+
+inline std::string ReadFile(const std::string& path)
+{
+    std::ifstream input{path, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+// Logging hot paths: formatting, Logger::Log through LogManager in both
+// modes, the binary path, filtered calls and logger lookups. Prints JSON.
+//
+// usage: ruthenium-bench-logging [--iterations N] [--samples N] [--threads N] [--filter name]
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "format.h"
+#include "subsys/log_manager.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+constexpr const char* kDestination = "bench.log";
+
+void RunFormat(bench::BenchReport& report)
+{
+    std::string text;
+    report.Throughput("format.string", [&text](std::size_t i) { text = Format("Frame %1 took %2 us on %3", i, i % 20000, "main"); });
+    FormatBuffer<256> buffer;
+    report.Throughput("format.buffer", [&buffer](std::size_t i)
+    {
+        buffer.Clear();
+        FormatTo(buffer, "Frame %1 took %2 us on %3", i, i % 20000, "main");
+    });
+}
+
+void RunLogger(bench::BenchReport& report, subsys::LogManager& manager, const std::string& mode)
+{
+    Logger& logger = manager[manager.GetGraphicsLogger()];
+    report.Throughput("log." + mode, [&logger](std::size_t i) { logger.Log(kDestination, "Frame %1 took %2 us", LogLevel::kInfo, i, i % 20000); });
+    manager.Flush();
+    report.Latency("log." + mode, [&logger](std::size_t i) { logger.Log(kDestination, "Frame %1 took %2 us", LogLevel::kInfo, i, i % 20000); });
+    manager.Flush();
+    report.Throughput("log_binary." + mode, [&logger](std::size_t i)
+    {
+        RUTHEN_LOG_BINARY(logger, kDestination, LogLevel::kInfo, "Frame %1 took %2 us", i, i % 20000);
+    });
+    manager.Flush();
+    report.Scaling("log." + mode, [&logger](std::size_t thread, std::size_t i)
+    {
+        logger.Log(kDestination, "Thread %1 frame %2", LogLevel::kInfo, thread, i);
+    }, [&manager] { manager.Flush(); });
+}
+
+void RunFiltered(bench::BenchReport& report, subsys::LogManager& manager)
+{
+    const Logger& logger = manager[manager.GetSystemLogger()];
+    report.Throughput("log.filtered", [&logger](std::size_t i) { RUTHEN_LOG(logger, LogLevel::kDebug, kDestination, "Frame %1", i); });
+}
+
+void RunRegistry(bench::BenchReport& report, subsys::LogManager& manager)
+{
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < 64; ++i) names.push_back("BenchLogger" + std::to_string(i));
+    for (const std::string& name : names) manager.CreateLogger(name);
+    report.Throughput("manager.get_logger", [&manager, &names](std::size_t i)
+    {
+        LoggerID id = manager.GetLogger(names[i % names.size()]);
+        (void)id;
+    });
+    report.Latency("manager.get_logger", [&manager, &names](std::size_t i)
+    {
+        LoggerID id = manager.GetLogger(names[i % names.size()]);
+        (void)id;
+    });
+    report.Scaling("manager.get_logger", [&manager, &names](std::size_t thread, std::size_t i)
+    {
+        LoggerID id = manager.GetLogger(names[(thread + i) % names.size()]);
+        (void)id;
+    });
+    // Every change copies the registry into a new snapshot, the old one is
+    // reclaimed once no lookup can see it
+    report.Throughput("manager.create_delete_logger", [&manager](std::size_t)
+    {
+        manager.DeleteLogger(manager.CreateLogger("BenchTransient"));
+    }, 20000);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bench::BenchOptions options;
+    if (!bench::ParseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0] << " [--iterations N] [--samples N] [--threads N] [--filter name]\n";
+        return 2;
+    }
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "ruthenium-bench-logging";
+    std::filesystem::create_directories(directory);
+    std::filesystem::current_path(directory);
+
+    bench::BenchReport report{"logging", options};
+    RunFormat(report);
+    {
+        subsys::LogManager manager;
+        manager.Initialize();
+        RunLogger(report, manager, "sync");
+        RunFiltered(report, manager);
+        manager.Shutdown();
+    }
+    {
+        subsys::LogManager manager;
+        manager.Initialize();
+        manager.EnableAsync();
+        RunLogger(report, manager, "async");
+        manager.Shutdown();
+    }
+    {
+        subsys::LogManager manager;
+        manager.Initialize();
+        RunRegistry(report, manager);
+        manager.Shutdown();
+    }
+    report.Print(std::cout);
+
+    std::filesystem::current_path(directory.parent_path());
+    std::filesystem::remove_all(directory);
+    return 0;
+}
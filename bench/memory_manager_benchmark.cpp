@@ -0,0 +1,189 @@
+// MemoryManager against glibc malloc on a mixed small-object churn: a live
+// set of objects where every step frees one and allocates the next, sizes
+// skewed towards small ones. Reports single-thread throughput, scaling and
+// the memory footprint left by a workload whose sizes shift. Prints JSON.
+//
+// usage: ruthenium-bench-memory [--iterations N] [--threads N] [--filter name]
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <malloc.h>
+
+#include "bench_common.h"
+#include "subsys/memory_manager.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+constexpr std::size_t kLiveObjects = 8192;
+constexpr std::size_t kSizeCount = 1 << 16;
+constexpr std::size_t kFragmentationObjects = 100000;
+constexpr std::size_t kFragmentationSteps = 1000000;
+
+class MallocHeap
+{
+public:
+    void* Allocate(std::size_t size) { return std::malloc(size); }
+    void Free(void* pointer) { std::free(pointer); }
+};
+
+class ManagerHeap
+{
+public:
+    explicit ManagerHeap(subsys::MemoryManager& manager) : manager_{manager} {}
+
+    void* Allocate(std::size_t size) { return manager_.Allocate(size); }
+    void Free(void* pointer) { manager_.Free(pointer); }
+
+private:
+    subsys::MemoryManager& manager_;
+};
+
+// 70% up to 64 bytes, 22% up to 512 and the rest up to 4096. Large swaps
+// the shares of the smallest and the largest sizes.
+std::vector<std::size_t> MakeSizes(std::uint32_t seed, bool large)
+{
+    std::mt19937 random{seed};
+    std::vector<std::size_t> sizes(kSizeCount);
+    for (std::size_t& size : sizes)
+    {
+        std::uint32_t bucket = random() % 100;
+        if (large) bucket = bucket < 8 ? 0 : bucket < 30 ? 70 : 92;
+        if (bucket < 70) size = 8 + random() % 57;
+        else if (bucket < 92) size = 65 + random() % 448;
+        else size = 513 + random() % 3584;
+    }
+    return sizes;
+}
+
+// One thread's live set, every step replaces one object
+struct Churn
+{
+    std::vector<void*> live;
+    std::vector<std::size_t> live_sizes;
+    std::vector<std::size_t> sizes;
+    std::size_t requested;
+};
+
+template<typename Heap>
+Churn MakeChurn(Heap& heap, std::size_t objects, std::uint32_t seed)
+{
+    Churn churn{std::vector<void*>(objects), std::vector<std::size_t>(objects), MakeSizes(seed, false), 0};
+    for (std::size_t i = 0; i < objects; ++i)
+    {
+        churn.live_sizes[i] = churn.sizes[i % kSizeCount];
+        churn.live[i] = heap.Allocate(churn.live_sizes[i]);
+        churn.requested += churn.live_sizes[i];
+    }
+    return churn;
+}
+
+template<typename Heap>
+void Step(Heap& heap, Churn& churn, std::size_t i)
+{
+    std::size_t slot = (i * 7919) % churn.live.size();
+    std::size_t size = churn.sizes[i % kSizeCount];
+    heap.Free(churn.live[slot]);
+    churn.requested += size - churn.live_sizes[slot];
+    churn.live_sizes[slot] = size;
+    churn.live[slot] = heap.Allocate(size);
+    *static_cast<unsigned char*>(churn.live[slot]) = static_cast<unsigned char>(i);
+}
+
+template<typename Heap>
+void Release(Heap& heap, Churn& churn)
+{
+    for (void* pointer : churn.live) heap.Free(pointer);
+    churn.live.clear();
+}
+
+template<typename Heap>
+void RunChurn(bench::BenchReport& report, Heap& heap, const std::string& name, std::size_t max_threads)
+{
+    Churn churn = MakeChurn(heap, kLiveObjects, 1);
+    report.Throughput("churn." + name, [&heap, &churn](std::size_t i) { Step(heap, churn, i); });
+    Release(heap, churn);
+    std::vector<Churn> churns;
+    for (std::size_t thread = 0; thread < max_threads; ++thread)
+    {
+        churns.push_back(MakeChurn(heap, kLiveObjects, static_cast<std::uint32_t>(thread + 1)));
+    }
+    report.Scaling("churn." + name, [&heap, &churns](std::size_t thread, std::size_t i) { Step(heap, churns[thread], i); });
+    for (Churn& thread_churn : churns) Release(heap, thread_churn);
+}
+
+void ReportFootprint(bench::BenchReport& report, const std::string& name, std::size_t requested, double used)
+{
+    report.Value(name, {{"requested_bytes", static_cast<double>(requested)}, {"footprint_bytes", used}, {"overhead", used / static_cast<double>(requested)}});
+}
+
+// Small objects first, then the same number of steps with the mix shifted
+// to large ones while the live set stays the same size. The footprint is
+// reported after each phase.
+template<typename Heap, typename Footprint>
+void RunShift(bench::BenchReport& report, Heap& heap, const std::string& name, Footprint&& footprint)
+{
+    Churn churn = MakeChurn(heap, kFragmentationObjects, 7);
+    for (std::size_t i = 0; i < kFragmentationSteps; ++i) Step(heap, churn, i);
+    ReportFootprint(report, "fragmentation." + name, churn.requested, footprint());
+    churn.sizes = MakeSizes(8, true);
+    for (std::size_t i = 0; i < kFragmentationSteps; ++i) Step(heap, churn, i);
+    ReportFootprint(report, "fragmentation_shift." + name, churn.requested, footprint());
+    Release(heap, churn);
+}
+
+void RunFragmentation(bench::BenchReport& report)
+{
+    {
+        auto arena = [] { struct mallinfo2 info = mallinfo2(); return info.arena + info.hblkhd; };
+        MallocHeap heap;
+        std::size_t before = arena();
+        RunShift(report, heap, "malloc", [&arena, before] { return static_cast<double>(arena() - before); });
+    }
+    {
+        subsys::MemoryManager manager;
+        ManagerHeap heap{manager};
+        RunShift(report, heap, "manager", [&manager]
+        {
+            double used = static_cast<double>(manager.GetLargeBytes());
+            for (std::size_t i = 0; i < subsys::MemoryManager::kSizeClassCount; ++i)
+            {
+                subsys::SizeClassStats stats = manager.GetSizeClassStats(i);
+                used += static_cast<double>(stats.touched_blocks * stats.block_size);
+            }
+            return used;
+        });
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bench::BenchOptions options;
+    if (!bench::ParseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0] << " [--iterations N] [--threads N] [--filter name]\n";
+        return 2;
+    }
+    bench::BenchReport report{"memory", options};
+    // First, so earlier runs leave nothing in the malloc arena
+    if (report.Selected("fragmentation")) RunFragmentation(report);
+    {
+        MallocHeap heap;
+        RunChurn(report, heap, "malloc", options.max_threads);
+    }
+    {
+        subsys::MemoryManager manager;
+        ManagerHeap heap{manager};
+        RunChurn(report, heap, "manager", options.max_threads);
+    }
+    report.Print(std::cout);
+    return 0;
+}
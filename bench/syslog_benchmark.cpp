@@ -0,0 +1,44 @@
+// The legacy SYSLOG_* macros. The legacy Logger shares its class name with
+// the subsystem one, so this is a separate executable that does not link
+// LogManager. Prints JSON.
+//
+// usage: ruthenium-bench-syslog [--iterations N] [--samples N] [--threads N] [--filter name]
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "bench_common.h"
+#include "logger.h"
+
+int main(int argc, char** argv)
+{
+    using namespace ruthen;
+
+    bench::BenchOptions options;
+    options.iterations = 20000;
+    options.latency_samples = 20000;
+    if (!bench::ParseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0] << " [--iterations N] [--samples N] [--threads N] [--filter name]\n";
+        return 2;
+    }
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "ruthenium-bench-syslog";
+    std::filesystem::create_directories(directory);
+    std::filesystem::current_path(directory);
+
+    bench::BenchReport report{"syslog", options};
+    std::string message = "Frame took 16666 us";
+    report.Throughput("syslog.info", [&message](std::size_t) { SYSLOG_INFO(message); });
+    report.Latency("syslog.info", [&message](std::size_t) { SYSLOG_INFO(message); });
+    report.Throughput("syslogf.info", [](std::size_t i) { SYSLOGF_INFO("Frame %1 took %2 us", i, i % 20000); });
+    report.Latency("syslogf.info", [](std::size_t i) { SYSLOGF_INFO("Frame %1 took %2 us", i, i % 20000); });
+    report.Scaling("syslog.info", [&message](std::size_t, std::size_t) { SYSLOG_INFO(message); });
+    SystemLogger->SetLevel(Logger::kError);
+    report.Throughput("syslogf.filtered", [](std::size_t i) { SYSLOGF_INFO("Frame %1 took %2 us", i, i % 20000); });
+    report.Print(std::cout);
+
+    std::filesystem::current_path(directory.parent_path());
+    std::filesystem::remove_all(directory);
+    return 0;
+}
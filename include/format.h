@@ -2,35 +2,390 @@
 #define RUTHEN_FORMAT_H
 
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <array>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <tuple>
+
+#include "clock.h"
 
 namespace ruthen
 {
 
+//----------------------------------------------------------------------
 
-template<char EscChar = '%', typename... Args>
-constexpr std::string Format(const std::string& format, Args&&... args)
+// Fixed-capacity character buffer meant to live on the stack. Output that
+// does not fit is dropped and reported through Truncated().
+template<std::size_t kCapacity>
+class FormatBuffer
 {
-    static_assert((std::is_convertible<Args, std::string>::value && ...), "Can not convert parameter pack arguments to std::string");
-    if constexpr (sizeof...(Args) <= 0) return format;
-    std::array<std::string, sizeof...(Args)> arr{static_cast<std::string>(std::forward<Args>(args))...};
-    std::string result = format;
-    for(std::size_t index = 0; index < result.size(); ++index)
+public:
+    FormatBuffer() : size_{0}, truncated_{false} {}
+
+public:
+    void Append(std::string_view text)
     {
-        if(result[index] != EscChar || index + 1 >= result.size()) continue;
-        if(result[index + 1] == EscChar) { result.erase(index + 1, 1); continue; }
-        if(!std::isdigit(result[index + 1])) continue;
-        std::size_t last_digit = index + 1;
-        while(std::isdigit(last_digit) && last_digit + 1 < result.size()) {++last_digit;}
-        std::size_t arr_index = std::stoul(result.substr(index + 1, last_digit - index)) - 1;
-        if(arr_index + 1 > arr.size()) continue;
-        result.replace(index, last_digit - index + 1, arr[arr_index]);
+        std::size_t size = text.size() < kCapacity - size_ ? text.size() : kCapacity - size_;
+        std::memcpy(data_ + size_, text.data(), size);
+        size_ += size;
+        if(size < text.size()) truncated_ = true;
     }
-    return result;
+    void Push(char character)
+    {
+        if(size_ < kCapacity) data_[size_++] = character;
+        else truncated_ = true;
+    }
+    void Clear()
+    {
+        size_ = 0;
+        truncated_ = false;
+    }
+
+public:
+    std::string_view View() const { return std::string_view{data_, size_}; }
+    const char* Data() const { return data_; }
+    std::size_t Size() const { return size_; }
+    constexpr std::size_t Capacity() const { return kCapacity; }
+    bool Truncated() const { return truncated_; }
+
+private:
+    char data_[kCapacity];
+    std::size_t size_;
+    bool truncated_;
+};
+
+//----------------------------------------------------------------------
+
+namespace detail
+{
+
+constexpr std::size_t kMaxFormatSegments = 32;
+constexpr std::size_t kFormatLiteral = static_cast<std::size_t>(-1);
+
+struct FormatSegment
+{
+    std::size_t offset;
+    std::size_t size;
+    std::size_t argument;
+};
+
+// Not constexpr on purpose: reaching it while parsing a format string at
+// compile time turns the message into a compiler error.
+inline void FormatStringError(const char* message)
+{
+    (void)message;
+}
+
+// Splits a format string into literal runs and 1-based %N placeholders.
+// "%%" produces a single '%'. Placeholders that do not name an argument
+// are rejected in strict mode and kept as literal text otherwise.
+template<char EscChar, typename Visitor>
+constexpr void ParseFormat(std::string_view format, std::size_t argument_count, bool strict, Visitor&& visitor)
+{
+    std::size_t literal_begin = 0;
+    std::size_t index = 0;
+    while(index < format.size())
+    {
+        if(format[index] != EscChar || index + 1 >= format.size())
+        {
+            ++index;
+            continue;
+        }
+        char next = format[index + 1];
+        if(next == EscChar)
+        {
+            visitor.Literal(literal_begin, index + 1 - literal_begin);
+            index += 2;
+            literal_begin = index;
+            continue;
+        }
+        if(next < '0' || next > '9')
+        {
+            ++index;
+            continue;
+        }
+        std::size_t last = index + 1;
+        std::size_t number = 0;
+        while(last < format.size() && format[last] >= '0' && format[last] <= '9')
+        {
+            number = number * 10 + static_cast<std::size_t>(format[last] - '0');
+            ++last;
+        }
+        if(number == 0 || number > argument_count)
+        {
+            if(strict) FormatStringError("format placeholder does not name an argument");
+            index = last;
+            continue;
+        }
+        visitor.Literal(literal_begin, index - literal_begin);
+        visitor.Argument(number - 1);
+        index = last;
+        literal_begin = index;
+    }
+    visitor.Literal(literal_begin, format.size() - literal_begin);
+}
+
+//----------------------------------------------------------------------
+
+struct CountingWriter
+{
+    std::size_t size = 0;
+    void Append(std::string_view text) { size += text.size(); }
+    void Push(char) { ++size; }
+};
+
+struct SpanWriter
+{
+    char* data;
+    std::size_t capacity;
+    std::size_t size = 0;
+    void Append(std::string_view text)
+    {
+        std::size_t count = text.size() < capacity - size ? text.size() : capacity - size;
+        std::memcpy(data + size, text.data(), count);
+        size += count;
+    }
+    void Push(char character)
+    {
+        if(size < capacity) data[size++] = character;
+    }
+};
+
+template<typename OutputIt>
+struct IteratorWriter
+{
+    OutputIt out;
+    void Append(std::string_view text) { out = std::copy(text.begin(), text.end(), out); }
+    void Push(char character) { *out++ = character; }
+};
+
+//----------------------------------------------------------------------
+
+template<typename T>
+concept FormatStringLike = std::is_convertible_v<const T&, std::string_view>;
+
+template<typename T>
+concept FormatNamedEnum = std::is_enum_v<T> && requires(T value)
+{
+    { FormatEnumName(value) } -> std::convertible_to<std::string_view>;
+};
+
+template<typename T>
+concept FormatArgument =
+    FormatStringLike<T> ||
+    std::is_arithmetic_v<T> ||
+    std::is_enum_v<T> ||
+    std::is_same_v<T, Time>;
+
+template<typename Writer, typename T>
+void WriteArgument(Writer& writer, const T& value)
+{
+    if constexpr(FormatStringLike<T>)
+    {
+        writer.Append(std::string_view{value});
+    }
+    else if constexpr(std::is_same_v<T, bool>)
+    {
+        writer.Append(value ? std::string_view{"true"} : std::string_view{"false"});
+    }
+    else if constexpr(std::is_same_v<T, char>)
+    {
+        writer.Push(value);
+    }
+    else if constexpr(std::is_arithmetic_v<T>)
+    {
+        char digits[64];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        writer.Append(std::string_view{digits, static_cast<std::size_t>(result.ptr - digits)});
+    }
+    else if constexpr(FormatNamedEnum<T>)
+    {
+        writer.Append(std::string_view{FormatEnumName(value)});
+    }
+    else if constexpr(std::is_enum_v<T>)
+    {
+        WriteArgument(writer, static_cast<std::underlying_type_t<T>>(value));
+    }
+    else if constexpr(std::is_same_v<T, Time>)
+    {
+        std::int64_t nanoseconds = value.AsNanoseconds();
+        if(nanoseconds < 0)
+        {
+            writer.Push('-');
+            nanoseconds = -nanoseconds;
+        }
+        char digits[32];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), nanoseconds / 1000000000);
+        writer.Append(std::string_view{digits, static_cast<std::size_t>(result.ptr - digits)});
+        writer.Push('.');
+        std::int64_t fraction = nanoseconds % 1000000000;
+        for(std::int64_t divisor = 100000000; divisor > 0; divisor /= 10)
+        {
+            writer.Push(static_cast<char>('0' + fraction / divisor % 10));
+        }
+        writer.Push('s');
+    }
+}
+
+template<typename Writer, typename... Args>
+void WriteArgumentAt(Writer& writer, std::size_t index, const Args&... args)
+{
+    std::size_t current = 0;
+    ((current++ == index ? WriteArgument(writer, args) : void()), ...);
+}
+
+}
+
+//----------------------------------------------------------------------
+
+// Format string whose %N placeholders are parsed and checked against the
+// argument list at compile time.
+template<typename... Args>
+class FormatString
+{
+public:
+    template<typename String>
+        requires std::is_convertible_v<const String&, std::string_view>
+    consteval FormatString(const String& format) :
+        format_{format},
+        segments_{},
+        segment_count_{0},
+        literal_size_{0}
+    {
+        struct Collector
+        {
+            FormatString& target;
+            constexpr void Literal(std::size_t offset, std::size_t size)
+            {
+                if(size == 0) return;
+                Push(detail::FormatSegment{offset, size, detail::kFormatLiteral});
+                target.literal_size_ += size;
+            }
+            constexpr void Argument(std::size_t index)
+            {
+                Push(detail::FormatSegment{0, 0, index});
+            }
+            constexpr void Push(detail::FormatSegment segment)
+            {
+                if(target.segment_count_ >= detail::kMaxFormatSegments) detail::FormatStringError("format string has too many segments");
+                target.segments_[target.segment_count_++] = segment;
+            }
+        };
+        detail::ParseFormat<'%'>(format_, sizeof...(Args), true, Collector{*this});
+    }
+
+public:
+    constexpr std::string_view Get() const { return format_; }
+    constexpr std::size_t SegmentCount() const { return segment_count_; }
+    constexpr const detail::FormatSegment& Segment(std::size_t index) const { return segments_[index]; }
+    constexpr std::size_t LiteralSize() const { return literal_size_; }
+
+    template<typename Writer>
+    void Render(Writer& writer, const Args&... args) const
+    {
+        for(std::size_t i = 0; i < segment_count_; ++i)
+        {
+            const detail::FormatSegment& segment = segments_[i];
+            if(segment.argument == detail::kFormatLiteral) writer.Append(format_.substr(segment.offset, segment.size));
+            else detail::WriteArgumentAt(writer, segment.argument, args...);
+        }
+    }
+
+private:
+    std::string_view format_;
+    std::array<detail::FormatSegment, detail::kMaxFormatSegments> segments_;
+    std::size_t segment_count_;
+    std::size_t literal_size_;
+};
+
+template<typename... Args>
+using FormatStringFor = FormatString<std::type_identity_t<Args>...>;
+
+// Wraps a format string that is only known at run time
+template<char EscChar = '%'>
+struct RuntimeFormat
+{
+    std::string_view format;
+};
+
+//----------------------------------------------------------------------
+
+template<typename... Args>
+std::size_t FormattedSize(FormatStringFor<Args...> format, const Args&... args)
+{
+    static_assert((detail::FormatArgument<Args> && ...), "Unsupported format argument type");
+    detail::CountingWriter writer;
+    format.Render(writer, args...);
+    return writer.size;
+}
+
+template<typename... Args>
+std::size_t FormatTo(char* buffer, std::size_t capacity, FormatStringFor<Args...> format, const Args&... args)
+{
+    static_assert((detail::FormatArgument<Args> && ...), "Unsupported format argument type");
+    detail::SpanWriter writer{buffer, capacity};
+    format.Render(writer, args...);
+    return writer.size;
+}
+
+template<std::size_t kCapacity, typename... Args>
+std::size_t FormatTo(FormatBuffer<kCapacity>& buffer, FormatStringFor<Args...> format, const Args&... args)
+{
+    static_assert((detail::FormatArgument<Args> && ...), "Unsupported format argument type");
+    format.Render(buffer, args...);
+    return buffer.Size();
+}
+
+template<std::output_iterator<char> OutputIt, typename... Args>
+OutputIt FormatTo(OutputIt out, FormatStringFor<Args...> format, const Args&... args)
+{
+    static_assert((detail::FormatArgument<Args> && ...), "Unsupported format argument type");
+    detail::IteratorWriter<OutputIt> writer{out};
+    format.Render(writer, args...);
+    return writer.out;
+}
+
+template<typename... Args>
+void FormatTo(std::string& out, FormatStringFor<Args...> format, const Args&... args)
+{
+    std::size_t offset = out.size();
+    out.resize(offset + FormattedSize<Args...>(format, args...));
+    FormatTo<Args...>(out.data() + offset, out.size() - offset, format, args...);
 }
 
+template<typename... Args>
+std::string Format(FormatStringFor<Args...> format, const Args&... args)
+{
+    std::string result;
+    FormatTo<Args...>(result, format, args...);
+    return result;
+}
 
+template<char EscChar, typename... Args>
+std::string Format(RuntimeFormat<EscChar> format, const Args&... args)
+{
+    static_assert((detail::FormatArgument<Args> && ...), "Unsupported format argument type");
+    struct Appender
+    {
+        detail::IteratorWriter<std::back_insert_iterator<std::string>> writer;
+        std::string_view format;
+        std::tuple<const Args&...> args;
+        void Literal(std::size_t offset, std::size_t size) { writer.Append(format.substr(offset, size)); }
+        void Argument(std::size_t index)
+        {
+            std::apply([&](const Args&... values) { detail::WriteArgumentAt(writer, index, values...); }, args);
+        }
+    };
+    std::string result;
+    result.reserve(format.format.size());
+    detail::ParseFormat<EscChar>(format.format, sizeof...(Args), false, Appender{{std::back_inserter(result)}, format.format, {args...}});
+    return result;
+}
 
 }
-#endif
\ No newline at end of file
+#endif
@@ -7,6 +7,11 @@
 #include <memory>
 
 #include "format.h"
+#include "logging/timestamp.h"
+
+#ifndef RUTHEN_MIN_LOG_LEVEL
+#define RUTHEN_MIN_LOG_LEVEL 0
+#endif
 
 namespace ruthen
 {
@@ -26,11 +31,10 @@ public:
     };
     struct LogDetails
     {
-        std::string time_string;
+        logging::TimestampText time_string;
         std::int64_t since_epoch_nano;
         std::string name;
         LogLevel level;
-        std::string destination;
         std::string formated_message;
     };
 
@@ -47,9 +51,9 @@ public:
     void SetName(const std::string& name);
     void SetLevel(LogLevel level);
     bool WriteLogDetailsToFile(const std::string& file_name);
+    // Hides the details logged so far by this logger. The flight recorder
+    // and its dumps, which other loggers share, keep them.
     void ClearLogDetails();
-    void SetLogDetailsLimit(std::size_t stack_limit);
-    void EraseLogDetails(std::size_t index_from_top);
     void SwitchLogDetailsRecognition(bool flag);
     
     bool Log(const std::string& file_name, const std::string& message);
@@ -57,36 +61,78 @@ public:
 
 public:
     std::string GetName() const;
+    bool ShouldLog(LogLevel level) const { return level >= RUTHEN_MIN_LOG_LEVEL && level >= level_; }
     bool LogDetailsEmpty() const;
-    const LogDetails& GetLogDetails(std::size_t index_from_top) const;
-    const LogDetails& GetLastLogDetails() const;
-    const LogDetails& GetOldestLogDetails() const;
+    // Details are taken from the process-wide flight recorder, which only
+    // keeps the most recent messages
+    LogDetails GetLogDetails(std::size_t index_from_top) const;
+    LogDetails GetLastLogDetails() const;
+    LogDetails GetOldestLogDetails() const;
+
+private:
+    bool FindLogDetails(std::size_t index, bool newest_first, LogDetails* details) const;
 
 private:
     LogLevel level_;
     std::string logger_name_;
     bool log_details_recognition_flag_;
-    std::size_t log_details_stack_limit_;
-    std::vector<LogDetails> log_details_;
+    std::uint64_t details_cleared_at_;
 };
 
 extern std::shared_ptr<Logger> SystemLogger;
 
-#define SYSLOGF_TRACE(format, ...)    ruthen::SystemLogger->Log(ruthen::Logger::kTrace,    "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-#define SYSLOGF_DEBUG(format, ...)    ruthen::SystemLogger->Log(ruthen::Logger::kDebug,    "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-#define SYSLOGF_INFO(format, ...)     ruthen::SystemLogger->Log(ruthen::Logger::kInfo,     "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-#define SYSLOGF_WARN(format, ...)     ruthen::SystemLogger->Log(ruthen::Logger::kWarn,     "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-#define SYSLOGF_ERROR(format, ...)    ruthen::SystemLogger->Log(ruthen::Logger::kError,    "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-#define SYSLOGF_CRITICAL(format, ...) ruthen::SystemLogger->Log(ruthen::Logger::kCritical, "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-#define SYSLOGF_CRASH(format, ...)    ruthen::SystemLogger->Log(ruthen::Logger::kCrash,    "syslogs.txt", ::ruthen::Format(format, __VA_ARGS__))
-
-#define SYSLOG_TRACE(message)    ruthen::SystemLogger->Log(ruthen::Logger::kTrace,    "syslogs.txt", message)
-#define SYSLOG_DEBUG(message)    ruthen::SystemLogger->Log(ruthen::Logger::kDebug,    "syslogs.txt", message)
-#define SYSLOG_INFO(message)     ruthen::SystemLogger->Log(ruthen::Logger::kInfo,     "syslogs.txt", message)
-#define SYSLOG_WARN(message)     ruthen::SystemLogger->Log(ruthen::Logger::kWarn,     "syslogs.txt", message)
-#define SYSLOG_ERROR(message)    ruthen::SystemLogger->Log(ruthen::Logger::kError,    "syslogs.txt", message)
-#define SYSLOG_CRITICAL(message) ruthen::SystemLogger->Log(ruthen::Logger::kCritical, "syslogs.txt", message)
-#define SYSLOG_CRASH(message)    ruthen::SystemLogger->Log(ruthen::Logger::kCrash,    "syslogs.txt", message)
+// Arguments are only evaluated when the level passes both the compile-time
+// RUTHEN_MIN_LOG_LEVEL and the runtime level of the system logger.
+#define RUTHEN_SYSLOGF(level, format, ...) \
+    do { if (ruthen::SystemLogger->ShouldLog(level)) ruthen::SystemLogger->Log(level, "syslogs.txt", ::ruthen::Format(format __VA_OPT__(,) __VA_ARGS__)); } while(0)
+#define RUTHEN_SYSLOG(level, message) \
+    do { if (ruthen::SystemLogger->ShouldLog(level)) ruthen::SystemLogger->Log(level, "syslogs.txt", message); } while(0)
+#define RUTHEN_SYSLOG_DISABLED() do {} while(0)
+
+#if RUTHEN_MIN_LOG_LEVEL <= 0
+#define SYSLOGF_TRACE(format, ...)    RUTHEN_SYSLOGF(ruthen::Logger::kTrace, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_TRACE(message)        RUTHEN_SYSLOG(ruthen::Logger::kTrace, message)
+#else
+#define SYSLOGF_TRACE(format, ...)    RUTHEN_SYSLOG_DISABLED()
+#define SYSLOG_TRACE(message)        RUTHEN_SYSLOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 1
+#define SYSLOGF_DEBUG(format, ...)    RUTHEN_SYSLOGF(ruthen::Logger::kDebug, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_DEBUG(message)        RUTHEN_SYSLOG(ruthen::Logger::kDebug, message)
+#else
+#define SYSLOGF_DEBUG(format, ...)    RUTHEN_SYSLOG_DISABLED()
+#define SYSLOG_DEBUG(message)        RUTHEN_SYSLOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 2
+#define SYSLOGF_INFO(format, ...)     RUTHEN_SYSLOGF(ruthen::Logger::kInfo, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_INFO(message)         RUTHEN_SYSLOG(ruthen::Logger::kInfo, message)
+#else
+#define SYSLOGF_INFO(format, ...)     RUTHEN_SYSLOG_DISABLED()
+#define SYSLOG_INFO(message)         RUTHEN_SYSLOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 3
+#define SYSLOGF_WARN(format, ...)     RUTHEN_SYSLOGF(ruthen::Logger::kWarn, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_WARN(message)         RUTHEN_SYSLOG(ruthen::Logger::kWarn, message)
+#else
+#define SYSLOGF_WARN(format, ...)     RUTHEN_SYSLOG_DISABLED()
+#define SYSLOG_WARN(message)         RUTHEN_SYSLOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 4
+#define SYSLOGF_ERROR(format, ...)    RUTHEN_SYSLOGF(ruthen::Logger::kError, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_ERROR(message)        RUTHEN_SYSLOG(ruthen::Logger::kError, message)
+#else
+#define SYSLOGF_ERROR(format, ...)    RUTHEN_SYSLOG_DISABLED()
+#define SYSLOG_ERROR(message)        RUTHEN_SYSLOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 5
+#define SYSLOGF_CRITICAL(format, ...) RUTHEN_SYSLOGF(ruthen::Logger::kCritical, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_CRITICAL(message)     RUTHEN_SYSLOG(ruthen::Logger::kCritical, message)
+#else
+#define SYSLOGF_CRITICAL(format, ...) RUTHEN_SYSLOG_DISABLED()
+#define SYSLOG_CRITICAL(message)     RUTHEN_SYSLOG_DISABLED()
+#endif
+#define SYSLOGF_CRASH(format, ...)    RUTHEN_SYSLOGF(ruthen::Logger::kCrash, format __VA_OPT__(,) __VA_ARGS__)
+#define SYSLOG_CRASH(message)        RUTHEN_SYSLOG(ruthen::Logger::kCrash, message)
 
 #define SYSLOG_WRITE_DETAILS()       ruthen::SystemLogger->WriteLogDetailsToFile("syslogs_details.txt")
 #define SYSLOG_CLEAR_DETAILS()       ruthen::SystemLogger->ClearLogDetails();
@@ -0,0 +1,103 @@
+#ifndef RUTHEN_ASYNC_WRITER_H
+#define RUTHEN_ASYNC_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logging/log_record.h"
+#include "logging/ring_buffer.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+enum class OverflowPolicy : int
+{
+    kBlock = 0,
+    kDrop,
+    kOverwrite
+};
+
+struct AsyncConfig
+{
+    std::size_t queue_capacity = 8192;
+    std::size_t batch_size = 256;
+    OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+    std::chrono::milliseconds flush_interval{100};
+};
+
+//----------------------------------------------------------------------
+
+class LogOutput
+{
+public:
+    virtual ~LogOutput() = default;
+
+public:
+    virtual void Write(const LogEntry* entries, std::size_t count) = 0;
+    virtual void Flush() = 0;
+};
+
+//----------------------------------------------------------------------
+
+class AsyncWriter
+{
+public:
+    AsyncWriter(const AsyncConfig& config, LogOutput& output);
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+    ~AsyncWriter();
+
+public:
+    void Start();
+    void Stop();
+    bool Push(const LogEntry& entry);
+    void Flush();
+
+public:
+    [[nodiscard]] bool IsRunning() const;
+    [[nodiscard]] std::uint64_t DroppedCount() const;
+    [[nodiscard]] std::uint64_t OverwrittenCount() const;
+    [[nodiscard]] const AsyncConfig& GetConfig() const;
+
+private:
+    void Run();
+    void WakeWriter();
+    bool DiscardOldest();
+
+private:
+    AsyncConfig config_;
+    LogOutput& output_;
+    RingBuffer<LogRecord> queue_;
+    std::vector<LogEntry> batch_;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_condition_;
+    std::condition_variable flush_condition_;
+    std::atomic<bool> running_;
+    std::atomic<bool> stop_requested_;
+    std::atomic<bool> writer_sleeping_;
+    std::atomic<std::size_t> flush_requests_;
+    std::atomic<std::size_t> written_position_;
+    std::atomic<std::uint64_t> dropped_;
+    std::atomic<std::uint64_t> overwritten_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef RUTHEN_BINARY_LOG_H
+#define RUTHEN_BINARY_LOG_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "format.h"
+#include "clock.h"
+#include "logging/log_types.h"
+#include "logging/log_record.h"
+#include "logging/file_sink.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Binary log files start with kBinaryLogMagic followed by a sequence of
+// frames: a one byte FrameKind, a 32-bit payload size and the payload.
+// Integers are stored in native byte order.
+constexpr char kBinaryLogMagic[8] = {'R', 'U', 'B', 'L', 'O', 'G', '0', '1'};
+
+enum class FrameKind : std::uint8_t
+{
+    kLogger = 1,
+    kFormat,
+    kRecord
+};
+
+struct FormatInfo
+{
+    FormatID id;
+    LogLevel level;
+    std::uint32_t line;
+    std::string format;
+    std::string destination;
+    std::string file;
+    std::string signature;
+};
+
+// Registered formats are never moved or removed, call sites keep the
+// pointer. Lookups by id take no lock. Returns nullptr once kMaxFormats
+// formats are registered.
+constexpr std::size_t kMaxFormats = std::size_t{1} << 18;
+
+const FormatInfo* RegisterFormat(std::string_view format, std::string_view destination, LogLevel level,
+                                 std::string_view file, std::uint32_t line, std::string_view signature);
+const FormatInfo* FindFormat(FormatID id);
+std::string DecodeMessage(std::string_view format, std::string_view signature, std::string_view arguments);
+
+//----------------------------------------------------------------------
+
+template<typename... Args>
+struct ArgumentList
+{};
+
+// Only used inside decltype() so that call site arguments are never evaluated
+template<typename... Args>
+ArgumentList<std::decay_t<Args>...> DeduceArguments(const Args&...);
+
+template<typename T>
+constexpr char ArgumentCode()
+{
+    if constexpr(std::is_same_v<T, bool>) return 'b';
+    else if constexpr(std::is_same_v<T, char>) return 'c';
+    else if constexpr(std::is_same_v<T, Time>) return 't';
+    else if constexpr(ruthen::detail::FormatStringLike<T> || ruthen::detail::FormatNamedEnum<T>) return 's';
+    else if constexpr(std::is_enum_v<T>) return std::is_signed_v<std::underlying_type_t<T>> ? 'i' : 'u';
+    else if constexpr(std::is_floating_point_v<T>) return 'd';
+    else if constexpr(std::is_integral_v<T>) return std::is_signed_v<T> ? 'i' : 'u';
+    else return '?';
+}
+
+template<typename... Args>
+struct ArgumentSignature
+{
+    static_assert(((ArgumentCode<Args>() != '?') && ...), "Unsupported binary log argument type");
+    constexpr static char kValue[sizeof...(Args) + 1] = {ArgumentCode<Args>()..., '\0'};
+};
+
+template<typename... Args>
+const FormatInfo* RegisterCallSite(ArgumentList<Args...>, FormatStringFor<Args...> format, std::string_view destination,
+                                   LogLevel level, std::string_view file, std::uint32_t line)
+{
+    return RegisterFormat(format.Get(), destination, level, file, line, ArgumentSignature<Args...>::kValue);
+}
+
+//----------------------------------------------------------------------
+
+namespace detail
+{
+
+template<typename T>
+void Store(char* buffer, std::size_t& size, const T& value)
+{
+    std::memcpy(buffer + size, &value, sizeof(T));
+    size += sizeof(T);
+}
+
+template<typename T>
+void EncodeArgument(char* buffer, std::size_t capacity, std::size_t& size, const T& value)
+{
+    constexpr char kCode = ArgumentCode<T>();
+    if constexpr(kCode == 's')
+    {
+        std::string_view text;
+        if constexpr(ruthen::detail::FormatNamedEnum<T>) text = FormatEnumName(value);
+        else text = std::string_view{value};
+        if(size + sizeof(std::uint32_t) > capacity) return;
+        std::uint32_t length = static_cast<std::uint32_t>(std::min(text.size(), capacity - size - sizeof(std::uint32_t)));
+        Store(buffer, size, length);
+        std::memcpy(buffer + size, text.data(), length);
+        size += length;
+        return;
+    }
+    else
+    {
+        constexpr std::size_t kSize = kCode == 'b' || kCode == 'c' ? 1 : 8;
+        if(size + kSize > capacity) return;
+        if constexpr(kCode == 'b' || kCode == 'c') Store(buffer, size, static_cast<char>(value));
+        else if constexpr(kCode == 't') Store(buffer, size, static_cast<std::int64_t>(value.AsNanoseconds()));
+        else if constexpr(kCode == 'd') Store(buffer, size, static_cast<double>(value));
+        else if constexpr(kCode == 'i') Store(buffer, size, static_cast<std::int64_t>(value));
+        else Store(buffer, size, static_cast<std::uint64_t>(value));
+    }
+}
+
+}
+
+template<typename... Args>
+std::size_t EncodeArguments([[maybe_unused]] char* buffer, [[maybe_unused]] std::size_t capacity, const Args&... args)
+{
+    std::size_t size = 0;
+    (detail::EncodeArgument(buffer, capacity, size, args), ...);
+    return size;
+}
+
+//----------------------------------------------------------------------
+
+// Writes binary frames into a single, non-rotating file. Format and logger
+// definitions are emitted before the first record that refers to them.
+class BinaryLogWriter
+{
+public:
+    explicit BinaryLogWriter(const std::string& path);
+    BinaryLogWriter(const BinaryLogWriter&) = delete;
+    BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+    ~BinaryLogWriter();
+
+public:
+    void DefineLogger(LoggerID id, std::string_view name);
+    void Write(const LogEntry& entry);
+    void Flush();
+
+public:
+    [[nodiscard]] const std::string& GetPath() const;
+
+private:
+    void WriteFrame(FrameKind kind, std::int64_t timestamp);
+
+private:
+    std::mutex mutex_;
+    FileSink sink_;
+    std::vector<bool> defined_formats_;
+    std::string payload_;
+    std::string frame_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#define RUTHEN_LOG_BINARY(logger, filename, level, format, ...)                                                        \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        const auto& ruthen_logger_ = (logger);                                                                         \
+        if ((level) < ::ruthen::kMinLogLevel || !ruthen_logger_.ShouldLog(level)) break;                               \
+        static const ::ruthen::logging::FormatInfo* const ruthen_format_ = ::ruthen::logging::RegisterCallSite(        \
+            decltype(::ruthen::logging::DeduceArguments(__VA_ARGS__)){}, format, filename, level, __FILE__, __LINE__); \
+        ruthen_logger_.LogBinary(ruthen_format_, level __VA_OPT__(,) __VA_ARGS__);                                     \
+    } while(0)
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef RUTHEN_COMPRESSION_H
+#define RUTHEN_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logging/log_index.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// LZ77 block codec in the spirit of LZ4: a sequence is a token byte with
+// the literal length in the high and the match length in the low nibble,
+// the literals, a 16-bit match offset and the length extensions. Blocks
+// are independent, matches never reach into a previous block.
+constexpr std::size_t kCompressedBlockSize = 64 * 1024;
+
+std::size_t CompressBound(std::size_t size);
+// Returns the compressed size, 0 if it does not fit into the destination
+std::size_t CompressBlock(const char* source, std::size_t size, char* destination, std::size_t capacity);
+// Returns the decompressed size, 0 on malformed input
+std::size_t DecompressBlock(const char* source, std::size_t size, char* destination, std::size_t capacity);
+
+//----------------------------------------------------------------------
+
+// Compressed log file layout:
+//   magic "RULZ0001"
+//   blocks, stored as is when compression does not pay off
+//   index, one CompressedBlock per block
+//   footer: u64 index offset, u32 block count, u32 reserved, "RULZIDX1"
+// The index is at the end so files are written in a single pass, readers
+// find it through the fixed-size footer.
+constexpr char kCompressedLogMagic[8] = {'R', 'U', 'L', 'Z', '0', '0', '0', '1'};
+constexpr char kCompressedIndexMagic[8] = {'R', 'U', 'L', 'Z', 'I', 'D', 'X', '1'};
+constexpr std::string_view kCompressedLogExtension = ".rlz";
+
+struct CompressedBlock
+{
+    std::uint64_t offset;
+    std::uint32_t raw_size;
+    std::uint32_t stored_size;
+    std::int64_t first_timestamp;
+    std::int64_t last_timestamp;
+    std::uint64_t logger_mask;
+    std::uint32_t level_mask;
+};
+
+// Compresses the file at path into output. Blocks never straddle a mark,
+// so each one carries the summary of the mark it was cut from.
+bool CompressLogFile(const std::string& path, const std::vector<TimeMark>& marks, const std::string& output);
+
+//----------------------------------------------------------------------
+
+class CompressedLogReader
+{
+public:
+    explicit CompressedLogReader(const std::string& path);
+    CompressedLogReader(const CompressedLogReader&) = delete;
+    CompressedLogReader& operator=(const CompressedLogReader&) = delete;
+    ~CompressedLogReader();
+
+public:
+    void ReadBlock(std::size_t index, std::string& out) const;
+    // Appends every block whose time range overlaps [from, to]
+    void ReadRange(std::int64_t from, std::int64_t to, std::string& out) const;
+
+public:
+    [[nodiscard]] const std::vector<CompressedBlock>& GetBlocks() const;
+
+private:
+    int descriptor_;
+    std::vector<CompressedBlock> blocks_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
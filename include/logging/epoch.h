@@ -0,0 +1,43 @@
+#ifndef RUTHEN_EPOCH_H
+#define RUTHEN_EPOCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Process-wide epochs for structures that are read without a lock. A
+// reader holds an EpochGuard while it uses something a writer may replace.
+// The writer unpublishes the old object, retires it under the epoch that
+// AdvanceEpoch() returns and frees it once OldestActiveEpoch() is greater.
+//
+// Guards nest and are cheap: one store to a slot owned by the thread.
+// Threads beyond kMaxEpochReaders share a counter that blocks reclamation
+// while any of them is inside a guard.
+constexpr std::size_t kMaxEpochReaders = 256;
+
+class EpochGuard
+{
+public:
+    EpochGuard();
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+    ~EpochGuard();
+};
+
+std::uint64_t AdvanceEpoch();
+std::uint64_t OldestActiveEpoch();
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef RUTHEN_FILE_SINK_H
+#define RUTHEN_FILE_SINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "logging/log_record.h"
+#include "logging/async_writer.h"
+#include "logging/compression.h"
+#include "logging/log_index.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+enum class SinkKind
+{
+    kFile,
+    kMapped
+};
+
+struct SinkConfig
+{
+    SinkKind kind = SinkKind::kFile;
+    std::size_t buffer_size = 64 * 1024;
+    std::uint64_t rotate_size = 0;
+    std::chrono::seconds rotate_interval{0};
+    std::chrono::milliseconds flush_interval{1000};
+    std::uint64_t segment_size = 64 * 1024 * 1024;
+    // Rotated segments are handed to the rotation handler for compression
+    bool compress_rotated = false;
+    // Keeps a sparse time and logger index in "path.idx"
+    bool write_index = true;
+};
+
+// Called with the path of every rotated segment and the time marks of its
+// contents when the sink compresses rotated segments
+typedef std::function<void(const std::string& path, std::vector<TimeMark> marks)> RotationHandler;
+
+//----------------------------------------------------------------------
+
+class LogSink
+{
+public:
+    virtual ~LogSink() = default;
+
+public:
+    // The entry is only read for its timestamp, logger and level
+    virtual void Write(std::string_view text, const LogEntry& entry) = 0;
+    virtual void Flush() = 0;
+    virtual void SetConfig(const SinkConfig& config) = 0;
+
+public:
+    [[nodiscard]] virtual const std::string& GetPath() const = 0;
+    [[nodiscard]] virtual SinkKind GetKind() const = 0;
+    // Thread-safe sinks are written without SinkTable serializing the calls
+    [[nodiscard]] virtual bool IsThreadSafe() const { return false; }
+};
+
+std::unique_ptr<LogSink> MakeSink(const std::string& path, const SinkConfig& config, RotationHandler rotation_handler = {});
+// First unused "path.N", N starting at 1, compressed segments included
+std::string NextRotatedPath(const std::string& path);
+
+//----------------------------------------------------------------------
+
+// Append-only log file which stays open for its whole lifetime. Writes are
+// collected in a userspace buffer and handed to the kernel with writev once
+// the buffer fills up or Flush() is called. Not thread-safe on its own.
+class FileSink : public LogSink
+{
+public:
+    FileSink(const std::string& path, const SinkConfig& config, RotationHandler rotation_handler = {});
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    ~FileSink() override;
+
+public:
+    void Write(std::string_view text, const LogEntry& entry) override;
+    // Raw bytes, not described in the index
+    void Write(std::string_view bytes, std::int64_t timestamp);
+    void Flush() override;
+    void Rotate(std::int64_t timestamp);
+    void SetConfig(const SinkConfig& config) override;
+
+public:
+    [[nodiscard]] const std::string& GetPath() const override;
+    [[nodiscard]] SinkKind GetKind() const override;
+    [[nodiscard]] std::uint64_t GetFileSize() const;
+    [[nodiscard]] bool IsOpen() const;
+
+private:
+    void Open(std::int64_t timestamp);
+    void Close();
+    void WriteOut(std::string_view tail);
+    bool ShouldRotate(std::size_t incoming, std::int64_t timestamp) const;
+    void Mark(std::size_t incoming, const LogEntry& entry);
+    void FinishMark();
+
+private:
+    std::string path_;
+    SinkConfig config_;
+    RotationHandler rotation_handler_;
+    LogIndexWriter index_;
+    TimeMark mark_;
+    bool has_mark_;
+    // Finished marks of the current segment, only kept for compression
+    std::vector<TimeMark> marks_;
+    int descriptor_;
+    std::vector<char> buffer_;
+    std::size_t buffered_;
+    std::uint64_t file_size_;
+    std::int64_t opened_at_;
+    std::int64_t flushed_at_;
+};
+
+class BinaryLogWriter;
+class SegmentCompressor;
+
+//----------------------------------------------------------------------
+
+// Table of sinks keyed by destination name. Entries carrying a binary
+// format id go to the binary log when one is open and are decoded to text
+// otherwise.
+class SinkTable : public LogOutput
+{
+public:
+    explicit SinkTable(const SinkConfig& default_config = {});
+    SinkTable(const SinkTable&) = delete;
+    SinkTable& operator=(const SinkTable&) = delete;
+    ~SinkTable() override;
+
+public:
+    void Write(const LogEntry* entries, std::size_t count) override;
+    void Flush() override;
+    void SetDefaultConfig(const SinkConfig& config);
+    void Configure(const std::string& destination, const SinkConfig& config);
+    void CloseAll();
+    void OpenBinaryLog(const std::string& path);
+    void CloseBinaryLog();
+    void DefineLogger(LoggerID id, std::string_view name);
+
+public:
+    [[nodiscard]] std::size_t SinkCount() const;
+    [[nodiscard]] bool HasBinaryLog() const;
+
+private:
+    struct SinkSlot
+    {
+        std::unique_ptr<LogSink> sink;
+        std::mutex mutex;
+    };
+    struct NameHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+private:
+    SinkSlot& GetSlot(std::string_view destination, std::shared_lock<std::shared_mutex>& lock);
+    RotationHandler MakeRotationHandler();
+
+private:
+    // Shared while writing, exclusive while sinks are created or replaced
+    mutable std::shared_mutex mutex_;
+    SinkConfig default_config_;
+    std::unordered_map<std::string, SinkConfig, NameHash, std::equal_to<>> configs_;
+    std::unordered_map<std::string, std::unique_ptr<SinkSlot>, NameHash, std::equal_to<>> sinks_;
+    std::unique_ptr<BinaryLogWriter> binary_log_;
+    // Started on the first rotated segment that needs compression
+    std::once_flag compressor_once_;
+    std::unique_ptr<SegmentCompressor> compressor_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
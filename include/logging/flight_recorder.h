@@ -0,0 +1,112 @@
+#ifndef RUTHEN_FLIGHT_RECORDER_H
+#define RUTHEN_FLIGHT_RECORDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "patterns/singleton.h"
+#include "logging/log_types.h"
+#include "logging/log_record.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Compact copy of a message. Names and messages are cut to fit.
+struct FlightRecord
+{
+    constexpr static std::size_t kNameCapacity = 24;
+    constexpr static std::size_t kMessageCapacity = 208;
+
+    std::int64_t timestamp;
+    std::uint64_t logger;
+    std::int32_t level;
+    std::uint16_t name_size;
+    std::uint16_t message_size;
+    char name[kNameCapacity];
+    char message[kMessageCapacity];
+};
+
+//----------------------------------------------------------------------
+
+// Process-wide ring of the most recent messages of every logger, the oldest
+// record is overwritten. Each slot is a seqlock made of relaxed atomic words,
+// so recording never blocks and reading is safe from a signal handler.
+class FlightRecorder : public patterns::Singleton<FlightRecorder>
+{
+public:
+    constexpr static std::size_t kCapacity = 1024;
+
+public:
+    FlightRecorder();
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+public:
+    void Record(std::int64_t timestamp, LoggerID logger, LogLevel level, std::string_view name, std::string_view message) noexcept;
+    void Clear() noexcept;
+    // Dumps the recorder into the file at path on fatal signals
+    bool InstallCrashHandlers(const char* path);
+    void SetEnabled(bool enabled) noexcept;
+
+public:
+    // Signal-safe. Copies records oldest first and returns their count.
+    std::size_t Snapshot(FlightRecord* records, std::size_t capacity) const noexcept;
+    // Reads records in place, from the ticket first on, until the visitor
+    // returns false. Nothing is copied beyond one record, signal-safe when
+    // the visitor is.
+    template<typename Visitor>
+    void Visit(std::uint64_t first, bool newest_first, Visitor&& visitor) const
+    {
+        std::uint64_t head = head_.load(std::memory_order_acquire);
+        std::uint64_t begin = std::max({first, cleared_.load(std::memory_order_acquire), head - std::min<std::uint64_t>(head, kCapacity)});
+        FlightRecord record;
+        for (std::uint64_t i = begin; i < head; ++i)
+        {
+            std::uint64_t ticket = newest_first ? head - 1 - (i - begin) : i;
+            if (Read(ticket, record) && !visitor(record)) return;
+        }
+    }
+    // Ticket of the next record, records from it on are newer than now
+    [[nodiscard]] std::uint64_t Head() const noexcept;
+    // Signal-safe. Writes the records as text lines into a file descriptor.
+    void Dump(int descriptor) const noexcept;
+    // Dumps to the crash log or stderr when none was installed
+    void DumpCrashLog(std::string_view reason = {}) const noexcept;
+    [[nodiscard]] bool IsEnabled() const noexcept;
+
+private:
+    constexpr static std::size_t kWords = sizeof(FlightRecord) / sizeof(std::uint64_t);
+    static_assert(sizeof(FlightRecord) % sizeof(std::uint64_t) == 0, "flight records must be made of whole words");
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "flight recorder capacity must be a power of two");
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence;
+        std::atomic<std::uint64_t> words[kWords];
+    };
+
+    bool Read(std::uint64_t ticket, FlightRecord& record) const noexcept;
+
+private:
+    std::atomic<std::uint64_t> head_;
+    std::atomic<std::uint64_t> cleared_;
+    std::atomic<bool> enabled_;
+    std::atomic<int> crash_descriptor_;
+    Slot slots_[kCapacity];
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef RUTHEN_LOG_INDEX_H
+#define RUTHEN_LOG_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logging/log_types.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Summary of a stretch of a log file: when it was written, which loggers
+// and levels appear in it. Logger names are folded into a 64-bit mask, so
+// a set bit only means the logger may be present.
+struct TimeMark
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::int64_t first_timestamp;
+    std::int64_t last_timestamp;
+    std::uint64_t logger_mask;
+    std::uint32_t level_mask;
+};
+
+// Sinks start a new mark about every this many bytes
+constexpr std::size_t kIndexInterval = 64 * 1024;
+
+std::uint64_t LoggerMaskBit(std::string_view name);
+std::uint32_t LevelMaskBit(LogLevel level);
+// A mark that matches every query, for stretches nobody summarized
+TimeMark UnknownMark(std::uint64_t offset, std::uint64_t size);
+void AddToMark(TimeMark& mark, std::int64_t timestamp, std::string_view logger, LogLevel level);
+
+//----------------------------------------------------------------------
+
+// Side index "path.idx" next to a log file: magic "RUIDX001" followed by
+// fixed-size marks in file order. Marks are appended once they are
+// complete, the part of the log after the last mark is not indexed.
+constexpr char kLogIndexMagic[8] = {'R', 'U', 'I', 'D', 'X', '0', '0', '1'};
+constexpr std::string_view kLogIndexExtension = ".idx";
+
+class LogIndexWriter
+{
+public:
+    LogIndexWriter();
+    LogIndexWriter(const LogIndexWriter&) = delete;
+    LogIndexWriter& operator=(const LogIndexWriter&) = delete;
+    ~LogIndexWriter();
+
+public:
+    bool Open(const std::string& path);
+    void Append(const TimeMark& mark);
+    void Close();
+
+public:
+    [[nodiscard]] bool IsOpen() const;
+
+private:
+    int descriptor_;
+};
+
+// Marks written for the log at path, empty when it has no index
+std::vector<TimeMark> ReadLogIndex(const std::string& path);
+// Writes a complete index in one go, used for segments indexed in memory
+bool WriteLogIndex(const std::string& path, const std::vector<TimeMark>& marks);
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef RUTHEN_LOG_RECORD_H
+#define RUTHEN_LOG_RECORD_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "logging/log_types.h"
+#include "logging/timestamp.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+// Non-owning view of a single log message
+struct LogEntry
+{
+    std::int64_t timestamp;
+    LoggerID logger;
+    LogLevel level;
+    std::string_view name;
+    std::string_view destination;
+    std::string_view message;
+    bool truncated;
+    FormatID format;
+};
+
+// Fixed-size copy of a LogEntry that can live inside a preallocated queue.
+// Messages which do not fit into the payload are truncated. Entries with a
+// non-zero format carry encoded binary arguments instead of message text.
+struct LogRecord
+{
+    constexpr static std::size_t kPayloadCapacity = 1024 - 32;
+
+    std::int64_t timestamp;
+    LoggerID logger;
+    LogLevel level;
+    FormatID format;
+    std::uint16_t name_size;
+    std::uint16_t destination_size;
+    std::uint16_t message_size;
+    bool truncated;
+    char payload[kPayloadCapacity];
+
+    void Assign(const LogEntry& entry);
+    LogEntry View() const;
+};
+
+void AppendEntryText(std::string& out, const LogEntry& entry);
+
+}
+
+}
+
+#endif
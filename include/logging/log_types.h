@@ -0,0 +1,59 @@
+#ifndef RUTHEN_LOG_TYPES_H
+#define RUTHEN_LOG_TYPES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Messages below this level are compiled out by the RUTHEN_LOG_* macros.
+// 0 keeps everything, 6 keeps only kCrash.
+#ifndef RUTHEN_MIN_LOG_LEVEL
+#define RUTHEN_MIN_LOG_LEVEL 0
+#endif
+
+namespace ruthen
+{
+
+enum LogLevel : int
+{
+    kTrace = 0,
+    kDebug,
+    kInfo,
+    kWarn,
+    kError,
+    kCritical,
+    kCrash
+};
+
+constexpr LogLevel kMinLogLevel = static_cast<LogLevel>(RUTHEN_MIN_LOG_LEVEL);
+
+typedef std::size_t LoggerID;
+
+namespace logging
+{
+typedef std::uint32_t FormatID;
+}
+
+constexpr std::string_view GetLevelName(LogLevel level)
+{
+    switch(level)
+    {
+        case LogLevel::kTrace:    return "Trace";
+        case LogLevel::kDebug:    return "Debug";
+        case LogLevel::kInfo:     return "Info";
+        case LogLevel::kWarn:     return "Warn";
+        case LogLevel::kError:    return "Error";
+        case LogLevel::kCritical: return "Critical";
+        case LogLevel::kCrash:    return "Crash";
+        default: return "Trace";
+    }
+}
+
+constexpr std::string_view FormatEnumName(LogLevel level)
+{
+    return GetLevelName(level);
+}
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef RUTHEN_MAPPED_SINK_H
+#define RUTHEN_MAPPED_SINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logging/file_sink.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Log file backed by a preallocated, shared memory mapping. Writers reserve
+// a byte range with a single fetch_add and copy their text straight into
+// the mapping, writeback is left to the page cache. The writer whose range
+// crosses the end of a segment closes it (truncated to its used size and
+// renamed like a rotated FileSink) and maps a fresh one in its place. The
+// file is never truncated below what it holds: when the rename fails the
+// next segment is appended to the same file.
+//
+// After a crash the file holds every completed record followed by zeros.
+class MappedFileSink : public LogSink
+{
+public:
+    MappedFileSink(const std::string& path, const SinkConfig& config, RotationHandler rotation_handler = {});
+    MappedFileSink(const MappedFileSink&) = delete;
+    MappedFileSink& operator=(const MappedFileSink&) = delete;
+    ~MappedFileSink() override;
+
+public:
+    void Write(std::string_view text, const LogEntry& entry) override;
+    void Flush() override;
+    void SetConfig(const SinkConfig& config) override;
+
+public:
+    [[nodiscard]] const std::string& GetPath() const override;
+    [[nodiscard]] SinkKind GetKind() const override;
+    [[nodiscard]] bool IsThreadSafe() const override;
+    [[nodiscard]] std::size_t SegmentCount() const;
+
+private:
+    // Summary of the entries starting in one kIndexInterval slice of a segment
+    struct Region
+    {
+        std::atomic<std::int64_t> first_timestamp{std::numeric_limits<std::int64_t>::max()};
+        std::atomic<std::int64_t> last_timestamp{std::numeric_limits<std::int64_t>::min()};
+        std::atomic<std::uint64_t> logger_mask{0};
+        std::atomic<std::uint32_t> level_mask{0};
+    };
+
+    // Starts at base in the file, the mapping begins at the page below it
+    struct Segment
+    {
+        int descriptor = -1;
+        char* mapping = nullptr;
+        std::uint64_t mapping_size = 0;
+        char* data = nullptr;
+        std::uint64_t base = 0;
+        std::uint64_t size = 0;
+        std::atomic<std::uint64_t> reserved{0};
+        std::atomic<std::uint64_t> committed{0};
+        std::unique_ptr<Region[]> regions;
+        // Marks of what the file held before base
+        std::vector<TimeMark> marks;
+        std::uint64_t retired_epoch = 0;
+    };
+
+private:
+    Segment* OpenSegment(std::vector<TimeMark> marks);
+    void CloseSegment(Segment& segment, std::uint64_t used);
+    void Reclaim();
+    void Rollover(Segment* segment, std::uint64_t used);
+    void Stamp(Segment& segment, std::uint64_t offset, const LogEntry& entry);
+    [[nodiscard]] std::vector<TimeMark> CollectMarks(const Segment& segment, std::uint64_t used) const;
+
+private:
+    std::string path_;
+    std::atomic<std::uint64_t> segment_size_;
+    std::atomic<bool> compress_rotated_;
+    std::atomic<bool> write_index_;
+    RotationHandler rotation_handler_;
+    mutable std::mutex mutex_;
+    std::atomic<Segment*> current_;
+    // The current segment last. Retired ones stay allocated until no writer
+    // that could have loaded them is left.
+    std::vector<std::unique_ptr<Segment>> segments_;
+    std::size_t segment_count_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
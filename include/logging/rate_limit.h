@@ -0,0 +1,86 @@
+#ifndef RUTHEN_RATE_LIMIT_H
+#define RUTHEN_RATE_LIMIT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+enum class LimitPolicy : std::uint8_t
+{
+    kPerSecond,
+    kEveryN,
+    kFirstN
+};
+
+//----------------------------------------------------------------------
+
+// State of a single rate limited call site, meant to be a function-local
+// static. The constructor is constexpr so the state is constant initialized
+// and the check never goes through a static guard. Sites link themselves
+// into a process-wide list the first time they are reached.
+class LogLimiter
+{
+public:
+    constexpr LogLimiter(LimitPolicy policy, std::uint32_t limit, const char* file, int line) noexcept :
+        policy_{policy},
+        limit_{limit > 0 ? limit : 1},
+        file_{file},
+        line_{line},
+        state_{0},
+        suppressed_{0},
+        linked_{false},
+        next_{nullptr}
+    {}
+    LogLimiter(const LogLimiter&) = delete;
+    LogLimiter& operator=(const LogLimiter&) = delete;
+
+public:
+    // Lock-free, returns false and counts the message when it is suppressed
+    bool Allow() noexcept;
+    std::uint64_t TakeSuppressed() noexcept;
+
+public:
+    [[nodiscard]] LimitPolicy GetPolicy() const noexcept;
+    [[nodiscard]] const char* GetFile() const noexcept;
+    [[nodiscard]] int GetLine() const noexcept;
+    [[nodiscard]] LogLimiter* GetNext() const noexcept;
+
+private:
+    bool AllowPerSecond() noexcept;
+    void Link() noexcept;
+
+private:
+    LimitPolicy policy_;
+    std::uint32_t limit_;
+    const char* file_;
+    int line_;
+    // Occurrence count, the per second policy keeps the second in the upper half
+    std::atomic<std::uint64_t> state_;
+    std::atomic<std::uint64_t> suppressed_;
+    std::atomic<bool> linked_;
+    LogLimiter* next_;
+};
+
+//----------------------------------------------------------------------
+
+// Collects the counts suppressed since the last call into one line such as
+// "Suppressed messages: main.cpp:40 x12, core.cpp:7 x3". Returns an empty
+// string when nothing was suppressed.
+std::string TakeSuppressedSummary();
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
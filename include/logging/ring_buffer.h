@@ -0,0 +1,163 @@
+#ifndef RUTHEN_RING_BUFFER_H
+#define RUTHEN_RING_BUFFER_H
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Every cell carries a
+// sequence number, so producers and consumers only contend on the position
+// counters and never take a lock. Consumers claim a run of ready cells at
+// once and hand them back with Release(), which lets the reader work on the
+// stored values in place.
+template<typename T>
+class RingBuffer
+{
+public:
+    struct Batch
+    {
+        std::size_t position;
+        std::size_t count;
+    };
+
+public:
+    explicit RingBuffer(std::size_t capacity);
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    ~RingBuffer() = default;
+
+public:
+    template<typename Fill>
+    bool TryPush(Fill&& fill);
+    Batch Claim(std::size_t max_count);
+    T& At(const Batch& batch, std::size_t index);
+    void Release(const Batch& batch);
+
+public:
+    std::size_t Capacity() const;
+    std::size_t WritePosition() const;
+    std::size_t ReadPosition() const;
+    bool Empty() const;
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+private:
+    std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<std::size_t> enqueue_position_;
+    alignas(64) std::atomic<std::size_t> dequeue_position_;
+};
+
+template<typename T>
+RingBuffer<T>::RingBuffer(std::size_t capacity) :
+    mask_{0},
+    cells_{nullptr},
+    enqueue_position_{0},
+    dequeue_position_{0}
+{
+    if(capacity < 2 || (capacity & (capacity - 1)) != 0) throw std::invalid_argument{"ring buffer capacity must be a power of two"};
+    mask_ = capacity - 1;
+    cells_ = std::make_unique<Cell[]>(capacity);
+    for(std::size_t i = 0; i < capacity; ++i)
+    {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+template<typename Fill>
+bool RingBuffer<T>::TryPush(Fill&& fill)
+{
+    std::size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    while(true)
+    {
+        cell = &cells_[position & mask_];
+        std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if(difference == 0)
+        {
+            if(enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        }
+        else if(difference < 0) return false;
+        else position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+    fill(cell->value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+typename RingBuffer<T>::Batch RingBuffer<T>::Claim(std::size_t max_count)
+{
+    std::size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    while(true)
+    {
+        std::size_t count = 0;
+        while(count < max_count && count <= mask_)
+        {
+            const Cell& cell = cells_[(position + count) & mask_];
+            if(cell.sequence.load(std::memory_order_acquire) != position + count + 1) break;
+            ++count;
+        }
+        if(count == 0) return Batch{position, 0};
+        if(dequeue_position_.compare_exchange_weak(position, position + count, std::memory_order_relaxed)) return Batch{position, count};
+    }
+}
+
+template<typename T>
+T& RingBuffer<T>::At(const Batch& batch, std::size_t index)
+{
+    return cells_[(batch.position + index) & mask_].value;
+}
+
+template<typename T>
+void RingBuffer<T>::Release(const Batch& batch)
+{
+    for(std::size_t i = 0; i < batch.count; ++i)
+    {
+        cells_[(batch.position + i) & mask_].sequence.store(batch.position + i + mask_ + 1, std::memory_order_release);
+    }
+}
+
+template<typename T>
+std::size_t RingBuffer<T>::Capacity() const
+{
+    return mask_ + 1;
+}
+
+template<typename T>
+std::size_t RingBuffer<T>::WritePosition() const
+{
+    return enqueue_position_.load(std::memory_order_acquire);
+}
+
+template<typename T>
+std::size_t RingBuffer<T>::ReadPosition() const
+{
+    return dequeue_position_.load(std::memory_order_acquire);
+}
+
+template<typename T>
+bool RingBuffer<T>::Empty() const
+{
+    return ReadPosition() >= WritePosition();
+}
+
+}
+
+}
+
+#endif
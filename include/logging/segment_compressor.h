@@ -0,0 +1,73 @@
+#ifndef RUTHEN_SEGMENT_COMPRESSOR_H
+#define RUTHEN_SEGMENT_COMPRESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logging/compression.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Compresses finished log segments on a background thread running at idle
+// priority. A segment "path" becomes "path.rlz" and the original is removed
+// once the compressed file is complete. Pending segments are still
+// compressed when the compressor is destroyed.
+class SegmentCompressor
+{
+public:
+    SegmentCompressor();
+    SegmentCompressor(const SegmentCompressor&) = delete;
+    SegmentCompressor& operator=(const SegmentCompressor&) = delete;
+    ~SegmentCompressor();
+
+public:
+    void Enqueue(const std::string& path, std::vector<TimeMark> marks);
+    // Blocks until every segment queued so far is done
+    void Drain();
+
+public:
+    [[nodiscard]] std::uint64_t CompressedCount() const;
+    [[nodiscard]] std::uint64_t FailedCount() const;
+
+private:
+    struct Job
+    {
+        std::string path;
+        std::vector<TimeMark> marks;
+    };
+
+private:
+    void Run();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_condition_;
+    std::condition_variable drain_condition_;
+    std::deque<Job> jobs_;
+    bool busy_;
+    bool stop_requested_;
+    std::atomic<std::uint64_t> compressed_;
+    std::atomic<std::uint64_t> failed_;
+    std::thread thread_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef RUTHEN_SUBSCRIBER_H
+#define RUTHEN_SUBSCRIBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logging/log_types.h"
+#include "logging/log_record.h"
+#include "logging/async_writer.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+typedef std::uint64_t SubscriptionID;
+
+// Receives consecutive entries of a single logger. The views are only valid
+// for the duration of the call.
+typedef std::function<void(const LogEntry* entries, std::size_t count)> LogSubscriber;
+
+//----------------------------------------------------------------------
+
+// Hands batches to the subscribers of each logger. Meant to be the output
+// of a dedicated AsyncWriter, so subscribers run on its thread and never on
+// the thread that logged. Subscribers must not add or remove subscriptions
+// from inside the callback.
+class SubscriberTable : public LogOutput
+{
+public:
+    SubscriberTable();
+    SubscriberTable(const SubscriberTable&) = delete;
+    SubscriberTable& operator=(const SubscriberTable&) = delete;
+    ~SubscriberTable() override;
+
+public:
+    void Write(const LogEntry* entries, std::size_t count) override;
+    void Flush() override;
+    SubscriptionID Add(LoggerID logger, LogSubscriber subscriber);
+    // Once this returns the subscriber is not called anymore
+    bool Remove(SubscriptionID id, LoggerID& logger);
+    void RemoveLogger(LoggerID logger);
+    void Clear();
+
+public:
+    [[nodiscard]] std::size_t Count() const;
+
+private:
+    struct Subscription
+    {
+        SubscriptionID id;
+        LoggerID logger;
+        LogSubscriber callback;
+    };
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Subscription> subscriptions_;
+    SubscriptionID next_id_;
+    std::vector<LogEntry> entries_;
+    std::vector<LogEntry> selected_;
+    std::deque<std::string> decoded_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef RUTHEN_TIMESTAMP_H
+#define RUTHEN_TIMESTAMP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+// Rendered calendar time of a single second. Small enough to be passed
+// around by value instead of building a std::string per record.
+struct TimestampText
+{
+    constexpr static std::size_t kCapacity = 32;
+
+    char text[kCapacity];
+    std::uint8_t size;
+
+    std::string_view View() const { return std::string_view{text, size}; }
+    operator std::string_view() const { return View(); }
+};
+
+// Caches the calendar text of the most recently rendered second, so that
+// localtime_r and formatting run at most once per second and layout. Any
+// number of threads may read it, the cache is a lock-free seqlock.
+//
+// Layout placeholders: %1 seconds, %2 minutes, %3 hours, %4 day of month,
+// %5 month and %6 year.
+class TimestampCache
+{
+public:
+    explicit TimestampCache(std::string_view layout);
+    TimestampCache(const TimestampCache&) = delete;
+    TimestampCache& operator=(const TimestampCache&) = delete;
+
+public:
+    TimestampText Get(std::int64_t timestamp);
+    void AppendTo(std::string& out, std::int64_t timestamp);
+
+public:
+    [[nodiscard]] std::string_view GetLayout() const;
+
+private:
+    constexpr static std::size_t kWords = TimestampText::kCapacity / sizeof(std::uint64_t);
+
+    bool TryLoad(std::int64_t second, TimestampText& result) const;
+    void Render(std::int64_t second, TimestampText& result) const;
+    void Store(std::int64_t second, const TimestampText& text);
+
+private:
+    std::string layout_;
+    std::atomic<std::uint64_t> sequence_;
+    std::atomic<std::int64_t> second_;
+    std::atomic<std::uint64_t> size_;
+    std::atomic<std::uint64_t> words_[kWords];
+};
+
+//----------------------------------------------------------------------
+
+// Nanoseconds since the epoch. Stamps advance with the monotonic clock,
+// which is re-anchored to the wall clock every second so NTP adjustments
+// and suspends are picked up. A wall clock step back is spread out at one
+// millisecond per second, and no thread ever sees its stamps go backwards.
+std::int64_t CurrentTimestamp();
+
+TimestampCache& GetTimestampCache();
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
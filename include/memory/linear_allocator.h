@@ -0,0 +1,125 @@
+#ifndef RUTHEN_LINEAR_ALLOCATOR_H
+#define RUTHEN_LINEAR_ALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+
+#include "memory/memory_tracker.h"
+#include "memory/virtual_arena.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+// Bump allocator released all at once by Reset. With GrowthPolicy::kChain a
+// full chunk is followed by a new one instead of failing, chunks are kept
+// on Reset so a steady workload stops calling malloc after the first round.
+// Chunks are charged to the tag given at construction. Over a VirtualArena
+// the allocator is fixed to the arena's reservation and commits it as it
+// fills, the arena must outlive the allocator and serve no one else.
+class LinearAllocator
+{
+public:
+    enum class GrowthPolicy
+    {
+        kFixed,
+        kChain
+    };
+
+    static constexpr std::size_t kDefaultAlignment = alignof(std::max_align_t);
+
+public:
+    explicit LinearAllocator(std::size_t size_bytes, GrowthPolicy policy = GrowthPolicy::kFixed, MemoryTag tag = GetCurrentMemoryTag());
+    explicit LinearAllocator(VirtualArena& arena);
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator(LinearAllocator&& src) noexcept;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(LinearAllocator&& rhs) noexcept;
+    ~LinearAllocator();
+
+public:
+    // Alignment must be a power of two. Returns nullptr when a fixed
+    // allocator is full, throws std::bad_alloc when a new chunk can't be had.
+    [[nodiscard]] void* Allocate(std::size_t size_bytes, std::size_t alignment = kDefaultAlignment);
+    void Reset();
+    // Reset that also gives memory back: decommits the arena's pages, or
+    // frees every chunk but the first
+    void Decommit();
+
+public:
+    // Bytes handed out since the last Reset, including padding and chunk tails
+    [[nodiscard]] std::size_t GetSize() const;
+    [[nodiscard]] std::size_t GetCapacity() const;
+    [[nodiscard]] std::size_t GetChunkCount() const;
+    [[nodiscard]] bool IsEmpty() const;
+    [[nodiscard]] bool Owns(const void* pointer) const;
+
+private:
+    struct alignas(std::max_align_t) Chunk
+    {
+        Chunk* next;
+        std::size_t size;
+    };
+
+private:
+    bool Commit(std::size_t padding, std::size_t size_bytes);
+
+private:
+    static Chunk* NewChunk(std::size_t size_bytes, MemoryTag tag);
+    static Chunk* NewChunk(VirtualArena& arena);
+    static void FreeChunks(Chunk* chunk, MemoryTag tag);
+    static unsigned char* GetData(Chunk* chunk);
+
+private:
+    std::size_t chunk_size_;
+    GrowthPolicy policy_;
+    MemoryTag tag_;
+    VirtualArena* arena_;
+    Chunk* first_;
+    Chunk* current_;
+    // Offset in the current chunk and the bytes consumed in the ones before it
+    std::size_t used_;
+    std::size_t filled_;
+    // End of the usable part of the current chunk, below its size while
+    // arena pages are still uncommitted
+    std::size_t limit_;
+};
+
+//----------------------------------------------------------------------
+
+// Two LinearAllocators used on alternate frames. EndFrame resets the one
+// that served the frame before last and makes it current, so anything
+// allocated during a frame stays valid through the next one.
+class FrameAllocator
+{
+public:
+    static constexpr std::size_t kDefaultAlignment = LinearAllocator::kDefaultAlignment;
+
+public:
+    explicit FrameAllocator(std::size_t size_bytes, LinearAllocator::GrowthPolicy policy = LinearAllocator::GrowthPolicy::kChain,
+        MemoryTag tag = MemoryTag::kFrame);
+
+public:
+    [[nodiscard]] void* Allocate(std::size_t size_bytes, std::size_t alignment = kDefaultAlignment);
+    void EndFrame();
+
+public:
+    [[nodiscard]] LinearAllocator& GetCurrent();
+    [[nodiscard]] const LinearAllocator& GetPrevious() const;
+
+private:
+    std::array<LinearAllocator, 2> buffers_;
+    std::size_t current_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
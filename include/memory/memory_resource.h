@@ -0,0 +1,141 @@
+#ifndef RUTHEN_MEMORY_RESOURCE_H
+#define RUTHEN_MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "memory/linear_allocator.h"
+#include "memory/pool_allocator.h"
+#include "memory/stack_allocator.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+// std::pmr adapters over the engine allocators, so standard containers can
+// live in an arena. Each adapter refers to an allocator it doesn't own.
+// Requests the arena can't serve go to the upstream resource, the default
+// null_memory_resource makes them throw std::bad_alloc instead. Memory from
+// upstream is handed back to it on deallocate.
+
+// Deallocating arena memory is a no-op, it comes back with Reset
+class LinearResource : public std::pmr::memory_resource
+{
+public:
+    explicit LinearResource(LinearAllocator& allocator, std::pmr::memory_resource* upstream = std::pmr::null_memory_resource());
+
+public:
+    [[nodiscard]] LinearAllocator& GetAllocator() const;
+    [[nodiscard]] std::pmr::memory_resource* GetUpstream() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    LinearAllocator& allocator_;
+    std::pmr::memory_resource* upstream_;
+};
+
+// Deallocating arena memory is a no-op, it comes back with FreeToMarker
+class StackResource : public std::pmr::memory_resource
+{
+public:
+    explicit StackResource(StackAllocator& allocator, std::pmr::memory_resource* upstream = std::pmr::null_memory_resource());
+
+public:
+    [[nodiscard]] StackAllocator& GetAllocator() const;
+    [[nodiscard]] std::pmr::memory_resource* GetUpstream() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    StackAllocator& allocator_;
+    std::pmr::memory_resource* upstream_;
+};
+
+// Requests larger than a block take a run of blocks. Blocks are only as
+// aligned as their size and the pool storage allow, requests needing more
+// go upstream.
+template<std::size_t kBlockSize>
+class PoolResource : public std::pmr::memory_resource
+{
+public:
+    explicit PoolResource(PoolAllocator<kBlockSize>& allocator, std::pmr::memory_resource* upstream = std::pmr::null_memory_resource());
+
+public:
+    [[nodiscard]] PoolAllocator<kBlockSize>& GetAllocator() const;
+    [[nodiscard]] std::pmr::memory_resource* GetUpstream() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    PoolAllocator<kBlockSize>& allocator_;
+    std::pmr::memory_resource* upstream_;
+};
+
+//----------------------------------------------------------------------
+
+template<std::size_t kBlockSize>
+PoolResource<kBlockSize>::PoolResource(PoolAllocator<kBlockSize>& allocator, std::pmr::memory_resource* upstream) :
+    allocator_{allocator},
+    upstream_{upstream}
+{}
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>& PoolResource<kBlockSize>::GetAllocator() const
+{
+    return allocator_;
+}
+
+template<std::size_t kBlockSize>
+std::pmr::memory_resource* PoolResource<kBlockSize>::GetUpstream() const
+{
+    return upstream_;
+}
+
+template<std::size_t kBlockSize>
+void* PoolResource<kBlockSize>::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* pointer = allocator_.Allocate(bytes != 0 ? bytes : 1);
+    if (pointer != nullptr && (reinterpret_cast<std::uintptr_t>(pointer) & (alignment - 1)) != 0)
+    {
+        allocator_.Free(pointer, bytes);
+        pointer = nullptr;
+    }
+    if (pointer != nullptr) return pointer;
+    return upstream_->allocate(bytes, alignment);
+}
+
+template<std::size_t kBlockSize>
+void PoolResource<kBlockSize>::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+    if (allocator_.Owns(pointer)) allocator_.Free(pointer, bytes != 0 ? bytes : 1);
+    else upstream_->deallocate(pointer, bytes, alignment);
+}
+
+template<std::size_t kBlockSize>
+bool PoolResource<kBlockSize>::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
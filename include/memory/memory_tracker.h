@@ -0,0 +1,149 @@
+#ifndef RUTHEN_MEMORY_TRACKER_H
+#define RUTHEN_MEMORY_TRACKER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+// Subsystem an allocation is charged to
+enum class MemoryTag : std::uint8_t
+{
+    kGeneral,
+    kLogging,
+    kWindow,
+    kGraphics,
+    kFrame,
+    kLevel,
+    kCount
+};
+
+struct MemoryTagStats
+{
+    MemoryTag tag;
+    std::int64_t live_bytes;
+    std::int64_t live_count;
+    std::int64_t high_water_bytes;
+    std::uint64_t allocations;
+    // Zero when the tag has no budget
+    std::size_t budget_bytes;
+};
+
+// Called on the allocating thread when a tag's live bytes cross its budget
+typedef void (*MemoryBudgetCallback)(MemoryTag tag, std::size_t live_bytes, std::size_t budget_bytes);
+
+//----------------------------------------------------------------------
+
+// Sets the calling thread's current tag for its lifetime. Allocators that
+// aren't given a tag charge the current one. Only the engine allocators and
+// subsys::MemoryManager are tracked, so plain operator new and malloc are
+// charged nowhere unless RUTHEN_REPLACE_GLOBAL_NEW routes them through the
+// manager.
+class MemoryTagScope
+{
+public:
+    explicit MemoryTagScope(MemoryTag tag) noexcept;
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+    ~MemoryTagScope();
+
+private:
+    MemoryTag previous_;
+};
+
+//----------------------------------------------------------------------
+
+// Counts go to per-thread counters first and reach the shared totals once
+// a thread's balance for a tag moves by 64KB, when it calls
+// FlushMemoryTracking or when it exits. Totals, high-water marks and budget
+// checks are therefore exact to within 64KB per thread and tag.
+inline void TrackAllocation(MemoryTag tag, std::size_t bytes) noexcept;
+inline void TrackFree(MemoryTag tag, std::size_t bytes) noexcept;
+void FlushMemoryTracking() noexcept;
+
+inline MemoryTag GetCurrentMemoryTag() noexcept;
+const char* GetMemoryTagName(MemoryTag tag) noexcept;
+// Zero removes the budget
+void SetMemoryBudget(MemoryTag tag, std::size_t bytes) noexcept;
+void SetMemoryBudgetCallback(MemoryBudgetCallback callback) noexcept;
+MemoryTagStats GetMemoryTagStats(MemoryTag tag) noexcept;
+
+// One line per tag. Both flush the calling thread first.
+std::string FormatMemoryReport();
+// Tags that still have live allocations, empty when there are none
+std::string FormatMemoryLeaks();
+
+//----------------------------------------------------------------------
+
+namespace detail
+{
+
+constexpr std::int64_t kTrackingFlushBytes = 64 * 1024;
+
+struct PendingTagCounters
+{
+    std::int64_t bytes;
+    std::int64_t count;
+    std::uint64_t allocations;
+};
+
+// Defined here so the tracking fast path inlines into the allocators
+struct ThreadTagCounters
+{
+    std::array<PendingTagCounters, static_cast<std::size_t>(MemoryTag::kCount)> tags;
+    // Cleared again once the thread's destructors have run
+    bool registered;
+};
+
+inline thread_local ThreadTagCounters thread_tag_counters{};
+inline thread_local MemoryTag current_memory_tag = MemoryTag::kGeneral;
+
+// Publishes the tag's pending counts, registers the thread on first use
+void PublishTagCounters(MemoryTag tag) noexcept;
+
+inline void Track(MemoryTag tag, std::int64_t bytes, std::int64_t count) noexcept
+{
+    std::size_t index = static_cast<std::size_t>(tag);
+    if (index >= thread_tag_counters.tags.size()) return;
+    PendingTagCounters& pending = thread_tag_counters.tags[index];
+    pending.bytes += bytes;
+    pending.count += count;
+    pending.allocations += count > 0;
+    if (pending.bytes >= kTrackingFlushBytes || pending.bytes <= -kTrackingFlushBytes || !thread_tag_counters.registered)
+    {
+        PublishTagCounters(tag);
+    }
+}
+
+}
+
+inline void TrackAllocation(MemoryTag tag, std::size_t bytes) noexcept
+{
+    detail::Track(tag, static_cast<std::int64_t>(bytes), 1);
+}
+
+inline void TrackFree(MemoryTag tag, std::size_t bytes) noexcept
+{
+    detail::Track(tag, -static_cast<std::int64_t>(bytes), -1);
+}
+
+inline MemoryTag GetCurrentMemoryTag() noexcept
+{
+    return detail::current_memory_tag;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
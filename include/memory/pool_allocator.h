@@ -0,0 +1,508 @@
+#ifndef RUTHEN_POOL_ALLOCATOR_H
+#define RUTHEN_POOL_ALLOCATOR_H
+
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "memory/memory_tracker.h"
+#include "memory/virtual_arena.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+// Fixed-size block pool. Block i is bit i % 64 of bitfield word i / 64,
+// set while allocated. Free blocks below the frontier are linked into a
+// doubly linked list through their own storage, blocks at or above it have
+// never been handed out. Single blocks come from the list or the frontier
+// in O(1), runs of blocks are found by scanning whole bitfield words.
+// Storage the pool allocates itself is charged to its tag.
+template<std::size_t kBlockSize>
+class PoolAllocator
+{
+public:
+    typedef std::uint64_t Bitfield;
+    typedef std::uint32_t BlockIndex;
+    static constexpr std::size_t kBitfieldBits = sizeof(Bitfield) * CHAR_BIT;
+    static constexpr BlockIndex kNoBlock = std::numeric_limits<BlockIndex>::max();
+
+    static_assert(kBlockSize >= 2 * sizeof(BlockIndex), "free blocks must hold the list links");
+
+public:
+    explicit PoolAllocator(std::size_t block_count, MemoryTag tag = GetCurrentMemoryTag());
+    // Works in caller-owned storage of StorageSize(block_count) bytes whose
+    // bitfield part is already zero, such as a fresh anonymous mapping
+    PoolAllocator(void* storage, std::size_t block_count);
+    // Commits StorageSize(block_count) of a fresh or decommitted arena, which
+    // must outlive the pool. Pages become resident as the frontier reaches them.
+    PoolAllocator(VirtualArena& arena, std::size_t block_count);
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator(PoolAllocator&& src) noexcept;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(PoolAllocator&& rhs) noexcept;
+    ~PoolAllocator();
+
+public:
+    [[nodiscard]] void* Allocate(std::size_t size_bytes);
+    void Free(void* pointer, std::size_t size_bytes);
+    void Reset();
+    // Reset that also drops the pages of blocks handed out, arena pools only
+    void Decommit();
+    void PrintBitfields() const;
+
+public:
+    [[nodiscard]] std::size_t BlockCount() const;
+    [[nodiscard]] std::size_t UsedCount() const;
+    // Blocks below the frontier, the part of the storage ever handed out
+    [[nodiscard]] std::size_t TouchedCount() const;
+    [[nodiscard]] bool IsEmpty() const;
+    [[nodiscard]] bool IsBlockFree(std::size_t index) const;
+    [[nodiscard]] bool IsBlockAllocated(std::size_t index) const;
+    [[nodiscard]] bool Owns(const void* pointer) const;
+
+public:
+    static constexpr std::size_t BitfieldOffset(std::size_t block_count);
+    static constexpr std::size_t StorageSize(std::size_t block_count);
+
+private:
+    void Attach(void* storage, std::size_t block_count);
+    void Release();
+    void* AllocateBlock();
+    void* AllocateRun(std::size_t blocks);
+    std::size_t FindRun(std::size_t blocks);
+    void SetBlockFree(std::size_t index);
+    void SetBlockAllocated(std::size_t index);
+
+private:
+    void PushFree(std::size_t index);
+    void Unlink(std::size_t index);
+    BlockIndex GetLink(std::size_t index, std::size_t which) const;
+    void SetLink(std::size_t index, std::size_t which, BlockIndex value);
+
+private:
+    static constexpr std::size_t BitfieldCount(std::size_t block_count);
+    static constexpr std::size_t BlocksFor(std::size_t size_bytes);
+
+private:
+    std::size_t bit_fileds_;
+    std::size_t block_count_;
+    std::size_t size_;
+    std::size_t used_;
+    std::size_t frontier_;
+    // No bitfield word below this one has a free block
+    std::size_t search_word_;
+    BlockIndex free_head_;
+    bool owns_storage_;
+    MemoryTag tag_;
+    VirtualArena* arena_;
+    void* data_;
+    Bitfield* bitfield_;
+};
+
+//----------------------------------------------------------------------
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>::PoolAllocator(std::size_t block_count, MemoryTag tag) :
+    bit_fileds_{0},
+    block_count_{0},
+    size_{0},
+    used_{0},
+    frontier_{0},
+    search_word_{0},
+    free_head_{kNoBlock},
+    owns_storage_{true},
+    tag_{tag},
+    arena_{nullptr},
+    data_{nullptr},
+    bitfield_{nullptr}
+{
+    if (block_count >= kNoBlock) throw std::length_error{"pool block count out of range"};
+    void* pointer = std::malloc(StorageSize(block_count));
+    if (pointer == nullptr) throw std::bad_alloc{};
+    TrackAllocation(tag_, StorageSize(block_count));
+    Attach(pointer, block_count);
+    // Blocks are only touched once handed out, only the bitfields need clearing
+    std::memset(bitfield_, 0, bit_fileds_ * sizeof(Bitfield));
+}
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>::PoolAllocator(void* storage, std::size_t block_count) :
+    bit_fileds_{0},
+    block_count_{0},
+    size_{0},
+    used_{0},
+    frontier_{0},
+    search_word_{0},
+    free_head_{kNoBlock},
+    owns_storage_{false},
+    tag_{MemoryTag::kGeneral},
+    arena_{nullptr},
+    data_{nullptr},
+    bitfield_{nullptr}
+{
+    if (block_count >= kNoBlock) throw std::length_error{"pool block count out of range"};
+    Attach(storage, block_count);
+}
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>::PoolAllocator(VirtualArena& arena, std::size_t block_count) :
+    bit_fileds_{0},
+    block_count_{0},
+    size_{0},
+    used_{0},
+    frontier_{0},
+    search_word_{0},
+    free_head_{kNoBlock},
+    owns_storage_{false},
+    tag_{arena.GetTag()},
+    arena_{&arena},
+    data_{nullptr},
+    bitfield_{nullptr}
+{
+    if (block_count >= kNoBlock) throw std::length_error{"pool block count out of range"};
+    if (!arena.Commit(StorageSize(block_count))) throw std::length_error{"pool storage exceeds the arena"};
+    Attach(arena.GetData(), block_count);
+}
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>::PoolAllocator(PoolAllocator&& src) noexcept :
+    bit_fileds_{std::exchange(src.bit_fileds_, 0)},
+    block_count_{std::exchange(src.block_count_, 0)},
+    size_{std::exchange(src.size_, 0)},
+    used_{std::exchange(src.used_, 0)},
+    frontier_{std::exchange(src.frontier_, 0)},
+    search_word_{std::exchange(src.search_word_, 0)},
+    free_head_{std::exchange(src.free_head_, kNoBlock)},
+    owns_storage_{std::exchange(src.owns_storage_, false)},
+    tag_{src.tag_},
+    arena_{std::exchange(src.arena_, nullptr)},
+    data_{std::exchange(src.data_, nullptr)},
+    bitfield_{std::exchange(src.bitfield_, nullptr)}
+{}
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>& PoolAllocator<kBlockSize>::operator=(PoolAllocator&& rhs) noexcept
+{
+    if (this == &rhs) return *this;
+    Release();
+    bit_fileds_ = std::exchange(rhs.bit_fileds_, 0);
+    block_count_ = std::exchange(rhs.block_count_, 0);
+    size_ = std::exchange(rhs.size_, 0);
+    used_ = std::exchange(rhs.used_, 0);
+    frontier_ = std::exchange(rhs.frontier_, 0);
+    search_word_ = std::exchange(rhs.search_word_, 0);
+    free_head_ = std::exchange(rhs.free_head_, kNoBlock);
+    owns_storage_ = std::exchange(rhs.owns_storage_, false);
+    tag_ = rhs.tag_;
+    arena_ = std::exchange(rhs.arena_, nullptr);
+    data_ = std::exchange(rhs.data_, nullptr);
+    bitfield_ = std::exchange(rhs.bitfield_, nullptr);
+    return *this;
+}
+
+template<std::size_t kBlockSize>
+PoolAllocator<kBlockSize>::~PoolAllocator()
+{
+    Release();
+}
+
+//----------------------------------------------------------------------
+
+template<std::size_t kBlockSize>
+void* PoolAllocator<kBlockSize>::Allocate(std::size_t size_bytes)
+{
+    std::size_t blocks_needed = BlocksFor(size_bytes);
+    if (blocks_needed <= 1) return AllocateBlock();
+    return AllocateRun(blocks_needed);
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::Free(void* pointer, std::size_t size_bytes)
+{
+    if (!Owns(pointer)) return;
+    std::size_t blocks = BlocksFor(size_bytes);
+    if (blocks == 0) blocks = 1;
+    std::size_t index = static_cast<std::size_t>(static_cast<unsigned char*>(pointer) - static_cast<unsigned char*>(data_)) / kBlockSize;
+    if (index / kBitfieldBits < search_word_) search_word_ = index / kBitfieldBits;
+    for (std::size_t i = 0; i < blocks && index + i < block_count_; ++i)
+    {
+        if (IsBlockFree(index + i)) continue;
+        SetBlockFree(index + i);
+        --used_;
+        if (index + i < frontier_) PushFree(index + i);
+    }
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::Reset()
+{
+    for (std::size_t i = 0; i < bit_fileds_; ++i)
+    {
+        bitfield_[i] = Bitfield{};
+    }
+    used_ = 0;
+    frontier_ = 0;
+    search_word_ = 0;
+    free_head_ = kNoBlock;
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::Decommit()
+{
+    if (arena_ != nullptr) arena_->Discard(0, size_);
+    Reset();
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::PrintBitfields() const
+{
+    std::cout << bit_fileds_ << '\n';
+    for (std::size_t i = 0; i < bit_fileds_; ++i)
+    {
+        std::cout << std::bitset<kBitfieldBits>(bitfield_[i]) << '\n';
+    }
+}
+
+//----------------------------------------------------------------------
+
+template<std::size_t kBlockSize>
+std::size_t PoolAllocator<kBlockSize>::BlockCount() const
+{
+    return block_count_;
+}
+
+template<std::size_t kBlockSize>
+std::size_t PoolAllocator<kBlockSize>::UsedCount() const
+{
+    return used_;
+}
+
+template<std::size_t kBlockSize>
+std::size_t PoolAllocator<kBlockSize>::TouchedCount() const
+{
+    return frontier_;
+}
+
+template<std::size_t kBlockSize>
+bool PoolAllocator<kBlockSize>::IsEmpty() const
+{
+    return used_ == 0;
+}
+
+template<std::size_t kBlockSize>
+bool PoolAllocator<kBlockSize>::IsBlockFree(std::size_t index) const
+{
+    return !IsBlockAllocated(index);
+}
+
+template<std::size_t kBlockSize>
+bool PoolAllocator<kBlockSize>::IsBlockAllocated(std::size_t index) const
+{
+    if (index >= block_count_) return false;
+    return (bitfield_[index / kBitfieldBits] >> (index % kBitfieldBits)) & Bitfield{1};
+}
+
+template<std::size_t kBlockSize>
+bool PoolAllocator<kBlockSize>::Owns(const void* pointer) const
+{
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(data_);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+    if (address < start || address >= start + size_) return false;
+    return (address - start) % kBlockSize == 0;
+}
+
+//----------------------------------------------------------------------
+
+// Bitfields sit behind the blocks, aligned for any block size
+template<std::size_t kBlockSize>
+constexpr std::size_t PoolAllocator<kBlockSize>::BitfieldOffset(std::size_t block_count)
+{
+    return (block_count * kBlockSize + alignof(Bitfield) - 1) / alignof(Bitfield) * alignof(Bitfield);
+}
+
+template<std::size_t kBlockSize>
+constexpr std::size_t PoolAllocator<kBlockSize>::StorageSize(std::size_t block_count)
+{
+    return BitfieldOffset(block_count) + BitfieldCount(block_count) * sizeof(Bitfield);
+}
+
+template<std::size_t kBlockSize>
+constexpr std::size_t PoolAllocator<kBlockSize>::BitfieldCount(std::size_t block_count)
+{
+    return (block_count + kBitfieldBits - 1) / kBitfieldBits;
+}
+
+template<std::size_t kBlockSize>
+constexpr std::size_t PoolAllocator<kBlockSize>::BlocksFor(std::size_t size_bytes)
+{
+    return size_bytes / kBlockSize + (size_bytes % kBlockSize != 0 ? 1 : 0);
+}
+
+//----------------------------------------------------------------------
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::Attach(void* storage, std::size_t block_count)
+{
+    bit_fileds_ = BitfieldCount(block_count);
+    block_count_ = block_count;
+    size_ = block_count * kBlockSize;
+    data_ = storage;
+    bitfield_ = reinterpret_cast<Bitfield*>(static_cast<unsigned char*>(storage) + BitfieldOffset(block_count));
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::Release()
+{
+    if (!owns_storage_ || data_ == nullptr) return;
+    TrackFree(tag_, StorageSize(block_count_));
+    std::free(data_);
+}
+
+template<std::size_t kBlockSize>
+void* PoolAllocator<kBlockSize>::AllocateBlock()
+{
+    std::size_t index = free_head_;
+    if (free_head_ != kNoBlock) Unlink(index);
+    else
+    {
+        // Runs may have been carved out beyond the frontier, step over them
+        while (frontier_ < block_count_ && IsBlockAllocated(frontier_)) ++frontier_;
+        if (frontier_ == block_count_) return nullptr;
+        index = frontier_++;
+    }
+    SetBlockAllocated(index);
+    ++used_;
+    return static_cast<unsigned char*>(data_) + index * kBlockSize;
+}
+
+template<std::size_t kBlockSize>
+void* PoolAllocator<kBlockSize>::AllocateRun(std::size_t blocks)
+{
+    std::size_t start = FindRun(blocks);
+    if (start == static_cast<std::size_t>(-1)) return nullptr;
+    for (std::size_t i = start; i < start + blocks; ++i)
+    {
+        if (i < frontier_) Unlink(i);
+        SetBlockAllocated(i);
+    }
+    used_ += blocks;
+    return static_cast<unsigned char*>(data_) + start * kBlockSize;
+}
+
+// Tracks the free run reaching into each word from below. Within a word,
+// w & (w >> 1) & ... leaves a bit set where enough free bits start.
+template<std::size_t kBlockSize>
+std::size_t PoolAllocator<kBlockSize>::FindRun(std::size_t blocks)
+{
+    if (blocks > block_count_ - used_) return static_cast<std::size_t>(-1);
+    std::size_t run = 0;
+    std::size_t run_start = 0;
+    for (std::size_t word = search_word_; word < bit_fileds_; ++word)
+    {
+        Bitfield free_bits = ~bitfield_[word];
+        std::size_t tail = block_count_ - word * kBitfieldBits;
+        if (tail < kBitfieldBits) free_bits &= (Bitfield{1} << tail) - 1;
+        if (free_bits == ~Bitfield{})
+        {
+            if (run == 0) run_start = word * kBitfieldBits;
+            run += kBitfieldBits;
+            if (run >= blocks) return run_start;
+            continue;
+        }
+        if (free_bits == Bitfield{})
+        {
+            if (word == search_word_) ++search_word_;
+            run = 0;
+            continue;
+        }
+        std::size_t low = static_cast<std::size_t>(std::countr_one(free_bits));
+        if (run > 0 && run + low >= blocks) return run_start;
+        if (blocks <= kBitfieldBits && static_cast<std::size_t>(std::popcount(free_bits)) >= blocks)
+        {
+            Bitfield starts = free_bits;
+            for (std::size_t width = 1; width < blocks && starts != Bitfield{};)
+            {
+                std::size_t step = std::min(width, blocks - width);
+                starts &= starts >> step;
+                width += step;
+            }
+            if (starts != Bitfield{}) return word * kBitfieldBits + static_cast<std::size_t>(std::countr_zero(starts));
+        }
+        run = static_cast<std::size_t>(std::countl_one(free_bits));
+        run_start = (word + 1) * kBitfieldBits - run;
+    }
+    return static_cast<std::size_t>(-1);
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::SetBlockAllocated(std::size_t index)
+{
+    if (index >= block_count_) return;
+    bitfield_[index / kBitfieldBits] |= Bitfield{1} << (index % kBitfieldBits);
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::SetBlockFree(std::size_t index)
+{
+    if (index >= block_count_) return;
+    bitfield_[index / kBitfieldBits] &= ~(Bitfield{1} << (index % kBitfieldBits));
+}
+
+//----------------------------------------------------------------------
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::PushFree(std::size_t index)
+{
+    SetLink(index, 0, kNoBlock);
+    SetLink(index, 1, free_head_);
+    if (free_head_ != kNoBlock) SetLink(free_head_, 0, static_cast<BlockIndex>(index));
+    free_head_ = static_cast<BlockIndex>(index);
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::Unlink(std::size_t index)
+{
+    BlockIndex previous = GetLink(index, 0);
+    BlockIndex next = GetLink(index, 1);
+    if (previous != kNoBlock) SetLink(previous, 1, next);
+    else free_head_ = next;
+    if (next != kNoBlock) SetLink(next, 0, previous);
+}
+
+// Links are copied in and out, blocks carry no alignment guarantee
+template<std::size_t kBlockSize>
+typename PoolAllocator<kBlockSize>::BlockIndex PoolAllocator<kBlockSize>::GetLink(std::size_t index, std::size_t which) const
+{
+    BlockIndex value;
+    std::memcpy(&value, static_cast<unsigned char*>(data_) + index * kBlockSize + which * sizeof(BlockIndex), sizeof(BlockIndex));
+    return value;
+}
+
+template<std::size_t kBlockSize>
+void PoolAllocator<kBlockSize>::SetLink(std::size_t index, std::size_t which, BlockIndex value)
+{
+    std::memcpy(static_cast<unsigned char*>(data_) + index * kBlockSize + which * sizeof(BlockIndex), &value, sizeof(BlockIndex));
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -1,45 +1,107 @@
 #ifndef RUTHEN_STACK_ALLOCATOR
 #define RUTHEN_STACK_ALLOCATOR
 
+#include <cstddef>
+
+#include "memory/memory_tracker.h"
+
 namespace ruthen
 {
 
 namespace memory
 {
 
-struct MemoryBlock
-{
-    unsigned long int id;
-    unsigned long int size;
-    const void* pointer;
-};
+//----------------------------------------------------------------------
 
+// Bump allocator over one buffer. Nothing is recorded per allocation, memory
+// is given back by rolling the top back to a marker taken earlier, which
+// releases everything allocated since in O(1).
 class StackAllocator
 {
 public:
-    typedef unsigned long int MemoryBlockID;
-    typedef unsigned long int Size;
+    // Offset of the stack top
+    typedef std::size_t Marker;
+    static constexpr std::size_t kDefaultAlignment = alignof(std::max_align_t);
 
 public:
-    StackAllocator(Size size_bytes);
+    explicit StackAllocator(std::size_t size_bytes, MemoryTag tag = GetCurrentMemoryTag());
+    StackAllocator(const StackAllocator&) = delete;
+    StackAllocator(StackAllocator&& src) noexcept;
+    StackAllocator& operator=(const StackAllocator&) = delete;
+    StackAllocator& operator=(StackAllocator&& rhs) noexcept;
     ~StackAllocator();
 
 public:
-    MemoryBlock Allocate(Size size_bytes);
-    void Deallocate(MemoryBlockID block_id);
-    void Deallocate(MemoryBlock block);
+    // Alignment must be a power of two, returns nullptr when the stack is full
+    [[nodiscard]] void* Allocate(std::size_t size_bytes, std::size_t alignment = kDefaultAlignment);
+    [[nodiscard]] Marker GetMarker() const;
+    // Throws std::invalid_argument for a marker above the current top
+    void FreeToMarker(Marker marker);
+    void Clear();
+
+public:
+    [[nodiscard]] std::size_t Capacity() const;
+    [[nodiscard]] std::size_t UsedBytes() const;
+    [[nodiscard]] std::size_t FreeBytes() const;
+    [[nodiscard]] bool Owns(const void* pointer) const;
+
+private:
+    std::size_t size_;
+    std::size_t top_;
+    MemoryTag tag_;
+    unsigned char* stack_;
+};
+
+//----------------------------------------------------------------------
+
+// Two stacks growing towards each other in one buffer. The bottom is meant
+// for data that lives as long as a level, the top for scratch memory used
+// while loading it, dropped with one FreeTopToMarker or ClearTop.
+class DoubleEndedStackAllocator
+{
+public:
+    // Bottom markers count from the start of the buffer, top markers from its end
+    typedef std::size_t Marker;
+    static constexpr std::size_t kDefaultAlignment = alignof(std::max_align_t);
+
+public:
+    explicit DoubleEndedStackAllocator(std::size_t size_bytes, MemoryTag tag = GetCurrentMemoryTag());
+    DoubleEndedStackAllocator(const DoubleEndedStackAllocator&) = delete;
+    DoubleEndedStackAllocator(DoubleEndedStackAllocator&& src) noexcept;
+    DoubleEndedStackAllocator& operator=(const DoubleEndedStackAllocator&) = delete;
+    DoubleEndedStackAllocator& operator=(DoubleEndedStackAllocator&& rhs) noexcept;
+    ~DoubleEndedStackAllocator();
+
+public:
+    // Both return nullptr once the two ends would overlap
+    [[nodiscard]] void* AllocateBottom(std::size_t size_bytes, std::size_t alignment = kDefaultAlignment);
+    [[nodiscard]] void* AllocateTop(std::size_t size_bytes, std::size_t alignment = kDefaultAlignment);
+    [[nodiscard]] Marker GetBottomMarker() const;
+    [[nodiscard]] Marker GetTopMarker() const;
+    void FreeBottomToMarker(Marker marker);
+    void FreeTopToMarker(Marker marker);
+    void ClearBottom();
+    void ClearTop();
+
+public:
+    [[nodiscard]] std::size_t Capacity() const;
+    [[nodiscard]] std::size_t BottomUsedBytes() const;
+    [[nodiscard]] std::size_t TopUsedBytes() const;
+    [[nodiscard]] std::size_t FreeBytes() const;
 
 private:
-    Size stack_size_;
-    Size block_count_;
-    Size block_arr_cap_;
-    MemoryBlock* blocks_;
-    void *stack_;
-    const void* top_;
+    std::size_t size_;
+    // Offsets from the start, the top one grows down from size_
+    std::size_t bottom_;
+    std::size_t top_;
+    MemoryTag tag_;
+    unsigned char* stack_;
 };
 
+//----------------------------------------------------------------------
+
 }
 
 }
 
-#endif
\ No newline at end of file
+#endif
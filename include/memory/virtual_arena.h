@@ -0,0 +1,74 @@
+#ifndef RUTHEN_VIRTUAL_ARENA_H
+#define RUTHEN_VIRTUAL_ARENA_H
+
+#include <cstddef>
+
+#include "memory/memory_tracker.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+// Address range reserved with PROT_NONE and made accessible from its start
+// as the high-water mark grows. Committed pages only become resident once
+// touched, Decommit hands them back with MADV_DONTNEED and they read as
+// zero when committed again. Committed bytes are charged to the tag.
+class VirtualArena
+{
+public:
+    static constexpr std::size_t kHugePageSize = std::size_t{2} << 20;
+    // Commits are rounded up to this so a growing arena makes few mprotect calls
+    static constexpr std::size_t kCommitGranularity = std::size_t{64} << 10;
+
+public:
+    // Huge pages are requested with MADV_HUGEPAGE, the range is then aligned
+    // and committed in kHugePageSize steps. Throws std::bad_alloc when the
+    // range can't be reserved.
+    explicit VirtualArena(std::size_t reserve_bytes, bool huge_pages = false, MemoryTag tag = GetCurrentMemoryTag());
+    VirtualArena(const VirtualArena&) = delete;
+    VirtualArena(VirtualArena&& src) noexcept;
+    VirtualArena& operator=(const VirtualArena&) = delete;
+    VirtualArena& operator=(VirtualArena&& rhs) noexcept;
+    ~VirtualArena();
+
+public:
+    // Makes the first size_bytes accessible. Returns false past the
+    // reservation, throws std::bad_alloc when the kernel refuses the commit.
+    bool Commit(std::size_t size_bytes);
+    // Decommits everything above keep_bytes
+    void Decommit(std::size_t keep_bytes = 0);
+    // Drops the contents of committed pages in the range, which stay
+    // accessible and read as zero
+    void Discard(std::size_t offset, std::size_t size_bytes);
+
+public:
+    [[nodiscard]] unsigned char* GetData() const;
+    [[nodiscard]] std::size_t GetReservedSize() const;
+    [[nodiscard]] std::size_t GetCommittedSize() const;
+    [[nodiscard]] bool UsesHugePages() const;
+    [[nodiscard]] MemoryTag GetTag() const;
+    [[nodiscard]] bool Owns(const void* pointer) const;
+
+private:
+    void Release();
+
+private:
+    std::size_t reserved_;
+    std::size_t committed_;
+    std::size_t granularity_;
+    bool huge_pages_;
+    MemoryTag tag_;
+    unsigned char* data_;
+};
+
+//----------------------------------------------------------------------
+
+}
+
+}
+
+#endif
@@ -4,42 +4,45 @@
 #include <string>
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <queue>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <atomic>
 
 #include "format.h"
 #include "patterns/singleton.h"
+#include "logging/log_types.h"
+#include "logging/log_record.h"
+#include "logging/async_writer.h"
+#include "logging/file_sink.h"
+#include "logging/binary_log.h"
+#include "logging/subscriber.h"
+#include "logging/rate_limit.h"
 
 namespace ruthen
 {
 //----------------------------------------------------------------------
 
-class LogManager;
-
-//----------------------------------------------------------------------
-
-enum LogLevel : int
+namespace subsys
 {
-    kTrace = 0,
-    kDebug,
-    kInfo,
-    kWarn,
-    kError,
-    kCritical,
-    kCrash
-};
-
-typedef std::size_t LoggerID;
+class LogManager;
+}
 
 //----------------------------------------------------------------------
 
 class Logger
 {
-    friend class LogManager;
+    friend class subsys::LogManager;
 
 public:
+    // Copied out of a LogEntry for callbacks set with SetLogCallback
     struct LogDetails
     {
-        std::string time;
+        logging::TimestampText time;
+        std::int64_t timestamp;
         std::string level;
         std::string name;
         std::string destination;
@@ -64,28 +67,42 @@ public:
     void Log(const std::string& filename, const std::string& log) const;
     void Log(const std::string& filename, const std::string& log, LogLevel level) const;
     template<typename... Args>
-    void Log(const std::string& filename, const std::string& format, Args... args) const
+    void Log(const std::string& filename, FormatStringFor<Args...> format, const Args&... args) const
     {
-        if (suppress_output_) return;
-        std::string formated = format;
-        if constexpr(sizeof...(Args) > 0) formated = Format(format, std::forward<Args>(args)...);
-        Log(filename, formated);
+        Log(filename, format, level_, args...);
     }
     template<typename... Args>
-    void Log(const std::string& filename, const std::string& format, LogLevel level, Args... args) const
+    void Log(const std::string& filename, FormatStringFor<Args...> format, LogLevel level, const Args&... args) const
     {
-        if (suppress_output_) return;
-        std::string formated = format;
-        if constexpr(sizeof...(Args) > 0) formated = Format(format, std::forward<Args>(args)...);
-        Log(filename, formated, level);
+        if (!ShouldLog(level)) return;
+        FormatBuffer<logging::LogRecord::kPayloadCapacity> message;
+        FormatTo(message, format, args...);
+        Write(filename, message.View(), level, message.Truncated());
+    }
+    // Formatting is deferred: only the raw argument bytes are recorded here.
+    // Use through RUTHEN_LOG_BINARY, which registers the call site format.
+    template<typename... Args>
+    void LogBinary(const logging::FormatInfo* format, LogLevel level, const Args&... args) const
+    {
+        if (!ShouldLog(level) || format == nullptr) return;
+        char arguments[logging::LogRecord::kPayloadCapacity];
+        std::size_t size = logging::EncodeArguments(arguments, sizeof(arguments), args...);
+        WriteBinary(format, std::string_view{arguments, size}, level);
     }
     
     void SetName(const std::string& name);
     void SetLevel(LogLevel level);
+    // Kept for existing callers, managed loggers forward it through Subscribe
     void SetLogCallback(void(*log_callback)(LogDetails));
+    logging::SubscriptionID Subscribe(logging::LogSubscriber subscriber);
+    void Unsubscribe(logging::SubscriptionID id);
 
 public:
     [[nodiscard]] std::string GetName() const;
+    [[nodiscard]] bool ShouldLog(LogLevel level) const
+    {
+        return level >= kMinLogLevel && level >= level_ && !suppress_output_;
+    }
 
 public:
     std::string name_;
@@ -94,6 +111,15 @@ public:
     bool suppress_callback_;
 
     void (*on_log_callback_)(LogDetails);
+
+private:
+    void Write(std::string_view filename, std::string_view message, LogLevel level, bool truncated) const;
+    void WriteBinary(const logging::FormatInfo* info, std::string_view arguments, LogLevel level) const;
+
+private:
+    LoggerID id_;
+    subsys::LogManager* manager_;
+    logging::SubscriptionID callback_subscription_;
 };
 
 //----------------------------------------------------------------------
@@ -103,21 +129,50 @@ namespace subsys
 
 //----------------------------------------------------------------------
 
+// Loggers live in dense slots indexed by their id. Lookups read an immutable
+// registry snapshot and never lock, changes publish a new snapshot. Old
+// snapshots and deleted loggers are retired and freed on a later change,
+// once every lookup that could still see them has finished. A reference
+// returned by operator[] must not be used after its logger is deleted.
+// Shutdown() must not run concurrently with lookups. EnableAsync() and
+// DisableAsync() may, a replaced writer is stopped and freed once no
+// logging thread can still be pushing to it.
+//
+// Changes run under MemoryTagScope(kLogging), which only charges memory
+// that goes through the engine allocators or MemoryManager. The default
+// resource and operator new aren't tracked, so the tag only sees the
+// manager's own allocations with RUTHEN_REPLACE_GLOBAL_NEW.
 class LogManager : public patterns::Singleton<LogManager>
 {
+    friend class ruthen::Logger;
+
 public:
-    LogManager();
+    // The registry and name tables are allocated from the resource, it has
+    // to outlive the manager
+    explicit LogManager(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     LogManager(const LogManager&) = delete;
     LogManager& operator=(const LogManager&) = delete;
-    LogManager(LogManager&&) noexcept = default;
-    LogManager& operator=(LogManager&&) noexcept = default;
+    LogManager(LogManager&&) = delete;
+    LogManager& operator=(LogManager&&) = delete;
     Logger& operator[](LoggerID id);
     ~LogManager();
 
 public:
     void Initialize();
     void Shutdown();
+    void EnableAsync(const logging::AsyncConfig& config = {});
+    void DisableAsync();
+    void Flush();
+    void SetDefaultSinkConfig(const logging::SinkConfig& config);
+    void SetSinkConfig(const std::string& destination, const logging::SinkConfig& config);
+    void EnableBinaryLog(const std::string& path);
+    void DisableBinaryLog();
+    logging::SubscriptionID Subscribe(LoggerID id, logging::LogSubscriber subscriber);
+    void Unsubscribe(logging::SubscriptionID id);
+    // Writes one line with the counts rate limited call sites suppressed
+    // since the last report, meant to be called periodically
+    void ReportSuppressedLogs(LoggerID id, const std::string& destination);
 
 public:
     LoggerID CreateLogger(const std::string& name);
@@ -133,10 +188,56 @@ public:
     bool LoggerExists(LoggerID id) const;
     bool LoggerExists(const std::string& name) const;
     bool DefaultLoggersInitialized() const;
+    bool IsAsync() const;
+    bool IsBinaryLogEnabled() const;
+    std::uint64_t DroppedLogCount() const;
+    // Subscriber notifications lost to a full dispatch queue
+    std::uint64_t DroppedNotificationCount() const;
 
 private:
-    std::unordered_map<LoggerID, Logger> loggers_;
-    std::queue<LoggerID> reusable_ids_;
+    struct Registry
+    {
+        explicit Registry(std::pmr::memory_resource* resource);
+        Registry(const Registry& src, std::pmr::memory_resource* resource);
+
+        std::pmr::vector<Logger*> slots;
+        std::pmr::unordered_map<std::string_view, LoggerID> names;
+        std::pmr::vector<std::uint32_t> subscribers;
+    };
+
+    // Freed once no lookup from epoch or earlier is running
+    struct Retired
+    {
+        std::uint64_t epoch;
+        std::unique_ptr<Registry> registry;
+        std::unique_ptr<Logger> logger;
+        std::string_view name;
+    };
+
+private:
+    void Submit(const logging::LogEntry& entry, bool notify);
+    const Registry& GetRegistry() const;
+    void Publish(std::unique_ptr<Registry> registry, std::unique_ptr<Logger> logger = nullptr, std::string_view name = {});
+    void Reclaim();
+    LoggerID AddLogger(LoggerID id, const std::string& name, LogLevel level);
+    void RemoveLogger(LoggerID id);
+
+private:
+    std::pmr::memory_resource* resource_;
+    std::mutex registry_mutex_;
+    std::atomic<const Registry*> registry_;
+    std::unique_ptr<Registry> current_;
+    std::pmr::vector<Retired> retired_;
+    std::pmr::vector<std::unique_ptr<Logger>> loggers_;
+    std::pmr::unordered_set<std::pmr::string> names_;
+    std::queue<LoggerID, std::pmr::deque<LoggerID>> reusable_ids_;
+    std::unique_ptr<logging::SinkTable> sinks_;
+    std::mutex async_mutex_;
+    // Owned, read under an EpochGuard
+    std::atomic<logging::AsyncWriter*> async_writer_;
+    std::unique_ptr<logging::SubscriberTable> subscribers_;
+    // Created by the first Subscribe, owned and read under an EpochGuard
+    std::atomic<logging::AsyncWriter*> dispatcher_;
 };
 
 //----------------------------------------------------------------------
@@ -149,4 +250,72 @@ private:
 
 }
 
+// Arguments are only evaluated when the logger accepts the level. The
+// level has to be a constant expression, levels below RUTHEN_MIN_LOG_LEVEL
+// are discarded at compile time.
+#define RUTHEN_LOG(logger, level, filename, format, ...)                                                          \
+    do                                                                                                            \
+    {                                                                                                             \
+        if constexpr((level) >= ::ruthen::kMinLogLevel)                                                           \
+        {                                                                                                         \
+            const ::ruthen::Logger& ruthen_logger_ = (logger);                                                    \
+            if (ruthen_logger_.ShouldLog(level)) ruthen_logger_.Log(filename, format, level __VA_OPT__(,) __VA_ARGS__); \
+        }                                                                                                         \
+    } while(0)
+
+// Same as RUTHEN_LOG behind a per call site limiter. The limiter is only
+// consulted once the level is accepted and before any formatting.
+#define RUTHEN_LOG_LIMITED(policy, limit, logger, level, filename, format, ...)                                     \
+    do                                                                                                            \
+    {                                                                                                             \
+        if constexpr((level) >= ::ruthen::kMinLogLevel)                                                           \
+        {                                                                                                         \
+            const ::ruthen::Logger& ruthen_logger_ = (logger);                                                    \
+            if (!ruthen_logger_.ShouldLog(level)) break;                                                          \
+            static ::ruthen::logging::LogLimiter ruthen_limiter_{policy, limit, __FILE__, __LINE__};              \
+            if (ruthen_limiter_.Allow()) ruthen_logger_.Log(filename, format, level __VA_OPT__(,) __VA_ARGS__);   \
+        }                                                                                                         \
+    } while(0)
+
+#define RUTHEN_LOG_PER_SECOND(count, logger, level, filename, format, ...) \
+    RUTHEN_LOG_LIMITED(::ruthen::logging::LimitPolicy::kPerSecond, count, logger, level, filename, format __VA_OPT__(,) __VA_ARGS__)
+#define RUTHEN_LOG_EVERY_N(count, logger, level, filename, format, ...) \
+    RUTHEN_LOG_LIMITED(::ruthen::logging::LimitPolicy::kEveryN, count, logger, level, filename, format __VA_OPT__(,) __VA_ARGS__)
+#define RUTHEN_LOG_FIRST_N(count, logger, level, filename, format, ...) \
+    RUTHEN_LOG_LIMITED(::ruthen::logging::LimitPolicy::kFirstN, count, logger, level, filename, format __VA_OPT__(,) __VA_ARGS__)
+
+#define RUTHEN_LOG_DISABLED() do {} while(0)
+
+#if RUTHEN_MIN_LOG_LEVEL <= 0
+#define RUTHEN_LOG_TRACE(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kTrace, filename, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define RUTHEN_LOG_TRACE(logger, filename, format, ...) RUTHEN_LOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 1
+#define RUTHEN_LOG_DEBUG(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kDebug, filename, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define RUTHEN_LOG_DEBUG(logger, filename, format, ...) RUTHEN_LOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 2
+#define RUTHEN_LOG_INFO(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kInfo, filename, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define RUTHEN_LOG_INFO(logger, filename, format, ...) RUTHEN_LOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 3
+#define RUTHEN_LOG_WARN(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kWarn, filename, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define RUTHEN_LOG_WARN(logger, filename, format, ...) RUTHEN_LOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 4
+#define RUTHEN_LOG_ERROR(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kError, filename, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define RUTHEN_LOG_ERROR(logger, filename, format, ...) RUTHEN_LOG_DISABLED()
+#endif
+#if RUTHEN_MIN_LOG_LEVEL <= 5
+#define RUTHEN_LOG_CRITICAL(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kCritical, filename, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define RUTHEN_LOG_CRITICAL(logger, filename, format, ...) RUTHEN_LOG_DISABLED()
+#endif
+#define RUTHEN_LOG_CRASH(logger, filename, format, ...) RUTHEN_LOG(logger, ::ruthen::LogLevel::kCrash, filename, format __VA_OPT__(,) __VA_ARGS__)
+
 #endif
\ No newline at end of file
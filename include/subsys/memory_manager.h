@@ -1,22 +1,168 @@
 #ifndef RUTHEN_MEMORY_MANAGER_H
 #define RUTHEN_MEMORY_MANAGER_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include "memory/memory_tracker.h"
+#include "memory/pool_allocator.h"
+
 namespace ruthen
 {
 
 namespace subsys
 {
 
+//----------------------------------------------------------------------
+
+struct SizeClassStats
+{
+    std::size_t block_size;
+    // Includes blocks sitting in thread caches
+    std::size_t used_blocks;
+    // Blocks ever handed out, their pages stay resident
+    std::size_t touched_blocks;
+    std::size_t block_capacity;
+};
+
+//----------------------------------------------------------------------
+
+// General purpose allocator. Requests up to 4096 bytes go to one of nine
+// power of two classes, each split into sixteen sub-classes a 32nd of the
+// class size apart, so a block exceeds the request by at most a 32nd of
+// its class or 16 bytes, whichever is more. Every sub-class
+// is a PoolAllocator working in its own slice of one reserved address
+// range, and the class of a pointer follows from its address, so Free
+// needs no size. The range is reserved without access and each size class
+// commits its next 64KB of blocks, with their tags and bitfield words, as
+// its frontier reaches them.
+//
+// Threads keep a few blocks per size class and only lock it to move a
+// batch in or out. Larger requests, and those whose size class is full,
+// get a mapping of their own. Every allocation is charged to a memory tag,
+// kept in a byte per block beside each class.
+//
+// Nothing here goes through operator new, so the manager can back the
+// global one (RUTHEN_REPLACE_GLOBAL_NEW).
 class MemoryManager
 {
 public:
+    static constexpr std::size_t kMinClassSize = 16;
+    static constexpr std::size_t kMaxClassSize = 4096;
+    static constexpr std::size_t kClassCount = 9;
+    static constexpr std::size_t kSubClassCount = 16;
+    static constexpr std::size_t kSizeClassCount = kClassCount * kSubClassCount;
+    // Address space reserved per class, rounded up to a power of two and
+    // shared by its sub-classes. Only the part below a frontier is committed.
+    static constexpr std::size_t kDefaultClassCapacity = std::size_t{1} << 30;
+    // Threads beyond this many share the locked path
+    static constexpr std::size_t kMaxThreadCaches = 256;
+
+public:
+    explicit MemoryManager(std::size_t class_capacity = kDefaultClassCapacity);
+    MemoryManager(const MemoryManager&) = delete;
+    MemoryManager& operator=(const MemoryManager&) = delete;
+    ~MemoryManager();
+
+public:
+    // Alignment must be a power of two, returns nullptr when out of memory
+    [[nodiscard]] void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t),
+        memory::MemoryTag tag = memory::GetCurrentMemoryTag());
+    void Free(void* pointer);
+    // Returns the calling thread's cached blocks to the pools
+    void FlushThreadCache();
+
+public:
+    [[nodiscard]] SizeClassStats GetSizeClassStats(std::size_t index) const;
+    [[nodiscard]] std::size_t GetLargeBytes() const;
+    [[nodiscard]] std::size_t GetLargeCount() const;
+    // Index of the size class serving the request, kSizeClassCount for the
+    // large path
+    static std::size_t GetSizeClass(std::size_t size, std::size_t alignment);
 
 private:
+    static constexpr std::size_t kMagazineCapacity = 64;
 
+    // Sub-class k of a class ends at (16 + k + 1) / 32 of the class size.
+    // Sizes are rounded up to 16 bytes to keep the default alignment, which
+    // makes some sub-classes below 256 bytes repeat and never get picked.
+    static constexpr std::array<std::size_t, kSizeClassCount> kBlockSizes = []
+    {
+        std::array<std::size_t, kSizeClassCount> sizes{};
+        for (std::size_t i = 0; i < sizes.size(); ++i)
+        {
+            std::size_t class_size = kMinClassSize << (i / kSubClassCount);
+            std::size_t size = class_size / 2 + (i % kSubClassCount + 1) * class_size / (2 * kSubClassCount);
+            sizes[i] = (size + kMinClassSize - 1) / kMinClassSize * kMinClassSize;
+        }
+        return sizes;
+    }();
+
+    struct Magazine
+    {
+        std::size_t count;
+        void* blocks[kMagazineCapacity];
+    };
+
+    struct alignas(64) ThreadCache
+    {
+        Magazine magazines[kSizeClassCount];
+    };
+
+    struct alignas(64) ClassLock
+    {
+        std::mutex mutex;
+    };
+
+    template<std::size_t... kIndex>
+    static std::tuple<memory::PoolAllocator<kBlockSizes[kIndex]>...> MakePoolTuple(std::index_sequence<kIndex...>);
+    typedef decltype(MakePoolTuple(std::make_index_sequence<kSizeClassCount>{})) Pools;
+
+private:
+    template<std::size_t... kIndex>
+    static Pools MakePools(unsigned char* base, std::size_t slice_capacity, std::index_sequence<kIndex...>);
+
+private:
+    ThreadCache* GetThreadCache();
+    bool Commit(std::size_t index, std::size_t blocks);
+    void* AllocateShared(std::size_t index);
+    void FreeShared(std::size_t index, void* pointer);
+    void Refill(std::size_t index, Magazine& magazine);
+    void Drain(std::size_t index, Magazine& magazine, std::size_t count);
+    void* AllocateLarge(std::size_t size, std::size_t alignment, memory::MemoryTag tag);
+    void FreeLarge(void* pointer);
+    unsigned char& GetTag(std::size_t index, const void* pointer) const;
+
+private:
+    static std::size_t GetBlockSize(std::size_t index);
+    static std::size_t GetBatchSize(std::size_t index);
+    static std::size_t GetReservationSize(std::size_t class_capacity, std::size_t page_size);
+
+private:
+    std::size_t class_capacity_;
+    // Each size class owns a slice of this size, a power of two
+    std::size_t slice_capacity_;
+    std::size_t page_size_;
+    unsigned char* base_;
+    std::array<unsigned char*, kClassCount> tags_;
+    ThreadCache* caches_;
+    Pools pools_;
+    // Blocks per size class backed by committed pages, guarded by its lock
+    std::array<std::size_t, kSizeClassCount> committed_;
+    mutable std::array<ClassLock, kSizeClassCount> locks_;
+    std::atomic<std::size_t> large_bytes_;
+    std::atomic<std::size_t> large_count_;
 };
 
+//----------------------------------------------------------------------
+
 }
 
 }
 
-#endif
\ No newline at end of file
+#endif
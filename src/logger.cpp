@@ -1,20 +1,53 @@
 
-#include <fstream>
-#include <ctime>
 #include <stdexcept>
 #include <array>
-#include <chrono>
-#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "logger.h"
 #include "format.h"
+#include "logging/timestamp.h"
+#include "logging/flight_recorder.h"
+#include "logging/file_sink.h"
 
 namespace ruthen
 {
 
 std::shared_ptr<Logger> SystemLogger = std::make_shared<Logger>("System Logger", Logger::kTrace);
 
+static logging::TimestampCache kTimestampCache{"[%4.%5.%6 %1:%2:%3]"};
+
+// Legacy loggers have no id, their records are told apart by name
+static constexpr LoggerID kLegacyLoggerID = ~LoggerID{0};
+
+// Legacy log files go through one FileSink each, so they get the same
+// time index as the LogManager sinks. Every line is flushed right away.
+struct LegacySinks
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<logging::FileSink>> sinks;
+};
+
+static bool WriteLegacyLine(const std::string& file_name, std::string_view line, const logging::LogEntry& entry)
+{
+    static LegacySinks legacy;
+    std::lock_guard<std::mutex> lock{legacy.mutex};
+    std::unique_ptr<logging::FileSink>& sink = legacy.sinks[file_name];
+    if(sink == nullptr) sink = std::make_unique<logging::FileSink>(file_name, logging::SinkConfig{});
+    if(!sink->IsOpen())
+    {
+        legacy.sinks.erase(file_name);
+        return false;
+    }
+    sink->Write(line, entry);
+    sink->Flush();
+    return true;
+}
+
 //------------------------------------------------------------
 //------------------------------------------------------------
 //------------------------------------------------------------
@@ -38,8 +71,7 @@ Logger::Logger(const std::string& name) :
     level_{LogLevel::kTrace},
     logger_name_{name},
     log_details_recognition_flag_{true},
-    log_details_stack_limit_{500},
-    log_details_{}
+    details_cleared_at_{0}
 {}
 
 //------------------------------------------------------------
@@ -48,8 +80,7 @@ Logger::Logger(const std::string& name, LogLevel level) :
     level_{level},
     logger_name_{name},
     log_details_recognition_flag_{true},
-    log_details_stack_limit_{500},
-    log_details_{}
+    details_cleared_at_{0}
 {}
 
 //------------------------------------------------------------
@@ -58,8 +89,7 @@ Logger::Logger(const Logger& src) :
     level_{src.level_},
     logger_name_{src.logger_name_},
     log_details_recognition_flag_{src.log_details_recognition_flag_},
-    log_details_stack_limit_{src.log_details_stack_limit_},
-    log_details_{src.log_details_}
+    details_cleared_at_{src.details_cleared_at_}
 {}
 
 //------------------------------------------------------------
@@ -69,8 +99,7 @@ Logger& Logger::operator=(const Logger& rhs)
     level_ = rhs.level_;
     logger_name_ = rhs.logger_name_;
     log_details_recognition_flag_ = rhs.log_details_recognition_flag_;
-    log_details_stack_limit_ = rhs.log_details_stack_limit_;
-    log_details_ = rhs.log_details_;
+    details_cleared_at_ = rhs.details_cleared_at_;
     return *this;
 }
 
@@ -80,8 +109,7 @@ Logger::Logger(Logger&& src) noexcept :
     level_{std::move(src.level_)},
     logger_name_{std::move(src.logger_name_)},
     log_details_recognition_flag_{std::move(src.log_details_recognition_flag_)},
-    log_details_stack_limit_{std::move(src.log_details_stack_limit_)},
-    log_details_{std::move(src.log_details_)}
+    details_cleared_at_{src.details_cleared_at_}
 {}
 
 //------------------------------------------------------------
@@ -91,17 +119,14 @@ Logger& Logger::operator=(Logger&& rhs) noexcept
     level_ = rhs.level_;
     logger_name_ = rhs.logger_name_;
     log_details_recognition_flag_ = rhs.log_details_recognition_flag_;
-    log_details_stack_limit_ = rhs.log_details_stack_limit_;
-    log_details_ = rhs.log_details_;
+    details_cleared_at_ = rhs.details_cleared_at_;
     return *this;
 }
 
 //------------------------------------------------------------
 
 Logger::~Logger() 
-{
-    log_details_.clear();
-}
+{}
 
 //------------------------------------------------------------
 
@@ -121,21 +146,10 @@ void Logger::SetLevel(LogLevel level)
 
 bool Logger::WriteLogDetailsToFile(const std::string& file_name)
 {
-    std::ofstream file;
-    file.exceptions(std::ios::badbit | std::ios::failbit);
-    file.open(file_name, std::ios::app);
-    if(file.fail() || !file.is_open()) return false;
-    for(const auto& details : log_details_)
-    {
-        file << std::string(50, '-') << '\n';
-        file << "Exact time              : " << details.time_string << '\n';
-        file << "Nanoseconds since epoch : " << details.since_epoch_nano << '\n';
-        file << "Log sender name         : " << details.name << '\n';
-        file << "Level of the log        : " << kLevelNames[static_cast<std::size_t>(details.level)] << '\n';
-        file << "Log file destination    : "<< details.destination << '\n';
-        file << "Formated log message    : "<< details.formated_message << '\n';
-    }
-    file.close();
+    int descriptor = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(descriptor < 0) return false;
+    logging::FlightRecorder::StaticInstance()->Dump(descriptor);
+    ::close(descriptor);
     return true;
 }
 
@@ -143,23 +157,7 @@ bool Logger::WriteLogDetailsToFile(const std::string& file_name)
 
 void Logger::ClearLogDetails()
 {
-    log_details_.clear();
-}
-
-//------------------------------------------------------------
-
-void Logger::SetLogDetailsLimit(std::size_t stack_limit)
-{
-    if(stack_limit <= 0) throw std::invalid_argument{"Log details recognition limit is to to zero or lower"};
-    log_details_stack_limit_= stack_limit;
-}
-
-//------------------------------------------------------------
-
-void Logger::EraseLogDetails(std::size_t index_from_top)
-{
-    if(index_from_top + 1 > log_details_.size()) throw std::invalid_argument{"Failed to erase log details of an invalid index"};
-    log_details_.erase(log_details_.begin() + log_details_.size() + index_from_top - 1);
+    details_cleared_at_ = logging::FlightRecorder::StaticInstance()->Head();
 }
 
 //------------------------------------------------------------
@@ -173,48 +171,21 @@ void Logger::SwitchLogDetailsRecognition(bool flag)
 
 bool Logger::Log(const std::string& file_name, const std::string& message)
 {
-    std::ofstream file;
-    file.exceptions(std::ios::badbit | std::ios::failbit);
-    file.open(file_name, std::ios::app);
-    if(file.fail() || !file.is_open()) return false;
-    std::time_t time = std::time(nullptr);
-    std::tm* tm = std::localtime(&time);
-    std::string formated = Format("[%1.%2.%3 %4:%5:%6] [%7] |%8| : %9", 
-                                    std::to_string(tm->tm_mday), 
-                                    std::to_string(tm->tm_mon + 1), 
-                                    std::to_string(tm->tm_year + 1900),
-                                    std::to_string(tm->tm_sec),
-                                    std::to_string(tm->tm_min),
-                                    std::to_string(tm->tm_hour),
+    std::int64_t nano = logging::CurrentTimestamp();
+    logging::TimestampText time = kTimestampCache.Get(nano);
+    std::string formated = Format("%1 [%2] |%3| : %4\n",
+                                    time.View(),
                                     GetName(),
                                     kLevelNames[static_cast<std::size_t>(level_)],
                                     message
                                     );
-    file << formated << std::endl;
-    file.close();
-    if(log_details_recognition_flag_ && log_details_stack_limit_ > log_details_.size())
+    logging::LogEntry entry{nano, kLegacyLoggerID, static_cast<ruthen::LogLevel>(level_), logger_name_, file_name, message, false, 0};
+    if(!WriteLegacyLine(file_name, formated, entry)) return false;
+    if(log_details_recognition_flag_)
     {
-        LogDetails details;
-
-        auto now = std::chrono::system_clock::now();
-        auto since_epoch = now.time_since_epoch();
-        std::int64_t nano = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
-        details.time_string = Format("[%1.%2.%3 %4:%5:%6]", 
-                                    std::to_string(tm->tm_mday), 
-                                    std::to_string(tm->tm_mon + 1), 
-                                    std::to_string(tm->tm_year + 1900),
-                                    std::to_string(tm->tm_sec),
-                                    std::to_string(tm->tm_min),
-                                    std::to_string(tm->tm_hour)
-                                    );
-        details.since_epoch_nano = nano;
-        details.name = logger_name_;
-        details.level = level_;
-        details.destination = std::filesystem::absolute(file_name);
-        details.formated_message = message;
-
-        log_details_.emplace_back(std::move(details));
+        logging::FlightRecorder::StaticInstance()->Record(nano, kLegacyLoggerID, static_cast<ruthen::LogLevel>(level_), logger_name_, message);
     }
+    if(level_ >= kCrash) logging::FlightRecorder::StaticInstance()->DumpCrashLog();
     return true;
 }
 
@@ -222,49 +193,22 @@ bool Logger::Log(const std::string& file_name, const std::string& message)
 
 bool Logger::Log(LogLevel level, const std::string& file_name, const std::string& message)
 {
-    std::ofstream file;
-    file.exceptions(std::ios::badbit | std::ios::failbit);
-    file.open(file_name, std::ios::app);
-    if(file.fail() || !file.is_open()) return false;
-    std::time_t time = std::time(nullptr);
-    std::tm* tm = std::localtime(&time);
-    std::string formated = Format("[%1.%2.%3 %4:%5:%6] [%7] |%8| : %9", 
-                                    std::to_string(tm->tm_mday), 
-                                    std::to_string(tm->tm_mon + 1), 
-                                    std::to_string(tm->tm_year + 1900),
-                                    std::to_string(tm->tm_sec),
-                                    std::to_string(tm->tm_min),
-                                    std::to_string(tm->tm_hour),
+    if(!ShouldLog(level)) return true;
+    std::int64_t nano = logging::CurrentTimestamp();
+    logging::TimestampText time = kTimestampCache.Get(nano);
+    std::string formated = Format("%1 [%2] |%3| : %4\n",
+                                    time.View(),
                                     GetName(),
                                     kLevelNames[static_cast<std::size_t>(level)],
                                     message
                                     );
-    file << formated << std::endl;
-    file.close();
-    if(log_details_recognition_flag_ && log_details_stack_limit_ > log_details_.size())
+    logging::LogEntry entry{nano, kLegacyLoggerID, static_cast<ruthen::LogLevel>(level), logger_name_, file_name, message, false, 0};
+    if(!WriteLegacyLine(file_name, formated, entry)) return false;
+    if(log_details_recognition_flag_)
     {
-        LogDetails details;
-
-        auto now = std::chrono::system_clock::now();
-        auto since_epoch = now.time_since_epoch();
-        std::int64_t nano = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
-        
-        details.time_string = Format("[%1.%2.%3 %4:%5:%6]", 
-                                    std::to_string(tm->tm_mday), 
-                                    std::to_string(tm->tm_mon + 1), 
-                                    std::to_string(tm->tm_year + 1900),
-                                    std::to_string(tm->tm_sec),
-                                    std::to_string(tm->tm_min),
-                                    std::to_string(tm->tm_hour)
-                                    );
-        details.since_epoch_nano = nano;
-        details.name = logger_name_;
-        details.level = level;
-        details.destination = std::filesystem::absolute(file_name);
-        details.formated_message = message;
-
-        log_details_.emplace_back(std::move(details));
+        logging::FlightRecorder::StaticInstance()->Record(nano, kLegacyLoggerID, static_cast<ruthen::LogLevel>(level), logger_name_, message);
     }
+    if(level >= kCrash) logging::FlightRecorder::StaticInstance()->DumpCrashLog();
 
     return true;
 }
@@ -280,34 +224,59 @@ std::string Logger::GetName() const
 
 bool Logger::LogDetailsEmpty() const
 {
-    return log_details_.empty();
+    return !FindLogDetails(0, true, nullptr);
 }
 
 //------------------------------------------------------------
 
-const Logger::LogDetails& Logger::GetLogDetails(std::size_t index_from_top) const
+Logger::LogDetails Logger::GetLogDetails(std::size_t index_from_top) const
 {
-    if(index_from_top + 1 > log_details_.size()) throw std::invalid_argument{"Failed to obtain log details via an invalid index"};
-    return *(log_details_.begin() + log_details_.size() - index_from_top - 1);
+    LogDetails details;
+    if(!FindLogDetails(index_from_top, true, &details)) throw std::invalid_argument{"Failed to obtain log details via an invalid index"};
+    return details;
 }
 
 //------------------------------------------------------------
 
-const Logger::LogDetails& Logger::GetLastLogDetails() const
+Logger::LogDetails Logger::GetLastLogDetails() const
 {
-    if(log_details_.size() <= 0) throw std::out_of_range{"Failed to obtain the last log details from an empty log details stack"};
-    return log_details_.back();
+    LogDetails details;
+    if(!FindLogDetails(0, true, &details)) throw std::out_of_range{"Failed to obtain the last log details from an empty log details stack"};
+    return details;
 }
 
 //------------------------------------------------------------
 
-const Logger::LogDetails& Logger::GetOldestLogDetails() const
+Logger::LogDetails Logger::GetOldestLogDetails() const
 {
-    if(log_details_.size() <= 0) throw std::out_of_range{"Failed to obtain the oldest log details from an empty log details stack"};
-    return log_details_.front();
+    LogDetails details;
+    if(!FindLogDetails(0, false, &details)) throw std::out_of_range{"Failed to obtain the oldest log details from an empty log details stack"};
+    return details;
 }
 
 //------------------------------------------------------------
+
+// Scans the recorder in place and stops at the index-th record of this logger
+bool Logger::FindLogDetails(std::size_t index, bool newest_first, LogDetails* details) const
+{
+    std::string_view name = std::string_view{logger_name_}.substr(0, logging::FlightRecord::kNameCapacity);
+    bool found = false;
+    logging::FlightRecorder::StaticInstance()->Visit(details_cleared_at_, newest_first, [&](const logging::FlightRecord& record)
+    {
+        if(record.logger != kLegacyLoggerID || std::string_view{record.name, record.name_size} != name) return true;
+        if(index-- != 0) return true;
+        found = true;
+        if(details == nullptr) return false;
+        details->time_string = kTimestampCache.Get(record.timestamp);
+        details->since_epoch_nano = record.timestamp;
+        details->name = logger_name_;
+        details->level = static_cast<LogLevel>(record.level);
+        details->formated_message.assign(record.message, record.message_size);
+        return false;
+    });
+    return found;
+}
+
 //------------------------------------------------------------
 //------------------------------------------------------------
 
@@ -0,0 +1,178 @@
+#include <stdexcept>
+
+#include "logging/async_writer.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+AsyncWriter::AsyncWriter(const AsyncConfig& config, LogOutput& output) :
+    config_{config},
+    output_{output},
+    queue_{config.queue_capacity},
+    batch_{},
+    thread_{},
+    mutex_{},
+    wake_condition_{},
+    flush_condition_{},
+    running_{false},
+    stop_requested_{false},
+    writer_sleeping_{false},
+    flush_requests_{0},
+    written_position_{0},
+    dropped_{0},
+    overwritten_{0}
+{
+    if(config_.batch_size == 0) throw std::invalid_argument{"async writer batch size must be positive"};
+    batch_.reserve(config_.batch_size);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    Stop();
+}
+
+//----------------------------------------------------------------------
+
+void AsyncWriter::Start()
+{
+    if(running_.exchange(true)) return;
+    stop_requested_.store(false);
+    thread_ = std::thread{&AsyncWriter::Run, this};
+}
+
+void AsyncWriter::Stop()
+{
+    if(!running_.load()) return;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_requested_.store(true);
+    }
+    wake_condition_.notify_one();
+    if(thread_.joinable()) thread_.join();
+    running_.store(false);
+    flush_condition_.notify_all();
+}
+
+bool AsyncWriter::Push(const LogEntry& entry)
+{
+    auto fill = [&entry](LogRecord& record) { record.Assign(entry); };
+    while(!queue_.TryPush(fill))
+    {
+        switch(config_.overflow_policy)
+        {
+            case OverflowPolicy::kDrop:
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            case OverflowPolicy::kOverwrite:
+                if(DiscardOldest()) overwritten_.fetch_add(1, std::memory_order_relaxed);
+                else std::this_thread::yield();
+                break;
+            case OverflowPolicy::kBlock:
+            default:
+                WakeWriter();
+                std::this_thread::yield();
+                break;
+        }
+    }
+    if(writer_sleeping_.load() && queue_.WritePosition() - queue_.ReadPosition() >= config_.batch_size) WakeWriter();
+    return true;
+}
+
+void AsyncWriter::Flush()
+{
+    if(!running_.load() || std::this_thread::get_id() == thread_.get_id()) return;
+    std::size_t target = queue_.WritePosition();
+    std::unique_lock<std::mutex> lock{mutex_};
+    flush_requests_.fetch_add(1);
+    wake_condition_.notify_one();
+    flush_condition_.wait(lock, [&]() { return written_position_.load() >= target || !running_.load(); });
+    flush_requests_.fetch_sub(1);
+}
+
+//----------------------------------------------------------------------
+
+bool AsyncWriter::IsRunning() const
+{
+    return running_.load();
+}
+
+std::uint64_t AsyncWriter::DroppedCount() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AsyncWriter::OverwrittenCount() const
+{
+    return overwritten_.load(std::memory_order_relaxed);
+}
+
+const AsyncConfig& AsyncWriter::GetConfig() const
+{
+    return config_;
+}
+
+//----------------------------------------------------------------------
+
+void AsyncWriter::Run()
+{
+    while(true)
+    {
+        RingBuffer<LogRecord>::Batch batch = queue_.Claim(config_.batch_size);
+        if(batch.count > 0)
+        {
+            batch_.clear();
+            for(std::size_t i = 0; i < batch.count; ++i)
+            {
+                batch_.push_back(queue_.At(batch, i).View());
+            }
+            output_.Write(batch_.data(), batch_.size());
+            queue_.Release(batch);
+            if(batch.count == config_.batch_size) continue;
+        }
+
+        output_.Flush();
+        written_position_.store(queue_.ReadPosition());
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+        }
+        flush_condition_.notify_all();
+        if(stop_requested_.load() && queue_.Empty()) break;
+
+        std::unique_lock<std::mutex> lock{mutex_};
+        writer_sleeping_.store(true);
+        wake_condition_.wait_for(lock, config_.flush_interval, [this]()
+        {
+            return stop_requested_.load() ||
+                   queue_.WritePosition() - queue_.ReadPosition() >= config_.batch_size ||
+                   (flush_requests_.load() > 0 && written_position_.load() < queue_.WritePosition());
+        });
+        writer_sleeping_.store(false);
+    }
+}
+
+void AsyncWriter::WakeWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+    }
+    wake_condition_.notify_one();
+}
+
+bool AsyncWriter::DiscardOldest()
+{
+    RingBuffer<LogRecord>::Batch batch = queue_.Claim(1);
+    if(batch.count == 0) return false;
+    queue_.Release(batch);
+    return true;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
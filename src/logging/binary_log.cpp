@@ -0,0 +1,238 @@
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+#include "logging/binary_log.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr std::size_t kFormatChunkSize = 1024;
+
+// Formats live in fixed chunks that are never reallocated. A format is
+// written before size is released, readers acquire size and only look at
+// ids below it.
+struct FormatRegistry
+{
+    std::mutex mutex;
+    std::atomic<std::size_t> size{0};
+    std::array<std::unique_ptr<FormatInfo[]>, kMaxFormats / kFormatChunkSize> chunks;
+};
+
+FormatRegistry& Registry()
+{
+    static FormatRegistry registry;
+    return registry;
+}
+
+// Binary records are not entry text, the time index does not apply
+SinkConfig BinaryLogConfig()
+{
+    SinkConfig config;
+    config.write_index = false;
+    return config;
+}
+
+template<typename T>
+void AppendValue(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void AppendString(std::string& out, std::string_view text)
+{
+    AppendValue(out, static_cast<std::uint32_t>(text.size()));
+    out.append(text);
+}
+
+template<typename T>
+T LoadValue(std::string_view data, std::size_t offset)
+{
+    T value{};
+    if (offset + sizeof(T) <= data.size()) std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+std::size_t ArgumentSize(char code, std::string_view data, std::size_t offset)
+{
+    switch(code)
+    {
+        case 'b':
+        case 'c': return 1;
+        case 's': return sizeof(std::uint32_t) + LoadValue<std::uint32_t>(data, offset);
+        default: return 8;
+    }
+}
+
+}
+
+//----------------------------------------------------------------------
+
+const FormatInfo* RegisterFormat(std::string_view format, std::string_view destination, LogLevel level,
+                                 std::string_view file, std::uint32_t line, std::string_view signature)
+{
+    FormatRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    std::size_t index = registry.size.load(std::memory_order_relaxed);
+    if (index == kMaxFormats) return nullptr;
+    std::unique_ptr<FormatInfo[]>& chunk = registry.chunks[index / kFormatChunkSize];
+    if (chunk == nullptr) chunk = std::make_unique<FormatInfo[]>(kFormatChunkSize);
+    FormatInfo& info = chunk[index % kFormatChunkSize];
+    info = FormatInfo{static_cast<FormatID>(index + 1), level, line, std::string{format}, std::string{destination},
+                      std::string{file}, std::string{signature}};
+    registry.size.store(index + 1, std::memory_order_release);
+    return &info;
+}
+
+const FormatInfo* FindFormat(FormatID id)
+{
+    FormatRegistry& registry = Registry();
+    if (id == 0 || id > registry.size.load(std::memory_order_acquire)) return nullptr;
+    std::size_t index = id - 1;
+    return &registry.chunks[index / kFormatChunkSize][index % kFormatChunkSize];
+}
+
+std::string DecodeMessage(std::string_view format, std::string_view signature, std::string_view arguments)
+{
+    struct Decoder
+    {
+        std::string& out;
+        std::string_view format;
+        std::string_view signature;
+        std::string_view arguments;
+        std::size_t offsets[ruthen::detail::kMaxFormatSegments];
+
+        void Literal(std::size_t offset, std::size_t size) { out.append(format.substr(offset, size)); }
+        void Argument(std::size_t index)
+        {
+            if (index >= ruthen::detail::kMaxFormatSegments) return;
+            ruthen::detail::IteratorWriter<std::back_insert_iterator<std::string>> writer{std::back_inserter(out)};
+            std::size_t offset = offsets[index];
+            switch(signature[index])
+            {
+                case 'b': ruthen::detail::WriteArgument(writer, LoadValue<char>(arguments, offset) != 0); break;
+                case 'c': ruthen::detail::WriteArgument(writer, LoadValue<char>(arguments, offset)); break;
+                case 'i': ruthen::detail::WriteArgument(writer, LoadValue<std::int64_t>(arguments, offset)); break;
+                case 'u': ruthen::detail::WriteArgument(writer, LoadValue<std::uint64_t>(arguments, offset)); break;
+                case 'd': ruthen::detail::WriteArgument(writer, LoadValue<double>(arguments, offset)); break;
+                case 't': ruthen::detail::WriteArgument(writer, Time::FromNanoseconds(LoadValue<std::int64_t>(arguments, offset))); break;
+                case 's':
+                {
+                    std::size_t begin = std::min(offset + sizeof(std::uint32_t), arguments.size());
+                    out.append(arguments.substr(begin, LoadValue<std::uint32_t>(arguments, offset)));
+                    break;
+                }
+                default: break;
+            }
+        }
+    };
+
+    std::string result;
+    Decoder decoder{result, format, signature, arguments, {}};
+    std::size_t offset = 0;
+    std::size_t count = std::min(signature.size(), ruthen::detail::kMaxFormatSegments);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        decoder.offsets[i] = offset;
+        offset += ArgumentSize(signature[i], arguments, offset);
+    }
+    ruthen::detail::ParseFormat<'%'>(format, count, false, decoder);
+    return result;
+}
+
+//----------------------------------------------------------------------
+
+BinaryLogWriter::BinaryLogWriter(const std::string& path) :
+    mutex_{},
+    sink_{path, BinaryLogConfig()},
+    defined_formats_{},
+    payload_{},
+    frame_{}
+{
+    if (!sink_.IsOpen()) throw std::runtime_error{"failed to open binary log file"};
+    sink_.Write(std::string_view{kBinaryLogMagic, sizeof(kBinaryLogMagic)}, CurrentTimestamp());
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+    Flush();
+}
+
+//----------------------------------------------------------------------
+
+void BinaryLogWriter::DefineLogger(LoggerID id, std::string_view name)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    payload_.clear();
+    AppendValue(payload_, static_cast<std::uint64_t>(id));
+    AppendString(payload_, name);
+    WriteFrame(FrameKind::kLogger, CurrentTimestamp());
+}
+
+void BinaryLogWriter::Write(const LogEntry& entry)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (entry.format >= defined_formats_.size()) defined_formats_.resize(entry.format + 1, false);
+    if (!defined_formats_[entry.format])
+    {
+        const FormatInfo* info = FindFormat(entry.format);
+        if (info == nullptr) return;
+        payload_.clear();
+        AppendValue(payload_, info->id);
+        AppendValue(payload_, static_cast<std::int32_t>(info->level));
+        AppendValue(payload_, info->line);
+        AppendString(payload_, info->format);
+        AppendString(payload_, info->destination);
+        AppendString(payload_, info->file);
+        AppendString(payload_, info->signature);
+        WriteFrame(FrameKind::kFormat, entry.timestamp);
+        defined_formats_[entry.format] = true;
+    }
+
+    payload_.clear();
+    AppendValue(payload_, entry.format);
+    AppendValue(payload_, static_cast<std::int64_t>(entry.timestamp));
+    AppendValue(payload_, static_cast<std::uint64_t>(entry.logger));
+    AppendValue(payload_, static_cast<std::int32_t>(entry.level));
+    payload_.append(entry.message);
+    WriteFrame(FrameKind::kRecord, entry.timestamp);
+}
+
+void BinaryLogWriter::Flush()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    sink_.Flush();
+}
+
+//----------------------------------------------------------------------
+
+const std::string& BinaryLogWriter::GetPath() const
+{
+    return sink_.GetPath();
+}
+
+//----------------------------------------------------------------------
+
+void BinaryLogWriter::WriteFrame(FrameKind kind, std::int64_t timestamp)
+{
+    frame_.clear();
+    AppendValue(frame_, static_cast<std::uint8_t>(kind));
+    AppendValue(frame_, static_cast<std::uint32_t>(payload_.size()));
+    frame_.append(payload_);
+    sink_.Write(frame_, timestamp);
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging/compression.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kLastLiterals = 5;
+// No match starts this close to the end, the tail is always literals
+constexpr std::size_t kMatchSafety = 12;
+constexpr std::size_t kMaxOffset = 0xffff;
+constexpr unsigned kHashBits = 13;
+constexpr std::uint32_t kEmptySlot = std::numeric_limits<std::uint32_t>::max();
+constexpr std::size_t kFooterSize = 24;
+
+std::uint32_t Read32(const char* data)
+{
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::uint32_t Hash(std::uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// Appends the 255-run extension of a length whose nibble saturated
+bool WriteLength(char*& out, const char* end, std::size_t length)
+{
+    while (length >= 255)
+    {
+        if (out >= end) return false;
+        *out++ = static_cast<char>(255);
+        length -= 255;
+    }
+    if (out >= end) return false;
+    *out++ = static_cast<char>(length);
+    return true;
+}
+
+bool ReadLength(const unsigned char*& in, const unsigned char* end, std::size_t& length)
+{
+    unsigned char byte;
+    do
+    {
+        if (in >= end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool WriteSequence(char*& out, const char* end, const char* literals, std::size_t literal_size, std::size_t offset, std::size_t match_size)
+{
+    if (out >= end) return false;
+    char* token = out++;
+    std::size_t match_code = match_size > 0 ? match_size - kMinMatch : 0;
+    *token = static_cast<char>((std::min<std::size_t>(literal_size, 15) << 4) | std::min<std::size_t>(match_code, 15));
+    if (literal_size >= 15 && !WriteLength(out, end, literal_size - 15)) return false;
+    if (static_cast<std::size_t>(end - out) < literal_size) return false;
+    std::memcpy(out, literals, literal_size);
+    out += literal_size;
+    if (match_size == 0) return true;
+    if (end - out < 2) return false;
+    *out++ = static_cast<char>(offset & 0xff);
+    *out++ = static_cast<char>(offset >> 8);
+    return match_code < 15 || WriteLength(out, end, match_code - 15);
+}
+
+bool WriteAll(int descriptor, const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(descriptor, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool ReadAll(int descriptor, char* data, std::size_t size, std::uint64_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t result = ::pread(descriptor, data, size, static_cast<off_t>(offset));
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        data += result;
+        size -= static_cast<std::size_t>(result);
+        offset += static_cast<std::uint64_t>(result);
+    }
+    return true;
+}
+
+template<typename T>
+void Append(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
+
+//----------------------------------------------------------------------
+
+std::size_t CompressBound(std::size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+std::size_t CompressBlock(const char* source, std::size_t size, char* destination, std::size_t capacity)
+{
+    char* out = destination;
+    const char* end = destination + capacity;
+    std::size_t anchor = 0;
+    if (size > kMatchSafety)
+    {
+        std::uint32_t table[1u << kHashBits];
+        std::fill(std::begin(table), std::end(table), kEmptySlot);
+        std::size_t limit = size - kMatchSafety;
+        std::size_t match_limit = size - kLastLiterals;
+        std::size_t position = 0;
+        while (position < limit)
+        {
+            std::uint32_t sequence = Read32(source + position);
+            std::uint32_t& slot = table[Hash(sequence)];
+            std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(position);
+            if (candidate == kEmptySlot || position - candidate > kMaxOffset || Read32(source + candidate) != sequence)
+            {
+                // Skip faster through data that does not compress
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+            std::size_t match_size = kMinMatch;
+            while (position + match_size < match_limit && source[candidate + match_size] == source[position + match_size]) ++match_size;
+            if (!WriteSequence(out, end, source + anchor, position - anchor, position - candidate, match_size)) return 0;
+            position += match_size;
+            anchor = position;
+            if (position - 2 < limit) table[Hash(Read32(source + position - 2))] = static_cast<std::uint32_t>(position - 2);
+        }
+    }
+    if (!WriteSequence(out, end, source + anchor, size - anchor, 0, 0)) return 0;
+    return static_cast<std::size_t>(out - destination);
+}
+
+std::size_t DecompressBlock(const char* source, std::size_t size, char* destination, std::size_t capacity)
+{
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(source);
+    const unsigned char* in_end = in + size;
+    char* out = destination;
+    char* out_end = destination + capacity;
+    while (in < in_end)
+    {
+        unsigned char token = *in++;
+        std::size_t literal_size = token >> 4;
+        if (literal_size == 15 && !ReadLength(in, in_end, literal_size)) return 0;
+        if (static_cast<std::size_t>(in_end - in) < literal_size || static_cast<std::size_t>(out_end - out) < literal_size) return 0;
+        std::memcpy(out, in, literal_size);
+        in += literal_size;
+        out += literal_size;
+        // The last sequence has no match
+        if (in == in_end) break;
+
+        if (in_end - in < 2) return 0;
+        std::size_t offset = static_cast<std::size_t>(in[0]) | (static_cast<std::size_t>(in[1]) << 8);
+        in += 2;
+        std::size_t match_size = token & 0x0f;
+        if (match_size == 15 && !ReadLength(in, in_end, match_size)) return 0;
+        match_size += kMinMatch;
+        if (offset == 0 || offset > static_cast<std::size_t>(out - destination) || static_cast<std::size_t>(out_end - out) < match_size) return 0;
+        const char* match = out - offset;
+        if (offset >= match_size) std::memcpy(out, match, match_size);
+        else for (std::size_t i = 0; i < match_size; ++i) out[i] = match[i];
+        out += match_size;
+    }
+    return static_cast<std::size_t>(out - destination);
+}
+
+//----------------------------------------------------------------------
+
+bool CompressLogFile(const std::string& path, const std::vector<TimeMark>& marks, const std::string& output)
+{
+    int input = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (input < 0) return false;
+    struct stat info{};
+    if (::fstat(input, &info) != 0)
+    {
+        ::close(input);
+        return false;
+    }
+    std::uint64_t file_size = static_cast<std::uint64_t>(info.st_size);
+
+    // Bytes no mark describes match every query
+    std::vector<TimeMark> ranges = marks;
+    if (ranges.empty() || ranges.front().offset != 0) ranges.insert(ranges.begin(), UnknownMark(0, ranges.empty() ? file_size : ranges.front().offset));
+
+    std::string temporary = output + ".tmp";
+    int descriptor = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (descriptor < 0)
+    {
+        ::close(input);
+        return false;
+    }
+
+    std::vector<char> raw(kCompressedBlockSize);
+    std::vector<char> compressed(CompressBound(kCompressedBlockSize));
+    std::vector<CompressedBlock> blocks;
+    std::uint64_t written = sizeof(kCompressedLogMagic);
+    bool ok = WriteAll(descriptor, kCompressedLogMagic, sizeof(kCompressedLogMagic));
+    for (std::size_t i = 0; ok && i < ranges.size(); ++i)
+    {
+        std::uint64_t begin = std::min(ranges[i].offset, file_size);
+        std::uint64_t end = i + 1 < ranges.size() ? std::min(ranges[i + 1].offset, file_size) : file_size;
+        while (ok && begin < end)
+        {
+            std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(end - begin, kCompressedBlockSize));
+            ok = ReadAll(input, raw.data(), size, begin);
+            if (!ok) break;
+            // Prefer cutting long ranges after a line break
+            if (begin + size < end)
+            {
+                const char* line_end = static_cast<const char*>(::memrchr(raw.data(), '\n', size));
+                if (line_end != nullptr) size = static_cast<std::size_t>(line_end - raw.data()) + 1;
+            }
+            std::size_t stored = CompressBlock(raw.data(), size, compressed.data(), compressed.size());
+            const char* data = compressed.data();
+            if (stored == 0 || stored >= size)
+            {
+                stored = size;
+                data = raw.data();
+            }
+            ok = WriteAll(descriptor, data, stored);
+            const TimeMark& mark = ranges[i];
+            blocks.push_back(CompressedBlock{written, static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(stored),
+                                             mark.first_timestamp, mark.last_timestamp, mark.logger_mask, mark.level_mask});
+            written += stored;
+            begin += size;
+        }
+    }
+    ::close(input);
+
+    std::string index;
+    for (const CompressedBlock& block : blocks)
+    {
+        Append(index, block.offset);
+        Append(index, block.raw_size);
+        Append(index, block.stored_size);
+        Append(index, block.first_timestamp);
+        Append(index, block.last_timestamp);
+        Append(index, block.logger_mask);
+        Append(index, block.level_mask);
+        Append(index, std::uint32_t{0});
+    }
+    Append(index, written);
+    Append(index, static_cast<std::uint32_t>(blocks.size()));
+    Append(index, std::uint32_t{0});
+    index.append(kCompressedIndexMagic, sizeof(kCompressedIndexMagic));
+    ok = ok && WriteAll(descriptor, index.data(), index.size());
+    ok = ::close(descriptor) == 0 && ok;
+    if (ok) ok = ::rename(temporary.c_str(), output.c_str()) == 0;
+    if (!ok) ::unlink(temporary.c_str());
+    return ok;
+}
+
+//----------------------------------------------------------------------
+
+CompressedLogReader::CompressedLogReader(const std::string& path) :
+    descriptor_{::open(path.c_str(), O_RDONLY | O_CLOEXEC)},
+    blocks_{}
+{
+    if (descriptor_ < 0) throw std::runtime_error{"failed to open " + path};
+    struct stat info{};
+    char footer[kFooterSize];
+    char magic[sizeof(kCompressedLogMagic)];
+    if (::fstat(descriptor_, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < sizeof(magic) + kFooterSize ||
+        !ReadAll(descriptor_, magic, sizeof(magic), 0) || std::memcmp(magic, kCompressedLogMagic, sizeof(magic)) != 0 ||
+        !ReadAll(descriptor_, footer, sizeof(footer), static_cast<std::uint64_t>(info.st_size) - kFooterSize) ||
+        std::memcmp(footer + 16, kCompressedIndexMagic, sizeof(kCompressedIndexMagic)) != 0)
+    {
+        ::close(descriptor_);
+        throw std::runtime_error{path + " is not a compressed log"};
+    }
+
+    std::uint64_t index_offset;
+    std::uint32_t count;
+    std::memcpy(&index_offset, footer, sizeof(index_offset));
+    std::memcpy(&count, footer + 8, sizeof(count));
+    constexpr std::size_t kEntrySize = 48;
+    if (index_offset + std::uint64_t{count} * kEntrySize + kFooterSize != static_cast<std::uint64_t>(info.st_size))
+    {
+        ::close(descriptor_);
+        throw std::runtime_error{path + " has a damaged block index"};
+    }
+    std::vector<char> index(std::size_t{count} * kEntrySize);
+    if (!ReadAll(descriptor_, index.data(), index.size(), index_offset))
+    {
+        ::close(descriptor_);
+        throw std::runtime_error{"failed to read the block index of " + path};
+    }
+    blocks_.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const char* entry = index.data() + i * kEntrySize;
+        CompressedBlock& block = blocks_[i];
+        std::memcpy(&block.offset, entry, 8);
+        std::memcpy(&block.raw_size, entry + 8, 4);
+        std::memcpy(&block.stored_size, entry + 12, 4);
+        std::memcpy(&block.first_timestamp, entry + 16, 8);
+        std::memcpy(&block.last_timestamp, entry + 24, 8);
+        std::memcpy(&block.logger_mask, entry + 32, 8);
+        std::memcpy(&block.level_mask, entry + 40, 4);
+    }
+}
+
+CompressedLogReader::~CompressedLogReader()
+{
+    ::close(descriptor_);
+}
+
+//----------------------------------------------------------------------
+
+void CompressedLogReader::ReadBlock(std::size_t index, std::string& out) const
+{
+    const CompressedBlock& block = blocks_.at(index);
+    std::vector<char> stored(block.stored_size);
+    if (!ReadAll(descriptor_, stored.data(), stored.size(), block.offset)) throw std::runtime_error{"compressed log is truncated"};
+    std::size_t base = out.size();
+    if (block.stored_size == block.raw_size)
+    {
+        out.append(stored.data(), stored.size());
+        return;
+    }
+    out.resize(base + block.raw_size);
+    if (DecompressBlock(stored.data(), stored.size(), out.data() + base, block.raw_size) != block.raw_size)
+    {
+        out.resize(base);
+        throw std::runtime_error{"compressed log block is damaged"};
+    }
+}
+
+void CompressedLogReader::ReadRange(std::int64_t from, std::int64_t to, std::string& out) const
+{
+    for (std::size_t i = 0; i < blocks_.size(); ++i)
+    {
+        if (blocks_[i].last_timestamp >= from && blocks_[i].first_timestamp <= to) ReadBlock(i, out);
+    }
+}
+
+//----------------------------------------------------------------------
+
+const std::vector<CompressedBlock>& CompressedLogReader::GetBlocks() const
+{
+    return blocks_;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+
+#include "logging/epoch.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+// The epoch a reader started in, 0 when idle
+struct alignas(64) ReaderSlot
+{
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<bool> used{false};
+};
+
+struct EpochDomain
+{
+    std::atomic<std::uint64_t> epoch{1};
+    std::atomic<std::uint32_t> overflow{0};
+    std::array<ReaderSlot, kMaxEpochReaders> slots;
+};
+
+EpochDomain& GetEpochDomain()
+{
+    static EpochDomain domain;
+    return domain;
+}
+
+// Claims a slot on the first guard of a thread and frees it at exit
+struct ThreadReader
+{
+    ThreadReader() :
+        slot{nullptr},
+        depth{0}
+    {
+        for (ReaderSlot& candidate : GetEpochDomain().slots)
+        {
+            bool expected = false;
+            if (candidate.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                slot = &candidate;
+                break;
+            }
+        }
+    }
+
+    ~ThreadReader()
+    {
+        if (slot != nullptr) slot->used.store(false, std::memory_order_release);
+    }
+
+    ReaderSlot* slot;
+    std::uint32_t depth;
+};
+
+thread_local ThreadReader thread_reader;
+
+}
+
+//----------------------------------------------------------------------
+
+EpochGuard::EpochGuard()
+{
+    ThreadReader& reader = thread_reader;
+    if (reader.depth++ != 0) return;
+    EpochDomain& domain = GetEpochDomain();
+    if (reader.slot == nullptr) domain.overflow.fetch_add(1, std::memory_order_seq_cst);
+    else reader.slot->epoch.store(domain.epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+EpochGuard::~EpochGuard()
+{
+    ThreadReader& reader = thread_reader;
+    if (--reader.depth != 0) return;
+    if (reader.slot == nullptr) GetEpochDomain().overflow.fetch_sub(1, std::memory_order_release);
+    else reader.slot->epoch.store(0, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------
+
+// Callers unpublish first, so a reader that may still see the object
+// announced this epoch or an older one
+std::uint64_t AdvanceEpoch()
+{
+    return GetEpochDomain().epoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+std::uint64_t OldestActiveEpoch()
+{
+    EpochDomain& domain = GetEpochDomain();
+    if (domain.overflow.load(std::memory_order_seq_cst) != 0) return 0;
+    std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+    for (const ReaderSlot& slot : domain.slots)
+    {
+        std::uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0) oldest = std::min(oldest, epoch);
+    }
+    return oldest;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,402 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "logging/file_sink.h"
+#include "logging/binary_log.h"
+#include "logging/mapped_sink.h"
+#include "logging/segment_compressor.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+FileSink::FileSink(const std::string& path, const SinkConfig& config, RotationHandler rotation_handler) :
+    path_{path},
+    config_{config},
+    rotation_handler_{std::move(rotation_handler)},
+    index_{},
+    mark_{},
+    has_mark_{false},
+    marks_{},
+    descriptor_{-1},
+    buffer_(config.buffer_size),
+    buffered_{0},
+    file_size_{0},
+    opened_at_{0},
+    flushed_at_{0}
+{
+    Open(CurrentTimestamp());
+}
+
+FileSink::~FileSink()
+{
+    Close();
+}
+
+//----------------------------------------------------------------------
+
+void FileSink::Write(std::string_view text, const LogEntry& entry)
+{
+    if (ShouldRotate(text.size(), entry.timestamp)) Rotate(entry.timestamp);
+    if (descriptor_ >= 0 && (config_.write_index || config_.compress_rotated)) Mark(text.size(), entry);
+    Write(text, entry.timestamp);
+}
+
+void FileSink::Write(std::string_view bytes, std::int64_t timestamp)
+{
+    if (ShouldRotate(bytes.size(), timestamp)) Rotate(timestamp);
+    if (descriptor_ < 0) return;
+    if (buffered_ + bytes.size() > buffer_.size()) WriteOut(bytes);
+    else
+    {
+        std::memcpy(buffer_.data() + buffered_, bytes.data(), bytes.size());
+        buffered_ += bytes.size();
+    }
+    std::int64_t flush_interval = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.flush_interval).count();
+    if (timestamp - flushed_at_ >= flush_interval) Flush();
+}
+
+void FileSink::Flush()
+{
+    if (buffered_ > 0) WriteOut({});
+    flushed_at_ = CurrentTimestamp();
+}
+
+void FileSink::Rotate(std::int64_t timestamp)
+{
+    Close();
+    std::string rotated = NextRotatedPath(path_);
+    bool renamed = ::rename(path_.c_str(), rotated.c_str()) == 0;
+    if (renamed && config_.write_index)
+    {
+        std::string index = path_ + std::string{kLogIndexExtension};
+        ::rename(index.c_str(), (rotated + std::string{kLogIndexExtension}).c_str());
+    }
+    if (renamed && config_.compress_rotated && rotation_handler_) rotation_handler_(rotated, std::move(marks_));
+    marks_.clear();
+    Open(timestamp);
+}
+
+void FileSink::SetConfig(const SinkConfig& config)
+{
+    Flush();
+    bool indexed = config_.write_index;
+    config_ = config;
+    buffer_.resize(config_.buffer_size);
+    if (indexed == config_.write_index || descriptor_ < 0) return;
+    if (config_.write_index) index_.Open(path_ + std::string{kLogIndexExtension});
+    else index_.Close();
+}
+
+//----------------------------------------------------------------------
+
+const std::string& FileSink::GetPath() const
+{
+    return path_;
+}
+
+SinkKind FileSink::GetKind() const
+{
+    return SinkKind::kFile;
+}
+
+std::uint64_t FileSink::GetFileSize() const
+{
+    return file_size_ + buffered_;
+}
+
+bool FileSink::IsOpen() const
+{
+    return descriptor_ >= 0;
+}
+
+//----------------------------------------------------------------------
+
+void FileSink::Open(std::int64_t timestamp)
+{
+    descriptor_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    buffered_ = 0;
+    file_size_ = 0;
+    opened_at_ = timestamp;
+    flushed_at_ = timestamp;
+    if (descriptor_ < 0) return;
+    struct stat info{};
+    if (::fstat(descriptor_, &info) == 0) file_size_ = static_cast<std::uint64_t>(info.st_size);
+    if (config_.write_index) index_.Open(path_ + std::string{kLogIndexExtension});
+}
+
+void FileSink::Close()
+{
+    if (descriptor_ < 0) return;
+    Flush();
+    if (has_mark_) FinishMark();
+    index_.Close();
+    ::close(descriptor_);
+    descriptor_ = -1;
+}
+
+void FileSink::WriteOut(std::string_view tail)
+{
+    iovec vectors[2];
+    vectors[0].iov_base = buffer_.data();
+    vectors[0].iov_len = buffered_;
+    vectors[1].iov_base = const_cast<char*>(tail.data());
+    vectors[1].iov_len = tail.size();
+    iovec* current = vectors;
+    int remaining = tail.empty() ? 1 : 2;
+    while (remaining > 0 && descriptor_ >= 0)
+    {
+        ssize_t written = ::writev(descriptor_, current, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+        file_size_ += static_cast<std::uint64_t>(written);
+        std::size_t left = static_cast<std::size_t>(written);
+        while (remaining > 0 && left >= current->iov_len)
+        {
+            left -= current->iov_len;
+            ++current;
+            --remaining;
+        }
+        if (remaining > 0)
+        {
+            current->iov_base = static_cast<char*>(current->iov_base) + left;
+            current->iov_len -= left;
+        }
+    }
+    buffered_ = 0;
+}
+
+bool FileSink::ShouldRotate(std::size_t incoming, std::int64_t timestamp) const
+{
+    if (descriptor_ < 0) return false;
+    if (config_.rotate_size > 0 && GetFileSize() > 0 && GetFileSize() + incoming > config_.rotate_size) return true;
+    std::int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.rotate_interval).count();
+    return interval > 0 && timestamp - opened_at_ >= interval;
+}
+
+// Marks are cut on entry boundaries, a new one starts before an entry that
+// would push the current one past the index interval
+void FileSink::Mark(std::size_t incoming, const LogEntry& entry)
+{
+    std::uint64_t offset = GetFileSize();
+    if (has_mark_ && offset > mark_.offset && offset + incoming - mark_.offset > kIndexInterval) FinishMark();
+    if (!has_mark_)
+    {
+        mark_ = TimeMark{offset, 0, 0, 0, 0, 0};
+        has_mark_ = true;
+    }
+    AddToMark(mark_, entry.timestamp, entry.name, entry.level);
+}
+
+void FileSink::FinishMark()
+{
+    mark_.size = GetFileSize() - mark_.offset;
+    has_mark_ = false;
+    index_.Append(mark_);
+    if (config_.compress_rotated) marks_.push_back(mark_);
+}
+
+//----------------------------------------------------------------------
+
+std::unique_ptr<LogSink> MakeSink(const std::string& path, const SinkConfig& config, RotationHandler rotation_handler)
+{
+    if (config.kind == SinkKind::kMapped) return std::make_unique<MappedFileSink>(path, config, std::move(rotation_handler));
+    return std::make_unique<FileSink>(path, config, std::move(rotation_handler));
+}
+
+std::string NextRotatedPath(const std::string& path)
+{
+    struct stat info{};
+    for (std::size_t index = 1;; ++index)
+    {
+        std::string candidate = path + '.' + std::to_string(index);
+        std::string compressed = candidate + std::string{kCompressedLogExtension};
+        if (::stat(candidate.c_str(), &info) != 0 && ::stat(compressed.c_str(), &info) != 0) return candidate;
+    }
+}
+
+//----------------------------------------------------------------------
+
+SinkTable::SinkTable(const SinkConfig& default_config) :
+    mutex_{},
+    default_config_{default_config},
+    configs_{},
+    sinks_{},
+    binary_log_{nullptr},
+    compressor_once_{},
+    compressor_{nullptr}
+{}
+
+SinkTable::~SinkTable()
+{
+    CloseAll();
+}
+
+//----------------------------------------------------------------------
+
+void SinkTable::Write(const LogEntry* entries, std::size_t count)
+{
+    thread_local std::string text;
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const LogEntry& entry = entries[i];
+        if (entry.format != 0 && binary_log_ != nullptr)
+        {
+            binary_log_->Write(entry);
+            continue;
+        }
+        text.clear();
+        if (entry.format != 0)
+        {
+            const FormatInfo* info = FindFormat(entry.format);
+            std::string message = info != nullptr ? DecodeMessage(info->format, info->signature, entry.message) : std::string{};
+            LogEntry decoded = entry;
+            decoded.message = message;
+            AppendEntryText(text, decoded);
+        }
+        else AppendEntryText(text, entry);
+
+        SinkSlot& slot = GetSlot(entry.destination, lock);
+        if (slot.sink->IsThreadSafe()) slot.sink->Write(text, entry);
+        else
+        {
+            std::lock_guard<std::mutex> sink_lock{slot.mutex};
+            slot.sink->Write(text, entry);
+        }
+    }
+}
+
+void SinkTable::Flush()
+{
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+    for (auto& [destination, slot] : sinks_)
+    {
+        std::lock_guard<std::mutex> sink_lock{slot->mutex};
+        slot->sink->Flush();
+    }
+    if (binary_log_ != nullptr) binary_log_->Flush();
+}
+
+void SinkTable::SetDefaultConfig(const SinkConfig& config)
+{
+    std::unique_lock<std::shared_mutex> lock{mutex_};
+    default_config_ = config;
+    for (auto& [destination, slot] : sinks_)
+    {
+        if (configs_.find(destination) != configs_.end()) continue;
+        if (slot->sink->GetKind() == config.kind) slot->sink->SetConfig(config);
+        else slot->sink = MakeSink(destination, config, MakeRotationHandler());
+    }
+}
+
+void SinkTable::Configure(const std::string& destination, const SinkConfig& config)
+{
+    std::unique_lock<std::shared_mutex> lock{mutex_};
+    configs_[destination] = config;
+    auto iterator = sinks_.find(destination);
+    if (iterator == sinks_.end()) return;
+    SinkSlot& slot = *iterator->second;
+    if (slot.sink->GetKind() == config.kind) slot.sink->SetConfig(config);
+    else
+    {
+        slot.sink.reset();
+        slot.sink = MakeSink(destination, config, MakeRotationHandler());
+    }
+}
+
+void SinkTable::CloseAll()
+{
+    std::unique_lock<std::shared_mutex> lock{mutex_};
+    sinks_.clear();
+    binary_log_.reset();
+}
+
+void SinkTable::OpenBinaryLog(const std::string& path)
+{
+    std::unique_ptr<BinaryLogWriter> binary_log = std::make_unique<BinaryLogWriter>(path);
+    std::unique_lock<std::shared_mutex> lock{mutex_};
+    binary_log_ = std::move(binary_log);
+}
+
+void SinkTable::CloseBinaryLog()
+{
+    std::unique_lock<std::shared_mutex> lock{mutex_};
+    binary_log_.reset();
+}
+
+void SinkTable::DefineLogger(LoggerID id, std::string_view name)
+{
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+    if (binary_log_ != nullptr) binary_log_->DefineLogger(id, name);
+}
+
+//----------------------------------------------------------------------
+
+std::size_t SinkTable::SinkCount() const
+{
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+    return sinks_.size();
+}
+
+bool SinkTable::HasBinaryLog() const
+{
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+    return binary_log_ != nullptr;
+}
+
+//----------------------------------------------------------------------
+
+// Missing sinks are created under the exclusive lock, the shared lock is
+// held again on return.
+SinkTable::SinkSlot& SinkTable::GetSlot(std::string_view destination, std::shared_lock<std::shared_mutex>& lock)
+{
+    for (;;)
+    {
+        auto iterator = sinks_.find(destination);
+        if (iterator != sinks_.end()) return *iterator->second;
+
+        lock.unlock();
+        {
+            std::unique_lock<std::shared_mutex> exclusive{mutex_};
+            if (sinks_.find(destination) == sinks_.end())
+            {
+                std::string key{destination};
+                auto config = configs_.find(key);
+                const SinkConfig& sink_config = config != configs_.end() ? config->second : default_config_;
+                std::unique_ptr<SinkSlot> slot = std::make_unique<SinkSlot>();
+                slot->sink = MakeSink(key, sink_config, MakeRotationHandler());
+                sinks_.emplace(std::move(key), std::move(slot));
+            }
+        }
+        lock.lock();
+    }
+}
+
+RotationHandler SinkTable::MakeRotationHandler()
+{
+    return [this](const std::string& path, std::vector<TimeMark> marks)
+    {
+        std::call_once(compressor_once_, [this] { compressor_ = std::make_unique<SegmentCompressor>(); });
+        compressor_->Enqueue(path, std::move(marks));
+    };
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logging/flight_recorder.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr std::size_t kHeaderWords = offsetof(FlightRecord, message) / sizeof(std::uint64_t);
+static_assert(offsetof(FlightRecord, message) % sizeof(std::uint64_t) == 0, "flight record message must start on a word");
+
+constexpr int kFatalSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+alignas(16) char alternate_stack[64 * 1024];
+std::atomic<bool> handling_fault{false};
+
+std::size_t UsedWords(std::size_t message_size)
+{
+    return kHeaderWords + (message_size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+}
+
+// Async-signal-safe helpers, no allocation and no locale
+void WriteAll(int descriptor, const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(descriptor, data, size);
+        if (written <= 0) return;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+char* AppendText(char* out, char* end, std::string_view text)
+{
+    std::size_t size = std::min(text.size(), static_cast<std::size_t>(end - out));
+    std::memcpy(out, text.data(), size);
+    return out + size;
+}
+
+char* AppendNumber(char* out, char* end, std::uint64_t value, int min_digits)
+{
+    char digits[20];
+    int count = 0;
+    do
+    {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0 && count < 20);
+    while (count < min_digits && count < 20) digits[count++] = '0';
+    while (count > 0 && out < end) *out++ = digits[--count];
+    return out;
+}
+
+void HandleFatalSignal(int signal)
+{
+    if (!handling_fault.exchange(true))
+    {
+        char reason[32];
+        char* end = reason + sizeof(reason);
+        char* out = AppendText(reason, end, "Fatal signal ");
+        out = AppendNumber(out, end, static_cast<std::uint64_t>(signal), 1);
+        out = AppendText(out, end, "\n");
+        FlightRecorder::StaticInstance()->DumpCrashLog(std::string_view{reason, static_cast<std::size_t>(out - reason)});
+    }
+    ::raise(signal);
+}
+
+}
+
+//----------------------------------------------------------------------
+
+FlightRecorder::FlightRecorder() :
+    head_{0},
+    cleared_{0},
+    enabled_{true},
+    crash_descriptor_{-1},
+    slots_{}
+{}
+
+//----------------------------------------------------------------------
+
+void FlightRecorder::Record(std::int64_t timestamp, LoggerID logger, LogLevel level, std::string_view name, std::string_view message) noexcept
+{
+    if (!enabled_.load(std::memory_order_relaxed)) return;
+    std::uint64_t ticket = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[ticket & (kCapacity - 1)];
+
+    // A slower writer that got lapped gives up instead of tearing a newer record
+    std::uint64_t observed = slot.sequence.load(std::memory_order_relaxed);
+    if ((observed & 1) != 0 || observed > ticket * 2) return;
+    if (!slot.sequence.compare_exchange_strong(observed, ticket * 2 + 1, std::memory_order_acquire, std::memory_order_relaxed)) return;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    FlightRecord record;
+    record.timestamp = timestamp;
+    record.logger = logger;
+    record.level = static_cast<std::int32_t>(level);
+    record.name_size = static_cast<std::uint16_t>(std::min(name.size(), FlightRecord::kNameCapacity));
+    record.message_size = static_cast<std::uint16_t>(std::min(message.size(), FlightRecord::kMessageCapacity));
+    std::memset(record.name, 0, sizeof(record.name));
+    std::memcpy(record.name, name.data(), record.name_size);
+    std::memcpy(record.message, message.data(), record.message_size);
+    std::memset(record.message + record.message_size, 0, UsedWords(record.message_size) * sizeof(std::uint64_t) - offsetof(FlightRecord, message) - record.message_size);
+
+    std::uint64_t words[kWords];
+    std::size_t used = UsedWords(record.message_size);
+    std::memcpy(words, &record, used * sizeof(std::uint64_t));
+    for (std::size_t i = 0; i < used; ++i)
+    {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(ticket * 2 + 2, std::memory_order_release);
+}
+
+void FlightRecorder::Clear() noexcept
+{
+    cleared_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+bool FlightRecorder::InstallCrashHandlers(const char* path)
+{
+    int descriptor = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (descriptor < 0) return false;
+    int previous = crash_descriptor_.exchange(descriptor);
+    if (previous >= 0) ::close(previous);
+
+    stack_t stack{};
+    stack.ss_sp = alternate_stack;
+    stack.ss_size = sizeof(alternate_stack);
+    ::sigaltstack(&stack, nullptr);
+
+    struct sigaction action{};
+    action.sa_handler = &HandleFatalSignal;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int signal : kFatalSignals)
+    {
+        if (::sigaction(signal, &action, nullptr) != 0) return false;
+    }
+    return true;
+}
+
+void FlightRecorder::SetEnabled(bool enabled) noexcept
+{
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+std::size_t FlightRecorder::Snapshot(FlightRecord* records, std::size_t capacity) const noexcept
+{
+    std::uint64_t head = head_.load(std::memory_order_acquire);
+    std::uint64_t begin = std::max(cleared_.load(std::memory_order_acquire), head - std::min<std::uint64_t>(head, kCapacity));
+    std::size_t count = 0;
+    for (std::uint64_t ticket = begin; ticket < head && count < capacity; ++ticket)
+    {
+        if (Read(ticket, records[count])) ++count;
+    }
+    return count;
+}
+
+std::uint64_t FlightRecorder::Head() const noexcept
+{
+    return head_.load(std::memory_order_acquire);
+}
+
+void FlightRecorder::Dump(int descriptor) const noexcept
+{
+    WriteAll(descriptor, "---- flight recorder ----\n", 26);
+    std::uint64_t head = head_.load(std::memory_order_acquire);
+    std::uint64_t begin = std::max(cleared_.load(std::memory_order_acquire), head - std::min<std::uint64_t>(head, kCapacity));
+    FlightRecord record;
+    char line[FlightRecord::kNameCapacity + FlightRecord::kMessageCapacity + 64];
+    char* end = line + sizeof(line);
+    for (std::uint64_t ticket = begin; ticket < head; ++ticket)
+    {
+        if (!Read(ticket, record)) continue;
+        std::uint64_t timestamp = static_cast<std::uint64_t>(record.timestamp);
+        char* out = AppendText(line, end, "[");
+        out = AppendNumber(out, end, timestamp / 1000000000, 1);
+        out = AppendText(out, end, ".");
+        out = AppendNumber(out, end, timestamp % 1000000000, 9);
+        out = AppendText(out, end, "] ");
+        out = AppendText(out, end, GetLevelName(static_cast<LogLevel>(record.level)));
+        out = AppendText(out, end, " ");
+        out = AppendText(out, end, std::string_view{record.name, record.name_size});
+        out = AppendText(out, end, ": ");
+        out = AppendText(out, end, std::string_view{record.message, record.message_size});
+        out = AppendText(out, end, "\n");
+        WriteAll(descriptor, line, static_cast<std::size_t>(out - line));
+    }
+}
+
+void FlightRecorder::DumpCrashLog(std::string_view reason) const noexcept
+{
+    int descriptor = crash_descriptor_.load();
+    if (descriptor < 0) descriptor = STDERR_FILENO;
+    WriteAll(descriptor, reason.data(), reason.size());
+    Dump(descriptor);
+}
+
+bool FlightRecorder::IsEnabled() const noexcept
+{
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+bool FlightRecorder::Read(std::uint64_t ticket, FlightRecord& record) const noexcept
+{
+    const Slot& slot = slots_[ticket & (kCapacity - 1)];
+    std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != ticket * 2 + 2) return false;
+    std::uint64_t words[kWords];
+    for (std::size_t i = 0; i < kHeaderWords; ++i)
+    {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::memcpy(&record, words, kHeaderWords * sizeof(std::uint64_t));
+    std::size_t used = UsedWords(std::min<std::size_t>(record.message_size, FlightRecord::kMessageCapacity));
+    for (std::size_t i = kHeaderWords; i < used; ++i)
+    {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) return false;
+    std::memcpy(&record, words, used * sizeof(std::uint64_t));
+    return true;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging/log_index.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr std::size_t kMarkSize = 48;
+
+void Encode(const TimeMark& mark, char* out)
+{
+    std::memset(out, 0, kMarkSize);
+    std::memcpy(out, &mark.offset, 8);
+    std::memcpy(out + 8, &mark.size, 8);
+    std::memcpy(out + 16, &mark.first_timestamp, 8);
+    std::memcpy(out + 24, &mark.last_timestamp, 8);
+    std::memcpy(out + 32, &mark.logger_mask, 8);
+    std::memcpy(out + 40, &mark.level_mask, 4);
+}
+
+TimeMark Decode(const char* in)
+{
+    TimeMark mark{};
+    std::memcpy(&mark.offset, in, 8);
+    std::memcpy(&mark.size, in + 8, 8);
+    std::memcpy(&mark.first_timestamp, in + 16, 8);
+    std::memcpy(&mark.last_timestamp, in + 24, 8);
+    std::memcpy(&mark.logger_mask, in + 32, 8);
+    std::memcpy(&mark.level_mask, in + 40, 4);
+    return mark;
+}
+
+bool WriteAll(int descriptor, const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(descriptor, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+}
+
+//----------------------------------------------------------------------
+
+std::uint64_t LoggerMaskBit(std::string_view name)
+{
+    // FNV-1a, has to stay stable between the writer and the query tool
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char character : name)
+    {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 1099511628211ull;
+    }
+    return std::uint64_t{1} << (hash % 64);
+}
+
+std::uint32_t LevelMaskBit(LogLevel level)
+{
+    return std::uint32_t{1} << static_cast<unsigned>(level);
+}
+
+TimeMark UnknownMark(std::uint64_t offset, std::uint64_t size)
+{
+    return TimeMark{offset, size, std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max(),
+                    ~std::uint64_t{0}, ~std::uint32_t{0}};
+}
+
+void AddToMark(TimeMark& mark, std::int64_t timestamp, std::string_view logger, LogLevel level)
+{
+    if (mark.logger_mask == 0 && mark.level_mask == 0)
+    {
+        mark.first_timestamp = timestamp;
+        mark.last_timestamp = timestamp;
+    }
+    else
+    {
+        mark.first_timestamp = std::min(mark.first_timestamp, timestamp);
+        mark.last_timestamp = std::max(mark.last_timestamp, timestamp);
+    }
+    mark.logger_mask |= LoggerMaskBit(logger);
+    mark.level_mask |= LevelMaskBit(level);
+}
+
+//----------------------------------------------------------------------
+
+LogIndexWriter::LogIndexWriter() :
+    descriptor_{-1}
+{}
+
+LogIndexWriter::~LogIndexWriter()
+{
+    Close();
+}
+
+//----------------------------------------------------------------------
+
+bool LogIndexWriter::Open(const std::string& path)
+{
+    Close();
+    descriptor_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (descriptor_ < 0) return false;
+    struct stat info{};
+    if (::fstat(descriptor_, &info) == 0 && info.st_size == 0) WriteAll(descriptor_, kLogIndexMagic, sizeof(kLogIndexMagic));
+    return true;
+}
+
+void LogIndexWriter::Append(const TimeMark& mark)
+{
+    if (descriptor_ < 0) return;
+    char record[kMarkSize];
+    Encode(mark, record);
+    WriteAll(descriptor_, record, sizeof(record));
+}
+
+void LogIndexWriter::Close()
+{
+    if (descriptor_ < 0) return;
+    ::close(descriptor_);
+    descriptor_ = -1;
+}
+
+//----------------------------------------------------------------------
+
+bool LogIndexWriter::IsOpen() const
+{
+    return descriptor_ >= 0;
+}
+
+//----------------------------------------------------------------------
+
+std::vector<TimeMark> ReadLogIndex(const std::string& path)
+{
+    std::vector<TimeMark> marks;
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) return marks;
+    struct stat info{};
+    std::vector<char> data;
+    if (::fstat(descriptor, &info) == 0) data.resize(static_cast<std::size_t>(info.st_size));
+    std::size_t size = 0;
+    while (size < data.size())
+    {
+        ssize_t result = ::read(descriptor, data.data() + size, data.size() - size);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) break;
+        size += static_cast<std::size_t>(result);
+    }
+    ::close(descriptor);
+    if (size < sizeof(kLogIndexMagic) || std::memcmp(data.data(), kLogIndexMagic, sizeof(kLogIndexMagic)) != 0) return marks;
+    // A torn last record is ignored
+    for (std::size_t offset = sizeof(kLogIndexMagic); offset + kMarkSize <= size; offset += kMarkSize)
+    {
+        marks.push_back(Decode(data.data() + offset));
+    }
+    return marks;
+}
+
+bool WriteLogIndex(const std::string& path, const std::vector<TimeMark>& marks)
+{
+    std::vector<char> data(sizeof(kLogIndexMagic) + marks.size() * kMarkSize);
+    std::memcpy(data.data(), kLogIndexMagic, sizeof(kLogIndexMagic));
+    for (std::size_t i = 0; i < marks.size(); ++i) Encode(marks[i], data.data() + sizeof(kLogIndexMagic) + i * kMarkSize);
+    int descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (descriptor < 0) return false;
+    bool ok = WriteAll(descriptor, data.data(), data.size());
+    return ::close(descriptor) == 0 && ok;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
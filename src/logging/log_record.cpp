@@ -0,0 +1,65 @@
+#include <cstring>
+#include <algorithm>
+
+#include "logging/log_record.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+void LogRecord::Assign(const LogEntry& entry)
+{
+    timestamp = entry.timestamp;
+    logger = entry.logger;
+    level = entry.level;
+    format = entry.format;
+    std::size_t available = kPayloadCapacity;
+    name_size = static_cast<std::uint16_t>(std::min(entry.name.size(), available));
+    available -= name_size;
+    destination_size = static_cast<std::uint16_t>(std::min(entry.destination.size(), available));
+    available -= destination_size;
+    message_size = static_cast<std::uint16_t>(std::min(entry.message.size(), available));
+    truncated = entry.truncated || message_size < entry.message.size();
+    std::memcpy(payload, entry.name.data(), name_size);
+    std::memcpy(payload + name_size, entry.destination.data(), destination_size);
+    std::memcpy(payload + name_size + destination_size, entry.message.data(), message_size);
+}
+
+LogEntry LogRecord::View() const
+{
+    LogEntry entry;
+    entry.timestamp = timestamp;
+    entry.logger = logger;
+    entry.level = level;
+    entry.name = std::string_view{payload, name_size};
+    entry.destination = std::string_view{payload + name_size, destination_size};
+    entry.message = std::string_view{payload + name_size + destination_size, message_size};
+    entry.truncated = truncated;
+    entry.format = format;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+
+void AppendEntryText(std::string& out, const LogEntry& entry)
+{
+    out += "--------------------------------------------\n";
+    out += "Time:         "; GetTimestampCache().AppendTo(out, entry.timestamp); out += '\n';
+    out += "Level:        "; out += GetLevelName(entry.level); out += '\n';
+    out += "Name:         "; out += entry.name; out += '\n';
+    out += "Destination:  "; out += entry.destination; out += '\n';
+    out += '\n';
+    out += entry.message;
+    if(entry.truncated) out += " [truncated]";
+    out += '\n';
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
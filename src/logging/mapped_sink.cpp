@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging/epoch.h"
+#include "logging/mapped_sink.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+MappedFileSink::MappedFileSink(const std::string& path, const SinkConfig& config, RotationHandler rotation_handler) :
+    path_{path},
+    segment_size_{config.segment_size},
+    compress_rotated_{config.compress_rotated},
+    write_index_{config.write_index},
+    rotation_handler_{std::move(rotation_handler)},
+    mutex_{},
+    current_{nullptr},
+    segments_{},
+    segment_count_{0}
+{
+    // A leftover file may end in unused preallocated space, keep it aside
+    struct stat info{};
+    if (::stat(path_.c_str(), &info) == 0 && info.st_size > 0)
+    {
+        std::string rotated = NextRotatedPath(path_);
+        std::string index = rotated + std::string{kLogIndexExtension};
+        if (::rename(path_.c_str(), rotated.c_str()) == 0)
+        {
+            ::rename((path_ + std::string{kLogIndexExtension}).c_str(), index.c_str());
+            if (config.compress_rotated && rotation_handler_) rotation_handler_(rotated, ReadLogIndex(index));
+        }
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    Segment* segment = OpenSegment({});
+    if (segment->data == nullptr) throw std::runtime_error{"failed to map log segment"};
+    current_.store(segment, std::memory_order_release);
+}
+
+MappedFileSink::~MappedFileSink()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    Segment* segment = current_.load(std::memory_order_acquire);
+    std::uint64_t used = segment->committed.load(std::memory_order_acquire);
+    CloseSegment(*segment, used);
+    if (segment->data != nullptr && write_index_.load(std::memory_order_relaxed))
+    {
+        WriteLogIndex(path_ + std::string{kLogIndexExtension}, CollectMarks(*segment, used));
+    }
+}
+
+//----------------------------------------------------------------------
+
+void MappedFileSink::Write(std::string_view text, const LogEntry& entry)
+{
+    EpochGuard guard;
+    for (;;)
+    {
+        Segment* segment = current_.load(std::memory_order_acquire);
+        if (segment->data == nullptr) return;
+        if (text.size() > segment->size) text = text.substr(0, segment->size);
+        std::uint64_t begin = segment->reserved.fetch_add(text.size(), std::memory_order_relaxed);
+        std::uint64_t end = begin + text.size();
+        if (end <= segment->size)
+        {
+            std::memcpy(segment->data + begin, text.data(), text.size());
+            if (write_index_.load(std::memory_order_relaxed) || compress_rotated_.load(std::memory_order_relaxed))
+            {
+                Stamp(*segment, begin, entry);
+            }
+            segment->committed.fetch_add(text.size(), std::memory_order_release);
+            return;
+        }
+        // Reservations are contiguous, so exactly one writer crosses the end
+        if (begin <= segment->size) Rollover(segment, begin);
+        else
+        {
+            while (current_.load(std::memory_order_acquire) == segment) std::this_thread::yield();
+        }
+    }
+}
+
+void MappedFileSink::Flush()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    Segment* segment = current_.load(std::memory_order_acquire);
+    if (segment->data != nullptr) ::msync(segment->mapping, segment->mapping_size, MS_ASYNC);
+}
+
+void MappedFileSink::SetConfig(const SinkConfig& config)
+{
+    segment_size_.store(config.segment_size, std::memory_order_relaxed);
+    compress_rotated_.store(config.compress_rotated, std::memory_order_relaxed);
+    write_index_.store(config.write_index, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+const std::string& MappedFileSink::GetPath() const
+{
+    return path_;
+}
+
+SinkKind MappedFileSink::GetKind() const
+{
+    return SinkKind::kMapped;
+}
+
+bool MappedFileSink::IsThreadSafe() const
+{
+    return true;
+}
+
+std::size_t MappedFileSink::SegmentCount() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return segment_count_;
+}
+
+//----------------------------------------------------------------------
+
+// Opens the file without truncating it, a file the last segment could not
+// be renamed away from is continued after its contents
+MappedFileSink::Segment* MappedFileSink::OpenSegment(std::vector<TimeMark> marks)
+{
+    segments_.push_back(std::make_unique<Segment>());
+    ++segment_count_;
+    Segment& segment = *segments_.back();
+    std::uint64_t size = segment_size_.load(std::memory_order_relaxed);
+    int descriptor = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (descriptor < 0) return &segment;
+    struct stat info{};
+    if (::fstat(descriptor, &info) != 0)
+    {
+        ::close(descriptor);
+        return &segment;
+    }
+    std::uint64_t base = static_cast<std::uint64_t>(info.st_size);
+    std::uint64_t page = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    std::uint64_t offset = base % page;
+    int result = ::fallocate(descriptor, 0, static_cast<off_t>(base), static_cast<off_t>(size));
+    if (result != 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) result = ::ftruncate(descriptor, static_cast<off_t>(base + size));
+    void* data = result == 0 ? ::mmap(nullptr, offset + size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, static_cast<off_t>(base - offset)) : MAP_FAILED;
+    if (data == MAP_FAILED)
+    {
+        if (result == 0) result = ::ftruncate(descriptor, static_cast<off_t>(base));
+        (void)result;
+        ::close(descriptor);
+        return &segment;
+    }
+    std::uint64_t covered = marks.empty() ? 0 : marks.back().offset + marks.back().size;
+    if (covered < base) marks.push_back(UnknownMark(covered, base - covered));
+    segment.descriptor = descriptor;
+    segment.mapping = static_cast<char*>(data);
+    segment.mapping_size = offset + size;
+    segment.data = segment.mapping + offset;
+    segment.base = base;
+    segment.size = size;
+    segment.regions = std::make_unique<Region[]>(size / kIndexInterval + 1);
+    segment.marks = std::move(marks);
+    return &segment;
+}
+
+void MappedFileSink::CloseSegment(Segment& segment, std::uint64_t used)
+{
+    if (segment.data == nullptr) return;
+    ::munmap(segment.mapping, segment.mapping_size);
+    int result = ::ftruncate(segment.descriptor, static_cast<off_t>(segment.base + used));
+    (void)result;
+    ::close(segment.descriptor);
+}
+
+// Late writers may still hold the retired segment, it is freed once every
+// guard that could have loaded it has been left
+void MappedFileSink::Rollover(Segment* segment, std::uint64_t used)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    while (segment->committed.load(std::memory_order_acquire) < used) std::this_thread::yield();
+    bool indexed = write_index_.load(std::memory_order_relaxed);
+    bool compressed = compress_rotated_.load(std::memory_order_relaxed) && rotation_handler_;
+    std::vector<TimeMark> marks;
+    if (indexed || compressed) marks = CollectMarks(*segment, used);
+    CloseSegment(*segment, used);
+    std::string rotated = NextRotatedPath(path_);
+    bool renamed = ::rename(path_.c_str(), rotated.c_str()) == 0;
+    current_.store(OpenSegment(renamed ? std::vector<TimeMark>{} : marks), std::memory_order_release);
+    segment->regions.reset();
+    segment->marks = {};
+    segment->retired_epoch = AdvanceEpoch();
+    Reclaim();
+    if (!renamed) return;
+    if (indexed) WriteLogIndex(rotated + std::string{kLogIndexExtension}, marks);
+    if (compressed) rotation_handler_(rotated, std::move(marks));
+}
+
+// Callers hold mutex_
+void MappedFileSink::Reclaim()
+{
+    std::uint64_t oldest = OldestActiveEpoch();
+    auto end = std::find_if(segments_.begin(), segments_.end() - 1, [oldest](const std::unique_ptr<Segment>& segment)
+    {
+        return segment->retired_epoch >= oldest;
+    });
+    segments_.erase(segments_.begin(), end);
+}
+
+// Writers finish out of order, so entries are summarized by the slice they
+// start in rather than cut into marks on the fly
+void MappedFileSink::Stamp(Segment& segment, std::uint64_t offset, const LogEntry& entry)
+{
+    Region& region = segment.regions[offset / kIndexInterval];
+    std::int64_t first = region.first_timestamp.load(std::memory_order_relaxed);
+    while (entry.timestamp < first && !region.first_timestamp.compare_exchange_weak(first, entry.timestamp, std::memory_order_relaxed)) {}
+    std::int64_t last = region.last_timestamp.load(std::memory_order_relaxed);
+    while (entry.timestamp > last && !region.last_timestamp.compare_exchange_weak(last, entry.timestamp, std::memory_order_relaxed)) {}
+    region.logger_mask.fetch_or(LoggerMaskBit(entry.name), std::memory_order_relaxed);
+    region.level_mask.fetch_or(LevelMaskBit(entry.level), std::memory_order_relaxed);
+}
+
+// Slices without an entry start hold the tail of a long entry and are
+// folded into the previous mark
+std::vector<TimeMark> MappedFileSink::CollectMarks(const Segment& segment, std::uint64_t used) const
+{
+    std::vector<TimeMark> marks = segment.marks;
+    std::size_t first = marks.size();
+    for (std::uint64_t offset = 0; offset < used; offset += kIndexInterval)
+    {
+        const Region& region = segment.regions[offset / kIndexInterval];
+        std::uint64_t size = std::min<std::uint64_t>(kIndexInterval, used - offset);
+        std::uint32_t level_mask = region.level_mask.load(std::memory_order_relaxed);
+        if (level_mask == 0 && marks.size() > first) marks.back().size += size;
+        else if (level_mask == 0) marks.push_back(UnknownMark(segment.base + offset, size));
+        else
+        {
+            marks.push_back(TimeMark{segment.base + offset, size,
+                region.first_timestamp.load(std::memory_order_relaxed),
+                region.last_timestamp.load(std::memory_order_relaxed),
+                region.logger_mask.load(std::memory_order_relaxed),
+                level_mask});
+        }
+    }
+    return marks;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
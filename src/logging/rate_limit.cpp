@@ -0,0 +1,121 @@
+#include <string_view>
+
+#include "logging/rate_limit.h"
+#include "logging/timestamp.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+std::atomic<LogLimiter*> limiters{nullptr};
+
+}
+
+//----------------------------------------------------------------------
+
+bool LogLimiter::Allow() noexcept
+{
+    if (!linked_.load(std::memory_order_relaxed)) Link();
+    bool allowed = false;
+    switch (policy_)
+    {
+        case LimitPolicy::kPerSecond:
+            allowed = AllowPerSecond();
+            break;
+        case LimitPolicy::kEveryN:
+            allowed = state_.fetch_add(1, std::memory_order_relaxed) % limit_ == 0;
+            break;
+        case LimitPolicy::kFirstN:
+            // Stop counting once past the limit so the counter cannot wrap
+            allowed = state_.load(std::memory_order_relaxed) < limit_ && state_.fetch_add(1, std::memory_order_relaxed) < limit_;
+            break;
+    }
+    if (!allowed) suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return allowed;
+}
+
+std::uint64_t LogLimiter::TakeSuppressed() noexcept
+{
+    return suppressed_.exchange(0, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+LimitPolicy LogLimiter::GetPolicy() const noexcept
+{
+    return policy_;
+}
+
+const char* LogLimiter::GetFile() const noexcept
+{
+    return file_;
+}
+
+int LogLimiter::GetLine() const noexcept
+{
+    return line_;
+}
+
+LogLimiter* LogLimiter::GetNext() const noexcept
+{
+    return next_;
+}
+
+//----------------------------------------------------------------------
+
+bool LogLimiter::AllowPerSecond() noexcept
+{
+    std::uint64_t second = static_cast<std::uint64_t>(CurrentTimestamp() / 1000000000) & 0xffffffff;
+    std::uint64_t state = state_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        std::uint64_t count = (state >> 32) == second ? state & 0xffffffff : 0;
+        if (count >= limit_) return false;
+        if (state_.compare_exchange_weak(state, (second << 32) | (count + 1), std::memory_order_relaxed)) return true;
+    }
+}
+
+void LogLimiter::Link() noexcept
+{
+    if (linked_.exchange(true, std::memory_order_relaxed)) return;
+    LogLimiter* head = limiters.load(std::memory_order_relaxed);
+    do
+    {
+        next_ = head;
+    } while (!limiters.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//----------------------------------------------------------------------
+
+std::string TakeSuppressedSummary()
+{
+    std::string summary;
+    for (LogLimiter* limiter = limiters.load(std::memory_order_acquire); limiter != nullptr; limiter = limiter->GetNext())
+    {
+        std::uint64_t suppressed = limiter->TakeSuppressed();
+        if (suppressed == 0) continue;
+        std::string_view file{limiter->GetFile()};
+        std::size_t slash = file.find_last_of("/\\");
+        if (slash != std::string_view::npos) file.remove_prefix(slash + 1);
+        summary += summary.empty() ? "Suppressed messages: " : ", ";
+        summary += file;
+        summary += ':';
+        summary += std::to_string(limiter->GetLine());
+        summary += " x";
+        summary += std::to_string(suppressed);
+    }
+    return summary;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
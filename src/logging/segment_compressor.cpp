@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "logging/segment_compressor.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+SegmentCompressor::SegmentCompressor() :
+    mutex_{},
+    wake_condition_{},
+    drain_condition_{},
+    jobs_{},
+    busy_{false},
+    stop_requested_{false},
+    compressed_{0},
+    failed_{0},
+    thread_{&SegmentCompressor::Run, this}
+{}
+
+SegmentCompressor::~SegmentCompressor()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_requested_ = true;
+    }
+    wake_condition_.notify_one();
+    thread_.join();
+}
+
+//----------------------------------------------------------------------
+
+void SegmentCompressor::Enqueue(const std::string& path, std::vector<TimeMark> marks)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        jobs_.push_back(Job{path, std::move(marks)});
+    }
+    wake_condition_.notify_one();
+}
+
+void SegmentCompressor::Drain()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+    drain_condition_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+//----------------------------------------------------------------------
+
+std::uint64_t SegmentCompressor::CompressedCount() const
+{
+    return compressed_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t SegmentCompressor::FailedCount() const
+{
+    return failed_.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+void SegmentCompressor::Run()
+{
+    // Only use otherwise idle CPU time, fall back to the lowest nice value
+    sched_param parameters{};
+    if (::pthread_setschedparam(::pthread_self(), SCHED_IDLE, &parameters) != 0)
+    {
+        int result = ::setpriority(PRIO_PROCESS, static_cast<id_t>(::gettid()), 19);
+        (void)result;
+    }
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    for (;;)
+    {
+        wake_condition_.wait(lock, [this] { return stop_requested_ || !jobs_.empty(); });
+        if (jobs_.empty()) break;
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        std::string output = job.path + std::string{kCompressedLogExtension};
+        if (CompressLogFile(job.path, job.marks, output))
+        {
+            ::unlink(job.path.c_str());
+            // The compressed file carries its own index
+            ::unlink((job.path + std::string{kLogIndexExtension}).c_str());
+            compressed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else failed_.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+        busy_ = false;
+        if (jobs_.empty()) drain_condition_.notify_all();
+    }
+    drain_condition_.notify_all();
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "logging/subscriber.h"
+#include "logging/binary_log.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+SubscriberTable::SubscriberTable() :
+    mutex_{},
+    subscriptions_{},
+    next_id_{1},
+    entries_{},
+    selected_{},
+    decoded_{}
+{}
+
+SubscriberTable::~SubscriberTable()
+{}
+
+//----------------------------------------------------------------------
+
+void SubscriberTable::Write(const LogEntry* entries, std::size_t count)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (subscriptions_.empty()) return;
+
+    // Binary entries carry encoded arguments, subscribers get the text
+    entries_.assign(entries, entries + count);
+    decoded_.clear();
+    for (LogEntry& entry : entries_)
+    {
+        if (entry.format == 0) continue;
+        const FormatInfo* info = FindFormat(entry.format);
+        decoded_.push_back(info != nullptr ? DecodeMessage(info->format, info->signature, entry.message) : std::string{});
+        entry.message = decoded_.back();
+        entry.format = 0;
+    }
+
+    for (const Subscription& subscription : subscriptions_)
+    {
+        selected_.clear();
+        for (const LogEntry& entry : entries_)
+        {
+            if (entry.logger == subscription.logger) selected_.push_back(entry);
+        }
+        if (!selected_.empty()) subscription.callback(selected_.data(), selected_.size());
+    }
+}
+
+void SubscriberTable::Flush()
+{}
+
+SubscriptionID SubscriberTable::Add(LoggerID logger, LogSubscriber subscriber)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    SubscriptionID id = next_id_++;
+    subscriptions_.push_back(Subscription{id, logger, std::move(subscriber)});
+    return id;
+}
+
+bool SubscriberTable::Remove(SubscriptionID id, LoggerID& logger)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto iterator = std::find_if(subscriptions_.begin(), subscriptions_.end(), [id](const Subscription& subscription) { return subscription.id == id; });
+    if (iterator == subscriptions_.end()) return false;
+    logger = iterator->logger;
+    subscriptions_.erase(iterator);
+    return true;
+}
+
+void SubscriberTable::RemoveLogger(LoggerID logger)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    std::erase_if(subscriptions_, [logger](const Subscription& subscription) { return subscription.logger == logger; });
+}
+
+void SubscriberTable::Clear()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    subscriptions_.clear();
+}
+
+//----------------------------------------------------------------------
+
+std::size_t SubscriberTable::Count() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return subscriptions_.size();
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
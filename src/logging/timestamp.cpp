@@ -0,0 +1,158 @@
+#include <ctime>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include "logging/timestamp.h"
+#include "format.h"
+
+namespace ruthen
+{
+
+namespace logging
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr std::int64_t kAnchorInterval = 1000000000;
+constexpr std::int64_t kMaxBackwardStep = 1000000;
+
+// Wall clock minus monotonic clock, and when to sample it again
+struct ClockAnchor
+{
+    std::atomic<std::int64_t> offset;
+    std::atomic<std::int64_t> next;
+};
+
+std::int64_t WallNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t SteadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ClockAnchor& GetClockAnchor()
+{
+    static ClockAnchor anchor{WallNanoseconds() - SteadyNanoseconds(), SteadyNanoseconds() + kAnchorInterval};
+    return anchor;
+}
+
+}
+
+//----------------------------------------------------------------------
+
+TimestampCache::TimestampCache(std::string_view layout) :
+    layout_{layout},
+    sequence_{0},
+    second_{-1},
+    size_{0},
+    words_{}
+{}
+
+//----------------------------------------------------------------------
+
+TimestampText TimestampCache::Get(std::int64_t timestamp)
+{
+    std::int64_t second = timestamp / 1000000000;
+    if (timestamp < 0 && timestamp % 1000000000 != 0) --second;
+    TimestampText result;
+    if (TryLoad(second, result)) return result;
+    Render(second, result);
+    Store(second, result);
+    return result;
+}
+
+void TimestampCache::AppendTo(std::string& out, std::int64_t timestamp)
+{
+    out += Get(timestamp).View();
+}
+
+//----------------------------------------------------------------------
+
+std::string_view TimestampCache::GetLayout() const
+{
+    return layout_;
+}
+
+//----------------------------------------------------------------------
+
+bool TimestampCache::TryLoad(std::int64_t second, TimestampText& result) const
+{
+    std::uint64_t sequence = sequence_.load(std::memory_order_acquire);
+    if ((sequence & 1) != 0 || second_.load(std::memory_order_relaxed) != second) return false;
+    std::uint64_t words[kWords];
+    for (std::size_t i = 0; i < kWords; ++i)
+    {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    std::uint64_t size = size_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != sequence) return false;
+    std::memcpy(result.text, words, sizeof(words));
+    result.size = static_cast<std::uint8_t>(size);
+    return true;
+}
+
+void TimestampCache::Render(std::int64_t second, TimestampText& result) const
+{
+    std::time_t time = static_cast<std::time_t>(second);
+    std::tm tm{};
+    localtime_r(&time, &tm);
+    std::string text = Format(RuntimeFormat<'%'>{layout_}, tm.tm_sec, tm.tm_min, tm.tm_hour, tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
+    result.size = static_cast<std::uint8_t>(std::min(text.size(), TimestampText::kCapacity));
+    std::memcpy(result.text, text.data(), result.size);
+}
+
+void TimestampCache::Store(std::int64_t second, const TimestampText& text)
+{
+    // Only one thread refreshes the cache, the others keep their own copy
+    std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    if ((sequence & 1) != 0) return;
+    if (!sequence_.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) return;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::uint64_t words[kWords];
+    std::memcpy(words, text.text, sizeof(words));
+    for (std::size_t i = 0; i < kWords; ++i)
+    {
+        words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    size_.store(text.size, std::memory_order_relaxed);
+    second_.store(second, std::memory_order_relaxed);
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------
+
+std::int64_t CurrentTimestamp()
+{
+    ClockAnchor& anchor = GetClockAnchor();
+    std::int64_t steady = SteadyNanoseconds();
+    std::int64_t next = anchor.next.load(std::memory_order_relaxed);
+    if (steady >= next && anchor.next.compare_exchange_strong(next, steady + kAnchorInterval, std::memory_order_relaxed))
+    {
+        std::int64_t offset = anchor.offset.load(std::memory_order_relaxed);
+        std::int64_t target = WallNanoseconds() - SteadyNanoseconds();
+        anchor.offset.store(std::max(target, offset - kMaxBackwardStep), std::memory_order_relaxed);
+    }
+    thread_local std::int64_t last = 0;
+    last = std::max(last, anchor.offset.load(std::memory_order_relaxed) + steady);
+    return last;
+}
+
+TimestampCache& GetTimestampCache()
+{
+    static TimestampCache cache{"%1:%2:%3 %4-%5-%6"};
+    return cache;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
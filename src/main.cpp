@@ -12,31 +12,65 @@
 #include "clock.h"
 
 #include "subsys/log_manager.h"
+#include "logging/flight_recorder.h"
+#include "memory/linear_allocator.h"
+#include "memory/memory_tracker.h"
 //#include "memory/stack_allocator.h"
 
 int main(int argc, char** argv)
 {   
     std::unique_ptr<ruthen::subsys::LogManager> lm_ptr = std::make_unique<ruthen::subsys::LogManager>();
     lm_ptr->Initialize();
+    lm_ptr->EnableAsync();
+    ruthen::logging::FlightRecorder::StaticInstance()->InstallCrashHandlers("crash.log");
     lm_ptr->operator[](lm_ptr->GetClientLogger()).Log("Example.txt", "Pointer to Log Manager", ruthen::LogLevel::kTrace);
 
     ruthen::InitializeAPIs();
-    ruthen::Window window(720, 480, "OpenGL 4.5 window");
-    if(!window.GraphicsInitialized())
     {
-        std::exit(-1);
-    }
-    ruthen::Clock clock;
-    while(!window.ShouldClose())
-    {
-        if(clock.ElapsedTime().AsMicroseconds() < 16666) continue;
-        clock.Reset();
+        ruthen::Window window(720, 480, "OpenGL 4.5 window");
+        if(!window.GraphicsInitialized())
+        {
+            std::exit(-1);
+        }
+        ruthen::Clock clock;
+        ruthen::Clock report_clock;
+        ruthen::Logger& graphics_logger = lm_ptr->operator[](lm_ptr->GetGraphicsLogger());
+        {
+            // Per-frame scratch, valid until the end of the following frame
+            ruthen::memory::FrameAllocator frame_allocator{1 << 20};
+            while(!window.ShouldClose())
+            {
+                if(clock.ElapsedTime().AsMicroseconds() < 16666) continue;
+                clock.Reset();
+                frame_allocator.EndFrame();
+
+                window.Update();
+                window.SwapBuffers();
+                window.Clear();
 
-        window.Update();
-        window.SwapBuffers();
-        window.Clear();
-        
+                std::int64_t frame_time = clock.ElapsedTime().AsMicroseconds();
+                if(frame_time >= 16666)
+                {
+                    // Built in frame scratch, the logger copies it into its record
+                    std::size_t size = ruthen::FormattedSize<std::int64_t>("Frame took %1 us", frame_time);
+                    char* message = static_cast<char*>(frame_allocator.Allocate(size, 1));
+                    ruthen::FormatTo<std::int64_t>(message, size, "Frame took %1 us", frame_time);
+                    RUTHEN_LOG_PER_SECOND(1, graphics_logger, ruthen::LogLevel::kWarn, "Graphics.txt", "%1", std::string_view{message, size});
+                }
+                if(report_clock.ElapsedTime().AsSeconds() >= 10)
+                {
+                    report_clock.Reset();
+                    lm_ptr->ReportSuppressedLogs(lm_ptr->GetGraphicsLogger(), "Graphics.txt");
+                }
+            }
+        }
     }
     ruthen::TerminateAPIs();
+    // Taken once the log manager is gone and its threads are joined, so its
+    // memory isn't reported and every thread has published its counts
+    lm_ptr->Shutdown();
+    lm_ptr.reset();
+    std::string leaks = ruthen::memory::FormatMemoryLeaks();
+    if(!leaks.empty()) std::cerr << leaks << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <new>
+
+#include "subsys/memory_manager.h"
+
+// Built with RUTHEN_REPLACE_GLOBAL_NEW, routes every operator new and
+// delete of the executable through one MemoryManager
+namespace
+{
+
+using ruthen::subsys::MemoryManager;
+
+// Never destroyed, static destructors may still free memory after main
+MemoryManager& GetManager()
+{
+    alignas(MemoryManager) static unsigned char storage[sizeof(MemoryManager)];
+    static MemoryManager* manager = new (storage) MemoryManager{};
+    return *manager;
+}
+
+void* Allocate(std::size_t size, std::size_t alignment)
+{
+    if (void* pointer = GetManager().Allocate(size != 0 ? size : 1, alignment)) return pointer;
+    throw std::bad_alloc{};
+}
+
+void* AllocateNoThrow(std::size_t size, std::size_t alignment) noexcept
+{
+    return GetManager().Allocate(size != 0 ? size : 1, alignment);
+}
+
+void Free(void* pointer) noexcept
+{
+    GetManager().Free(pointer);
+}
+
+}
+
+void* operator new(std::size_t size) { return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](std::size_t size) { return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return AllocateNoThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return AllocateNoThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return Allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return Allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateNoThrow(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateNoThrow(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* pointer) noexcept { Free(pointer); }
+void operator delete[](void* pointer) noexcept { Free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { Free(pointer); }
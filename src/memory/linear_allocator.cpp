@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "memory/linear_allocator.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+LinearAllocator::LinearAllocator(std::size_t size_bytes, GrowthPolicy policy, MemoryTag tag) :
+    chunk_size_{size_bytes},
+    policy_{policy},
+    tag_{tag},
+    arena_{nullptr},
+    first_{NewChunk(size_bytes, tag)},
+    current_{first_},
+    used_{0},
+    filled_{0},
+    limit_{first_->size}
+{}
+
+LinearAllocator::LinearAllocator(VirtualArena& arena) :
+    chunk_size_{0},
+    policy_{GrowthPolicy::kFixed},
+    tag_{arena.GetTag()},
+    arena_{&arena},
+    first_{NewChunk(arena)},
+    current_{first_},
+    used_{0},
+    filled_{0},
+    limit_{arena.GetCommittedSize() - sizeof(Chunk)}
+{
+    chunk_size_ = first_->size;
+}
+
+LinearAllocator::LinearAllocator(LinearAllocator&& src) noexcept :
+    chunk_size_{std::exchange(src.chunk_size_, 0)},
+    policy_{src.policy_},
+    tag_{src.tag_},
+    arena_{std::exchange(src.arena_, nullptr)},
+    first_{std::exchange(src.first_, nullptr)},
+    current_{std::exchange(src.current_, nullptr)},
+    used_{std::exchange(src.used_, 0)},
+    filled_{std::exchange(src.filled_, 0)},
+    limit_{std::exchange(src.limit_, 0)}
+{}
+
+LinearAllocator& LinearAllocator::operator=(LinearAllocator&& rhs) noexcept
+{
+    if (this == &rhs) return *this;
+    if (arena_ == nullptr) FreeChunks(first_, tag_);
+    chunk_size_ = std::exchange(rhs.chunk_size_, 0);
+    policy_ = rhs.policy_;
+    tag_ = rhs.tag_;
+    arena_ = std::exchange(rhs.arena_, nullptr);
+    first_ = std::exchange(rhs.first_, nullptr);
+    current_ = std::exchange(rhs.current_, nullptr);
+    used_ = std::exchange(rhs.used_, 0);
+    filled_ = std::exchange(rhs.filled_, 0);
+    limit_ = std::exchange(rhs.limit_, 0);
+    return *this;
+}
+
+// An arena's chunk lives in the arena itself
+LinearAllocator::~LinearAllocator()
+{
+    if (arena_ == nullptr) FreeChunks(first_, tag_);
+}
+
+//----------------------------------------------------------------------
+
+// Moves on to the next chunk, or chains a new one, until the request fits
+void* LinearAllocator::Allocate(std::size_t size_bytes, std::size_t alignment)
+{
+    if (current_ == nullptr) return nullptr;
+    for (;;)
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(GetData(current_)) + used_;
+        std::size_t padding = static_cast<std::size_t>(-address & (alignment - 1));
+        std::size_t space = limit_ - used_;
+        if (padding <= space && size_bytes <= space - padding)
+        {
+            used_ += padding + size_bytes;
+            return reinterpret_cast<void*>(address + padding);
+        }
+        if (arena_ != nullptr && Commit(padding, size_bytes)) continue;
+        if (current_->next == nullptr)
+        {
+            if (policy_ == GrowthPolicy::kFixed) return nullptr;
+            if (size_bytes > std::numeric_limits<std::size_t>::max() / 2 - alignment) throw std::bad_alloc{};
+            current_->next = NewChunk(std::max(chunk_size_, size_bytes + alignment - 1), tag_);
+        }
+        filled_ += current_->size;
+        current_ = current_->next;
+        used_ = 0;
+        limit_ = current_->size;
+    }
+}
+
+void LinearAllocator::Reset()
+{
+    current_ = first_;
+    used_ = 0;
+    filled_ = 0;
+    if (arena_ != nullptr) limit_ = arena_->GetCommittedSize() - sizeof(Chunk);
+    else if (first_ != nullptr) limit_ = first_->size;
+}
+
+void LinearAllocator::Decommit()
+{
+    if (arena_ != nullptr) arena_->Decommit(sizeof(Chunk));
+    else if (first_ != nullptr) FreeChunks(std::exchange(first_->next, nullptr), tag_);
+    Reset();
+}
+
+//----------------------------------------------------------------------
+
+std::size_t LinearAllocator::GetSize() const
+{
+    return filled_ + used_;
+}
+
+std::size_t LinearAllocator::GetCapacity() const
+{
+    std::size_t capacity = 0;
+    for (Chunk* chunk = first_; chunk != nullptr; chunk = chunk->next) capacity += chunk->size;
+    return capacity;
+}
+
+std::size_t LinearAllocator::GetChunkCount() const
+{
+    std::size_t count = 0;
+    for (Chunk* chunk = first_; chunk != nullptr; chunk = chunk->next) ++count;
+    return count;
+}
+
+bool LinearAllocator::IsEmpty() const
+{
+    return GetSize() == 0;
+}
+
+bool LinearAllocator::Owns(const void* pointer) const
+{
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+    for (Chunk* chunk = first_; chunk != nullptr; chunk = chunk->next)
+    {
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(GetData(chunk));
+        if (address >= start && address < start + chunk->size) return true;
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+
+// Commits the arena far enough for the request, false past the reservation
+bool LinearAllocator::Commit(std::size_t padding, std::size_t size_bytes)
+{
+    std::size_t space = current_->size - used_;
+    if (padding > space || size_bytes > space - padding) return false;
+    if (!arena_->Commit(sizeof(Chunk) + used_ + padding + size_bytes)) return false;
+    limit_ = std::min(arena_->GetCommittedSize() - sizeof(Chunk), current_->size);
+    return true;
+}
+
+LinearAllocator::Chunk* LinearAllocator::NewChunk(std::size_t size_bytes, MemoryTag tag)
+{
+    void* pointer = std::malloc(sizeof(Chunk) + size_bytes);
+    if (pointer == nullptr) throw std::bad_alloc{};
+    TrackAllocation(tag, sizeof(Chunk) + size_bytes);
+    return new (pointer) Chunk{nullptr, size_bytes};
+}
+
+void LinearAllocator::FreeChunks(Chunk* chunk, MemoryTag tag)
+{
+    while (chunk != nullptr)
+    {
+        TrackFree(tag, sizeof(Chunk) + chunk->size);
+        std::free(std::exchange(chunk, chunk->next));
+    }
+}
+
+LinearAllocator::Chunk* LinearAllocator::NewChunk(VirtualArena& arena)
+{
+    if (arena.GetReservedSize() <= sizeof(Chunk) || !arena.Commit(sizeof(Chunk))) throw std::length_error{"arena too small for a linear allocator"};
+    return new (arena.GetData()) Chunk{nullptr, arena.GetReservedSize() - sizeof(Chunk)};
+}
+
+unsigned char* LinearAllocator::GetData(Chunk* chunk)
+{
+    return reinterpret_cast<unsigned char*>(chunk + 1);
+}
+
+//----------------------------------------------------------------------
+
+FrameAllocator::FrameAllocator(std::size_t size_bytes, LinearAllocator::GrowthPolicy policy, MemoryTag tag) :
+    buffers_{LinearAllocator{size_bytes, policy, tag}, LinearAllocator{size_bytes, policy, tag}},
+    current_{0}
+{}
+
+void* FrameAllocator::Allocate(std::size_t size_bytes, std::size_t alignment)
+{
+    return buffers_[current_].Allocate(size_bytes, alignment);
+}
+
+void FrameAllocator::EndFrame()
+{
+    current_ ^= 1;
+    buffers_[current_].Reset();
+}
+
+LinearAllocator& FrameAllocator::GetCurrent()
+{
+    return buffers_[current_];
+}
+
+const LinearAllocator& FrameAllocator::GetPrevious() const
+{
+    return buffers_[current_ ^ 1];
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
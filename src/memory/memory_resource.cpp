@@ -0,0 +1,79 @@
+#include "memory/memory_resource.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+LinearResource::LinearResource(LinearAllocator& allocator, std::pmr::memory_resource* upstream) :
+    allocator_{allocator},
+    upstream_{upstream}
+{}
+
+LinearAllocator& LinearResource::GetAllocator() const
+{
+    return allocator_;
+}
+
+std::pmr::memory_resource* LinearResource::GetUpstream() const
+{
+    return upstream_;
+}
+
+void* LinearResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (void* pointer = allocator_.Allocate(bytes, alignment)) return pointer;
+    return upstream_->allocate(bytes, alignment);
+}
+
+void LinearResource::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+    if (!allocator_.Owns(pointer)) upstream_->deallocate(pointer, bytes, alignment);
+}
+
+bool LinearResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+//----------------------------------------------------------------------
+
+StackResource::StackResource(StackAllocator& allocator, std::pmr::memory_resource* upstream) :
+    allocator_{allocator},
+    upstream_{upstream}
+{}
+
+StackAllocator& StackResource::GetAllocator() const
+{
+    return allocator_;
+}
+
+std::pmr::memory_resource* StackResource::GetUpstream() const
+{
+    return upstream_;
+}
+
+void* StackResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (void* pointer = allocator_.Allocate(bytes, alignment)) return pointer;
+    return upstream_->allocate(bytes, alignment);
+}
+
+void StackResource::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+    if (!allocator_.Owns(pointer)) upstream_->deallocate(pointer, bytes, alignment);
+}
+
+bool StackResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
@@ -0,0 +1,180 @@
+#include <array>
+#include <atomic>
+#include <sstream>
+
+#include "memory/memory_tracker.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr std::size_t kTagCount = static_cast<std::size_t>(MemoryTag::kCount);
+
+constexpr std::array<const char*, kTagCount> kTagNames =
+{
+    "General",
+    "Logging",
+    "Window",
+    "Graphics",
+    "Frame",
+    "Level"
+};
+
+struct alignas(64) SharedCounters
+{
+    std::atomic<std::int64_t> live_bytes;
+    std::atomic<std::int64_t> live_count;
+    std::atomic<std::int64_t> high_water_bytes;
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::size_t> budget_bytes;
+};
+
+std::array<SharedCounters, kTagCount> shared_counters{};
+std::atomic<MemoryBudgetCallback> budget_callback{nullptr};
+
+// Set once ThreadExit has run, counts made after that are published at once
+thread_local bool thread_exited = false;
+
+void Publish(MemoryTag tag, detail::PendingTagCounters& pending) noexcept
+{
+    if (pending.bytes == 0 && pending.count == 0 && pending.allocations == 0) return;
+    SharedCounters& counters = shared_counters[static_cast<std::size_t>(tag)];
+    std::int64_t live = counters.live_bytes.fetch_add(pending.bytes, std::memory_order_relaxed) + pending.bytes;
+    counters.live_count.fetch_add(pending.count, std::memory_order_relaxed);
+    counters.allocations.fetch_add(pending.allocations, std::memory_order_relaxed);
+    std::int64_t high_water = counters.high_water_bytes.load(std::memory_order_relaxed);
+    while (live > high_water && !counters.high_water_bytes.compare_exchange_weak(high_water, live, std::memory_order_relaxed)) {}
+    // Reported once per upward crossing
+    std::int64_t budget = static_cast<std::int64_t>(counters.budget_bytes.load(std::memory_order_relaxed));
+    if (budget > 0 && live > budget && live - pending.bytes <= budget)
+    {
+        MemoryBudgetCallback callback = budget_callback.load(std::memory_order_acquire);
+        if (callback != nullptr) callback(tag, static_cast<std::size_t>(live), static_cast<std::size_t>(budget));
+    }
+    pending = detail::PendingTagCounters{};
+}
+
+void PublishAll() noexcept
+{
+    for (std::size_t i = 0; i < kTagCount; ++i) Publish(static_cast<MemoryTag>(i), detail::thread_tag_counters.tags[i]);
+}
+
+// Hands the thread's remaining counts to the shared totals
+struct ThreadExit
+{
+    ~ThreadExit()
+    {
+        PublishAll();
+        detail::thread_tag_counters.registered = false;
+        thread_exited = true;
+    }
+};
+
+}
+
+//----------------------------------------------------------------------
+
+void detail::PublishTagCounters(MemoryTag tag) noexcept
+{
+    if (!thread_tag_counters.registered && !thread_exited)
+    {
+        // Set first, registering the exit handler may allocate through here
+        thread_tag_counters.registered = true;
+        thread_local ThreadExit thread_exit;
+    }
+    Publish(tag, thread_tag_counters.tags[static_cast<std::size_t>(tag)]);
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) noexcept :
+    previous_{detail::current_memory_tag}
+{
+    detail::current_memory_tag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+    detail::current_memory_tag = previous_;
+}
+
+//----------------------------------------------------------------------
+
+void FlushMemoryTracking() noexcept
+{
+    PublishAll();
+}
+
+const char* GetMemoryTagName(MemoryTag tag) noexcept
+{
+    std::size_t index = static_cast<std::size_t>(tag);
+    return index < kTagCount ? kTagNames[index] : "Unknown";
+}
+
+void SetMemoryBudget(MemoryTag tag, std::size_t bytes) noexcept
+{
+    std::size_t index = static_cast<std::size_t>(tag);
+    if (index < kTagCount) shared_counters[index].budget_bytes.store(bytes, std::memory_order_relaxed);
+}
+
+void SetMemoryBudgetCallback(MemoryBudgetCallback callback) noexcept
+{
+    budget_callback.store(callback, std::memory_order_release);
+}
+
+MemoryTagStats GetMemoryTagStats(MemoryTag tag) noexcept
+{
+    std::size_t index = static_cast<std::size_t>(tag);
+    if (index >= kTagCount) return MemoryTagStats{tag, 0, 0, 0, 0, 0};
+    const SharedCounters& counters = shared_counters[index];
+    return MemoryTagStats{
+        tag,
+        counters.live_bytes.load(std::memory_order_relaxed),
+        counters.live_count.load(std::memory_order_relaxed),
+        counters.high_water_bytes.load(std::memory_order_relaxed),
+        counters.allocations.load(std::memory_order_relaxed),
+        counters.budget_bytes.load(std::memory_order_relaxed)
+    };
+}
+
+//----------------------------------------------------------------------
+
+std::string FormatMemoryReport()
+{
+    FlushMemoryTracking();
+    std::ostringstream out;
+    out << "Memory by tag:";
+    for (std::size_t i = 0; i < kTagCount; ++i)
+    {
+        MemoryTagStats stats = GetMemoryTagStats(static_cast<MemoryTag>(i));
+        out << "\n  " << kTagNames[i] << ": " << stats.live_bytes << " bytes in " << stats.live_count << " allocations, peak "
+            << stats.high_water_bytes << " bytes, " << stats.allocations << " allocations total";
+        if (stats.budget_bytes > 0) out << ", budget " << stats.budget_bytes << " bytes";
+    }
+    return out.str();
+}
+
+std::string FormatMemoryLeaks()
+{
+    FlushMemoryTracking();
+    std::ostringstream out;
+    for (std::size_t i = 0; i < kTagCount; ++i)
+    {
+        MemoryTagStats stats = GetMemoryTagStats(static_cast<MemoryTag>(i));
+        if (stats.live_count == 0 && stats.live_bytes == 0) continue;
+        out << (out.tellp() == 0 ? "Leaked memory:" : "") << "\n  " << kTagNames[i] << ": " << stats.live_bytes << " bytes in "
+            << stats.live_count << " allocations";
+    }
+    return out.str();
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
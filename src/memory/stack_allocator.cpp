@@ -1,6 +1,8 @@
+#include <cstdint>
 #include <cstdlib>
-#include <cstring>
+#include <new>
 #include <stdexcept>
+#include <utility>
 
 #include "memory/stack_allocator.h"
 
@@ -10,38 +12,223 @@ namespace ruthen
 namespace memory
 {
 
-StackAllocator::StackAllocator(Size size_bytes) :
-    stack_size_{0},
-    block_count_{0},
-    block_arr_cap_{0},
-    blocks_{nullptr},
-    stack_{nullptr},
-    top_{nullptr}
+//----------------------------------------------------------------------
+
+namespace
+{
+
+// Padding that brings the address base + offset up to the alignment
+std::size_t AlignPadding(const unsigned char* base, std::size_t offset, std::size_t alignment)
+{
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(base) + offset;
+    return static_cast<std::size_t>(-address & (alignment - 1));
+}
+
+unsigned char* AllocateBuffer(std::size_t size_bytes, MemoryTag tag)
 {
-    void* pointer = malloc(size_bytes);
+    void* pointer = std::malloc(size_bytes != 0 ? size_bytes : 1);
     if (pointer == nullptr) throw std::bad_alloc{};
-    stack_size_ = size_bytes;
-    stack_ = pointer;
-    top_ = pointer;
+    TrackAllocation(tag, size_bytes);
+    return static_cast<unsigned char*>(pointer);
+}
+
+void FreeBuffer(unsigned char* buffer, std::size_t size_bytes, MemoryTag tag)
+{
+    if (buffer == nullptr) return;
+    TrackFree(tag, size_bytes);
+    std::free(buffer);
+}
+
+}
+
+//----------------------------------------------------------------------
+
+StackAllocator::StackAllocator(std::size_t size_bytes, MemoryTag tag) :
+    size_{size_bytes},
+    top_{0},
+    tag_{tag},
+    stack_{AllocateBuffer(size_bytes, tag)}
+{}
+
+StackAllocator::StackAllocator(StackAllocator&& src) noexcept :
+    size_{std::exchange(src.size_, 0)},
+    top_{std::exchange(src.top_, 0)},
+    tag_{src.tag_},
+    stack_{std::exchange(src.stack_, nullptr)}
+{}
+
+StackAllocator& StackAllocator::operator=(StackAllocator&& rhs) noexcept
+{
+    if (this == &rhs) return *this;
+    FreeBuffer(stack_, size_, tag_);
+    size_ = std::exchange(rhs.size_, 0);
+    top_ = std::exchange(rhs.top_, 0);
+    tag_ = rhs.tag_;
+    stack_ = std::exchange(rhs.stack_, nullptr);
+    return *this;
 }
 
 StackAllocator::~StackAllocator()
 {
-    if(stack_ != nullptr) free(stack_);
-    if(blocks_ != nullptr) free(blocks_);
+    FreeBuffer(stack_, size_, tag_);
+}
+
+void* StackAllocator::Allocate(std::size_t size_bytes, std::size_t alignment)
+{
+    std::size_t padding = AlignPadding(stack_, top_, alignment);
+    if (padding > size_ - top_ || size_bytes > size_ - top_ - padding) return nullptr;
+    void* pointer = stack_ + top_ + padding;
+    top_ += padding + size_bytes;
+    return pointer;
 }
 
-MemoryBlock StackAllocator::Allocate(Size size_bytes)
+StackAllocator::Marker StackAllocator::GetMarker() const
 {
-    
+    return top_;
 }
 
-void StackAllocator::Deallocate(MemoryBlock block)
+void StackAllocator::FreeToMarker(Marker marker)
 {
+    if (marker > top_) throw std::invalid_argument{"stack marker above the current top"};
+    top_ = marker;
+}
+
+void StackAllocator::Clear()
+{
+    top_ = 0;
+}
+
+std::size_t StackAllocator::Capacity() const
+{
+    return size_;
+}
+
+std::size_t StackAllocator::UsedBytes() const
+{
+    return top_;
+}
 
+std::size_t StackAllocator::FreeBytes() const
+{
+    return size_ - top_;
 }
 
+bool StackAllocator::Owns(const void* pointer) const
+{
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(stack_);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+    return address >= start && address < start + size_;
+}
+
+//----------------------------------------------------------------------
+
+DoubleEndedStackAllocator::DoubleEndedStackAllocator(std::size_t size_bytes, MemoryTag tag) :
+    size_{size_bytes},
+    bottom_{0},
+    top_{size_bytes},
+    tag_{tag},
+    stack_{AllocateBuffer(size_bytes, tag)}
+{}
+
+DoubleEndedStackAllocator::DoubleEndedStackAllocator(DoubleEndedStackAllocator&& src) noexcept :
+    size_{std::exchange(src.size_, 0)},
+    bottom_{std::exchange(src.bottom_, 0)},
+    top_{std::exchange(src.top_, 0)},
+    tag_{src.tag_},
+    stack_{std::exchange(src.stack_, nullptr)}
+{}
+
+DoubleEndedStackAllocator& DoubleEndedStackAllocator::operator=(DoubleEndedStackAllocator&& rhs) noexcept
+{
+    if (this == &rhs) return *this;
+    FreeBuffer(stack_, size_, tag_);
+    size_ = std::exchange(rhs.size_, 0);
+    bottom_ = std::exchange(rhs.bottom_, 0);
+    top_ = std::exchange(rhs.top_, 0);
+    tag_ = rhs.tag_;
+    stack_ = std::exchange(rhs.stack_, nullptr);
+    return *this;
 }
 
+DoubleEndedStackAllocator::~DoubleEndedStackAllocator()
+{
+    FreeBuffer(stack_, size_, tag_);
 }
 
+void* DoubleEndedStackAllocator::AllocateBottom(std::size_t size_bytes, std::size_t alignment)
+{
+    std::size_t padding = AlignPadding(stack_, bottom_, alignment);
+    if (padding > top_ - bottom_ || size_bytes > top_ - bottom_ - padding) return nullptr;
+    void* pointer = stack_ + bottom_ + padding;
+    bottom_ += padding + size_bytes;
+    return pointer;
+}
+
+// Moves the top down by the size, then further down to the alignment
+void* DoubleEndedStackAllocator::AllocateTop(std::size_t size_bytes, std::size_t alignment)
+{
+    if (size_bytes > top_ - bottom_) return nullptr;
+    std::size_t start = top_ - size_bytes;
+    std::size_t padding = reinterpret_cast<std::uintptr_t>(stack_ + start) & (alignment - 1);
+    if (padding > start - bottom_) return nullptr;
+    top_ = start - padding;
+    return stack_ + top_;
+}
+
+DoubleEndedStackAllocator::Marker DoubleEndedStackAllocator::GetBottomMarker() const
+{
+    return bottom_;
+}
+
+DoubleEndedStackAllocator::Marker DoubleEndedStackAllocator::GetTopMarker() const
+{
+    return size_ - top_;
+}
+
+void DoubleEndedStackAllocator::FreeBottomToMarker(Marker marker)
+{
+    if (marker > bottom_) throw std::invalid_argument{"stack marker above the current bottom end"};
+    bottom_ = marker;
+}
+
+void DoubleEndedStackAllocator::FreeTopToMarker(Marker marker)
+{
+    if (marker > size_ - top_) throw std::invalid_argument{"stack marker above the current top end"};
+    top_ = size_ - marker;
+}
+
+void DoubleEndedStackAllocator::ClearBottom()
+{
+    bottom_ = 0;
+}
+
+void DoubleEndedStackAllocator::ClearTop()
+{
+    top_ = size_;
+}
+
+std::size_t DoubleEndedStackAllocator::Capacity() const
+{
+    return size_;
+}
+
+std::size_t DoubleEndedStackAllocator::BottomUsedBytes() const
+{
+    return bottom_;
+}
+
+std::size_t DoubleEndedStackAllocator::TopUsedBytes() const
+{
+    return size_ - top_;
+}
+
+std::size_t DoubleEndedStackAllocator::FreeBytes() const
+{
+    return top_ - bottom_;
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
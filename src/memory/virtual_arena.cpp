@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memory/virtual_arena.h"
+
+namespace ruthen
+{
+
+namespace memory
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+std::size_t GetPageSize()
+{
+    long size = ::sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<std::size_t>(size) : 4096;
+}
+
+std::size_t RoundUp(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Reserves the range, over-reserving by one alignment and trimming both
+// ends when it must start on a huge page boundary
+unsigned char* Reserve(std::size_t size, std::size_t alignment)
+{
+    std::size_t length = size + (alignment > GetPageSize() ? alignment : 0);
+    void* mapping = ::mmap(nullptr, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc{};
+    unsigned char* start = static_cast<unsigned char*>(mapping);
+    if (length == size) return start;
+    unsigned char* data = start + (-reinterpret_cast<std::uintptr_t>(start) & (alignment - 1));
+    if (data != start) ::munmap(start, data - start);
+    if (data + size != start + length) ::munmap(data + size, start + length - data - size);
+    return data;
+}
+
+}
+
+//----------------------------------------------------------------------
+
+VirtualArena::VirtualArena(std::size_t reserve_bytes, bool huge_pages, MemoryTag tag) :
+    reserved_{0},
+    committed_{0},
+    granularity_{huge_pages ? kHugePageSize : std::max(kCommitGranularity, GetPageSize())},
+    huge_pages_{huge_pages},
+    tag_{tag},
+    data_{nullptr}
+{
+    if (reserve_bytes > std::numeric_limits<std::size_t>::max() / 2) throw std::bad_alloc{};
+    reserved_ = RoundUp(std::max<std::size_t>(reserve_bytes, 1), granularity_);
+    data_ = Reserve(reserved_, granularity_);
+    // Without transparent huge page support the arena carries on with small pages
+    if (huge_pages_ && ::madvise(data_, reserved_, MADV_HUGEPAGE) != 0) huge_pages_ = false;
+}
+
+VirtualArena::VirtualArena(VirtualArena&& src) noexcept :
+    reserved_{std::exchange(src.reserved_, 0)},
+    committed_{std::exchange(src.committed_, 0)},
+    granularity_{src.granularity_},
+    huge_pages_{src.huge_pages_},
+    tag_{src.tag_},
+    data_{std::exchange(src.data_, nullptr)}
+{}
+
+VirtualArena& VirtualArena::operator=(VirtualArena&& rhs) noexcept
+{
+    if (this == &rhs) return *this;
+    Release();
+    reserved_ = std::exchange(rhs.reserved_, 0);
+    committed_ = std::exchange(rhs.committed_, 0);
+    granularity_ = rhs.granularity_;
+    huge_pages_ = rhs.huge_pages_;
+    tag_ = rhs.tag_;
+    data_ = std::exchange(rhs.data_, nullptr);
+    return *this;
+}
+
+VirtualArena::~VirtualArena()
+{
+    Release();
+}
+
+//----------------------------------------------------------------------
+
+bool VirtualArena::Commit(std::size_t size_bytes)
+{
+    if (size_bytes <= committed_) return true;
+    if (size_bytes > reserved_) return false;
+    std::size_t target = std::min(RoundUp(size_bytes, granularity_), reserved_);
+    if (::mprotect(data_ + committed_, target - committed_, PROT_READ | PROT_WRITE) != 0) throw std::bad_alloc{};
+    // Charged as one allocation whose size follows the commit
+    if (committed_ != 0) TrackFree(tag_, committed_);
+    TrackAllocation(tag_, target);
+    committed_ = target;
+    return true;
+}
+
+void VirtualArena::Decommit(std::size_t keep_bytes)
+{
+    std::size_t keep = std::min(RoundUp(keep_bytes, granularity_), committed_);
+    if (keep == committed_) return;
+    ::madvise(data_ + keep, committed_ - keep, MADV_DONTNEED);
+    ::mprotect(data_ + keep, committed_ - keep, PROT_NONE);
+    TrackFree(tag_, committed_);
+    if (keep != 0) TrackAllocation(tag_, keep);
+    committed_ = keep;
+}
+
+// Only whole pages inside the range are dropped
+void VirtualArena::Discard(std::size_t offset, std::size_t size_bytes)
+{
+    if (offset >= committed_) return;
+    std::size_t page_size = GetPageSize();
+    std::size_t start = RoundUp(offset, page_size);
+    std::size_t end = offset + std::min(size_bytes, committed_ - offset);
+    end -= end % page_size;
+    if (start < end) ::madvise(data_ + start, end - start, MADV_DONTNEED);
+}
+
+//----------------------------------------------------------------------
+
+unsigned char* VirtualArena::GetData() const
+{
+    return data_;
+}
+
+std::size_t VirtualArena::GetReservedSize() const
+{
+    return reserved_;
+}
+
+std::size_t VirtualArena::GetCommittedSize() const
+{
+    return committed_;
+}
+
+bool VirtualArena::UsesHugePages() const
+{
+    return huge_pages_;
+}
+
+MemoryTag VirtualArena::GetTag() const
+{
+    return tag_;
+}
+
+bool VirtualArena::Owns(const void* pointer) const
+{
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(data_);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+    return address >= start && address < start + reserved_;
+}
+
+//----------------------------------------------------------------------
+
+void VirtualArena::Release()
+{
+    if (data_ == nullptr) return;
+    if (committed_ != 0) TrackFree(tag_, committed_);
+    ::munmap(data_, reserved_);
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
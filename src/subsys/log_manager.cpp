@@ -4,8 +4,13 @@
 #include <array>
 #include <stdexcept>
 #include <algorithm>
+#include <thread>
+#include <utility>
 
 #include "subsys/log_manager.h"
+#include "logging/epoch.h"
+#include "logging/flight_recorder.h"
+#include "memory/memory_tracker.h"
 #include "format.h"
 
 namespace ruthen
@@ -23,6 +28,17 @@ struct ReservedLoggerInfo
     LogLevel level;
 };
 
+// Unpublishes the writer and waits until no thread can still push to it,
+// so the entries it holds are all written before it is freed
+void RetireWriter(std::atomic<logging::AsyncWriter*>& published)
+{
+    std::unique_ptr<logging::AsyncWriter> writer{published.exchange(nullptr, std::memory_order_seq_cst)};
+    if (writer == nullptr) return;
+    std::uint64_t epoch = logging::AdvanceEpoch();
+    while (logging::OldestActiveEpoch() <= epoch) std::this_thread::yield();
+    writer->Stop();
+}
+
 }
 
 static std::array<ReservedLoggerInfo, 4> kReservedLoggers =
@@ -40,14 +56,20 @@ Logger::Logger() :
     level_{LogLevel::kTrace},
     suppress_output_{false},
     suppress_callback_{false},
-    on_log_callback_{nullptr}
+    on_log_callback_{nullptr},
+    id_{0},
+    manager_{nullptr},
+    callback_subscription_{0}
 {}
 Logger::Logger(const std::string& name):
     name_{name},
     level_{LogLevel::kTrace},
     suppress_output_{false},
     suppress_callback_{false},
-    on_log_callback_{nullptr}
+    on_log_callback_{nullptr},
+    id_{0},
+    manager_{nullptr},
+    callback_subscription_{0}
 {}
 
 Logger::Logger(const std::string& name, const LogLevel& level):
@@ -55,7 +77,10 @@ Logger::Logger(const std::string& name, const LogLevel& level):
     level_{level},
     suppress_output_{false},
     suppress_callback_{false},
-    on_log_callback_{nullptr}
+    on_log_callback_{nullptr},
+    id_{0},
+    manager_{nullptr},
+    callback_subscription_{0}
 {}
 
 bool Logger::operator==(const std::string& name) const
@@ -87,48 +112,8 @@ Logger::~Logger()
 
 void Logger::Log(const std::string& filename, const std::string& log, LogLevel level) const
 {
-    if (suppress_output_) return;
-    std::ofstream file;
-    file.exceptions(std::ios::badbit | std::ios::failbit);
-    file.open(filename, std::ios::app);
-    std::time_t time = std::time(nullptr);
-    const std::tm* tm = std::localtime(&time);
-    std::string time_str = Format("%1:%2:%3 %4-%5-%6", 
-                          std::to_string(tm->tm_sec),
-                          std::to_string(tm->tm_min),
-                          std::to_string(tm->tm_hour),
-                          std::to_string(tm->tm_mday),
-                          std::to_string(tm->tm_mon + 1),
-                          std::to_string(tm->tm_year + 1900));
-    std::string level_str;
-    switch(level)
-    {
-        case LogLevel::kTrace:    level_str = "Trace";    break;
-        case LogLevel::kDebug:    level_str = "Debug";    break;
-        case LogLevel::kInfo:     level_str = "Info";     break;
-        case LogLevel::kWarn:     level_str = "Warn";     break;
-        case LogLevel::kError:    level_str = "Error";    break;
-        case LogLevel::kCritical: level_str = "Critical"; break;
-        case LogLevel::kCrash:    level_str = "Crash";    break;
-        default: level_str = "Trace";
-    }
-
-    file << "--------------------------------------------" << '\n';
-    file << "Time:         " << time_str << '\n';
-    file << "Level:        " << level_str << '\n';
-    file << "Name:         " << name_ << '\n';
-    file << "Destination:  " << filename << '\n';
-    file << '\n';
-    file << log << '\n';
-
-    file.close();
-    if (suppress_callback_ || on_log_callback_ == nullptr) return;
-    LogDetails details;
-    details.time = time_str;
-    details.name = name_;
-    details.destination = filename;
-    details.message = log;
-    on_log_callback_(details);
+    if (!ShouldLog(level)) return;
+    Write(filename, log, level, false);
 }
 
 void Logger::Log(const std::string& filename, const std::string& log) const
@@ -148,7 +133,37 @@ void Logger::SetLevel(LogLevel level)
 
 void Logger::SetLogCallback(void(*log_callback)(LogDetails))
 {
-    if(log_callback != nullptr) on_log_callback_ = log_callback;
+    if(log_callback == nullptr) return;
+    on_log_callback_ = log_callback;
+    if(manager_ == nullptr) return;
+    if(callback_subscription_ != 0) manager_->Unsubscribe(callback_subscription_);
+    callback_subscription_ = manager_->Subscribe(id_, [log_callback](const logging::LogEntry* entries, std::size_t count)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            LogDetails details;
+            details.time = logging::GetTimestampCache().Get(entries[i].timestamp);
+            details.timestamp = entries[i].timestamp;
+            details.level = GetLevelName(entries[i].level);
+            details.name = entries[i].name;
+            details.destination = entries[i].destination;
+            details.message = entries[i].message;
+            log_callback(details);
+        }
+    });
+}
+
+logging::SubscriptionID Logger::Subscribe(logging::LogSubscriber subscriber)
+{
+    if(manager_ == nullptr) throw std::logic_error{"logger is not owned by a log manager"};
+    return manager_->Subscribe(id_, std::move(subscriber));
+}
+
+void Logger::Unsubscribe(logging::SubscriptionID id)
+{
+    if(manager_ == nullptr) return;
+    manager_->Unsubscribe(id);
+    if(id == callback_subscription_) callback_subscription_ = 0;
 }
 
 std::string Logger::GetName() const
@@ -156,21 +171,122 @@ std::string Logger::GetName() const
     return name_;
 }
 
+void Logger::Write(std::string_view filename, std::string_view message, LogLevel level, bool truncated) const
+{
+    logging::LogEntry entry{logging::CurrentTimestamp(), id_, level, name_, filename, message, truncated, 0};
+    logging::FlightRecorder* recorder = logging::FlightRecorder::StaticInstance();
+    recorder->Record(entry.timestamp, id_, level, name_, message);
+    if (manager_ != nullptr)
+    {
+        manager_->Submit(entry, !suppress_callback_);
+        if (level >= LogLevel::kCrash) recorder->DumpCrashLog();
+        return;
+    }
+
+    std::string text;
+    logging::AppendEntryText(text, entry);
+    std::ofstream file;
+    file.exceptions(std::ios::badbit | std::ios::failbit);
+    file.open(std::string{filename}, std::ios::app);
+    file << text;
+    file.close();
+    if (level >= LogLevel::kCrash) recorder->DumpCrashLog();
+
+    if (suppress_callback_ || on_log_callback_ == nullptr) return;
+    LogDetails details;
+    details.time = logging::GetTimestampCache().Get(entry.timestamp);
+    details.timestamp = entry.timestamp;
+    details.level = GetLevelName(level);
+    details.name = name_;
+    details.destination = filename;
+    details.message = message;
+    on_log_callback_(details);
+}
+
+void Logger::WriteBinary(const logging::FormatInfo* info, std::string_view arguments, LogLevel level) const
+{
+    logging::LogEntry entry{logging::CurrentTimestamp(), id_, level, name_, info->destination, arguments, false, info->id};
+    // Decoding is too slow for the recorder, it keeps the format string
+    logging::FlightRecorder* recorder = logging::FlightRecorder::StaticInstance();
+    recorder->Record(entry.timestamp, id_, level, name_, info->format);
+    if (manager_ != nullptr)
+    {
+        manager_->Submit(entry, !suppress_callback_);
+        if (level >= LogLevel::kCrash) recorder->DumpCrashLog();
+        return;
+    }
+
+    std::string message = logging::DecodeMessage(info->format, info->signature, arguments);
+    entry.message = message;
+    entry.format = 0;
+    std::string text;
+    logging::AppendEntryText(text, entry);
+    std::ofstream file;
+    file.exceptions(std::ios::badbit | std::ios::failbit);
+    file.open(info->destination, std::ios::app);
+    file << text;
+    file.close();
+    if (level >= LogLevel::kCrash) recorder->DumpCrashLog();
+
+    if (suppress_callback_ || on_log_callback_ == nullptr) return;
+    LogDetails details;
+    details.time = logging::GetTimestampCache().Get(entry.timestamp);
+    details.timestamp = entry.timestamp;
+    details.level = GetLevelName(level);
+    details.name = name_;
+    details.destination = info->destination;
+    details.message = message;
+    on_log_callback_(details);
+}
+
 //----------------------------------------------------------------------
 
 namespace subsys
 {
 
+//----------------------------------------------------------------------
+
+LogManager::Registry::Registry(std::pmr::memory_resource* resource) :
+    slots{resource},
+    names{resource},
+    subscribers{resource}
+{}
 
-LogManager::LogManager() :
-    loggers_{},
-    reusable_ids_{}
+LogManager::Registry::Registry(const Registry& src, std::pmr::memory_resource* resource) :
+    slots{src.slots, resource},
+    names{src.names, resource},
+    subscribers{src.subscribers, resource}
 {}
 
+//----------------------------------------------------------------------
+
+LogManager::LogManager(std::pmr::memory_resource* resource) :
+    resource_{resource},
+    registry_mutex_{},
+    registry_{nullptr},
+    current_{nullptr},
+    retired_{resource},
+    loggers_{resource},
+    names_{resource},
+    reusable_ids_{std::pmr::deque<LoggerID>{resource}},
+    sinks_{std::make_unique<logging::SinkTable>()},
+    async_mutex_{},
+    async_writer_{nullptr},
+    subscribers_{std::make_unique<logging::SubscriberTable>()},
+    dispatcher_{nullptr}
+{
+    memory::MemoryTagScope scope{memory::MemoryTag::kLogging};
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    Publish(std::make_unique<Registry>(resource_));
+}
+
 
 Logger& LogManager::operator[](LoggerID id)
 {
-    return loggers_.at(id);
+    logging::EpochGuard guard;
+    const Registry& registry = GetRegistry();
+    if (id >= registry.slots.size() || registry.slots[id] == nullptr) throw std::out_of_range{"invalid logger identifier"};
+    return *registry.slots[id];
 }
 
 LogManager::~LogManager()
@@ -188,24 +304,146 @@ void LogManager::Initialize()
 
 void LogManager::Shutdown()
 {
+    DisableAsync();
+    RetireWriter(dispatcher_);
+    subscribers_->Clear();
+    sinks_->CloseAll();
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    registry_.store(nullptr, std::memory_order_release);
+    retired_.clear();
+    current_.reset();
     loggers_.clear();
-    reusable_ids_ = {};
+    names_.clear();
+    reusable_ids_ = std::queue<LoggerID, std::pmr::deque<LoggerID>>{std::pmr::deque<LoggerID>{resource_}};
+    Publish(std::make_unique<Registry>(resource_));
 }
 
-LoggerID LogManager::CreateLogger(const std::string& name)
+void LogManager::EnableAsync(const logging::AsyncConfig& config)
+{
+    memory::MemoryTagScope scope{memory::MemoryTag::kLogging};
+    std::lock_guard<std::mutex> lock{async_mutex_};
+    RetireWriter(async_writer_);
+    std::unique_ptr<logging::AsyncWriter> writer = std::make_unique<logging::AsyncWriter>(config, *sinks_);
+    writer->Start();
+    async_writer_.store(writer.release(), std::memory_order_release);
+}
+
+void LogManager::DisableAsync()
+{
+    std::lock_guard<std::mutex> lock{async_mutex_};
+    RetireWriter(async_writer_);
+}
+
+void LogManager::Flush()
+{
+    logging::EpochGuard guard;
+    logging::AsyncWriter* writer = async_writer_.load(std::memory_order_acquire);
+    if (writer != nullptr) writer->Flush();
+    else sinks_->Flush();
+}
+
+void LogManager::SetDefaultSinkConfig(const logging::SinkConfig& config)
+{
+    sinks_->SetDefaultConfig(config);
+}
+
+void LogManager::SetSinkConfig(const std::string& destination, const logging::SinkConfig& config)
+{
+    memory::MemoryTagScope scope{memory::MemoryTag::kLogging};
+    sinks_->Configure(destination, config);
+}
+
+void LogManager::EnableBinaryLog(const std::string& path)
+{
+    Flush();
+    sinks_->OpenBinaryLog(path);
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    for(const auto& [name, id] : GetRegistry().names)
+    {
+        sinks_->DefineLogger(id, name);
+    }
+}
+
+void LogManager::DisableBinaryLog()
+{
+    Flush();
+    sinks_->CloseBinaryLog();
+}
+
+logging::SubscriptionID LogManager::Subscribe(LoggerID id, logging::LogSubscriber subscriber)
 {
-    for(const auto& [id, logger] : loggers_)
+    memory::MemoryTagScope scope{memory::MemoryTag::kLogging};
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    const Registry& current = GetRegistry();
+    if (id >= current.slots.size() || current.slots[id] == nullptr) throw std::out_of_range{"invalid logger identifier"};
+    if (dispatcher_.load(std::memory_order_relaxed) == nullptr)
     {
-        if(logger == name) throw std::invalid_argument{"logger with given name already exists"};
+        // Subscribers are fed from their own thread, a full queue drops
+        // notifications instead of stalling the logging thread
+        logging::AsyncConfig config;
+        config.queue_capacity = 1024;
+        config.batch_size = 64;
+        config.overflow_policy = logging::OverflowPolicy::kDrop;
+        std::unique_ptr<logging::AsyncWriter> dispatcher = std::make_unique<logging::AsyncWriter>(config, *subscribers_);
+        dispatcher->Start();
+        dispatcher_.store(dispatcher.release(), std::memory_order_release);
     }
+    logging::SubscriptionID subscription = subscribers_->Add(id, std::move(subscriber));
+    std::unique_ptr<Registry> registry = std::make_unique<Registry>(current, resource_);
+    ++registry->subscribers[id];
+    Publish(std::move(registry));
+    return subscription;
+}
+
+void LogManager::Unsubscribe(logging::SubscriptionID id)
+{
+    LoggerID logger{};
+    if (!subscribers_->Remove(id, logger)) return;
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    const Registry& current = GetRegistry();
+    if (logger >= current.slots.size() || current.subscribers[logger] == 0) return;
+    std::unique_ptr<Registry> registry = std::make_unique<Registry>(current, resource_);
+    --registry->subscribers[logger];
+    Publish(std::move(registry));
+}
+
+void LogManager::ReportSuppressedLogs(LoggerID id, const std::string& destination)
+{
+    std::string summary = logging::TakeSuppressedSummary();
+    if (summary.empty()) return;
+    operator[](id).Log(destination, summary, LogLevel::kWarn);
+}
+
+void LogManager::Submit(const logging::LogEntry& entry, bool notify)
+{
+    logging::EpochGuard guard;
+    logging::AsyncWriter* dispatcher = notify ? dispatcher_.load(std::memory_order_acquire) : nullptr;
+    if (dispatcher != nullptr)
+    {
+        const Registry& registry = GetRegistry();
+        if (entry.logger < registry.subscribers.size() && registry.subscribers[entry.logger] > 0) dispatcher->Push(entry);
+    }
+    logging::AsyncWriter* writer = async_writer_.load(std::memory_order_acquire);
+    if (writer != nullptr)
+    {
+        writer->Push(entry);
+        if (entry.level >= LogLevel::kCrash) writer->Flush();
+        return;
+    }
+    sinks_->Write(&entry, 1);
+    if (entry.level >= LogLevel::kError) sinks_->Flush();
+}
+
+LoggerID LogManager::CreateLogger(const std::string& name)
+{
+    memory::MemoryTagScope scope{memory::MemoryTag::kLogging};
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    const Registry& registry = GetRegistry();
+    if(registry.names.find(name) != registry.names.end()) throw std::invalid_argument{"logger with given name already exists"};
 
     for(const auto& [res_id, res_name, res_level] : kReservedLoggers)
     {
-        if (name != res_name) continue;
-        auto result = loggers_.emplace(std::make_pair(res_id, res_name));
-        if(!result.second) throw std::runtime_error{"failed to create a new logger"};
-        result.first->second.SetLevel(res_level);
-        return res_id;
+        if (name == res_name) return AddLogger(res_id, name, res_level);
     }
 
     LoggerID id{};
@@ -214,22 +452,17 @@ LoggerID LogManager::CreateLogger(const std::string& name)
         id = reusable_ids_.front();
         reusable_ids_.pop();
     }
-    else id = (loggers_.size() < kReservedLoggers.size() ? kReservedLoggers.back().id + 1 : loggers_.size() + 1);
-
-    auto result = loggers_.emplace(std::make_pair(id, name));
-    if(!result.second) throw std::runtime_error{"failed to create a new logger"};
-    result.first->second.SetLevel(LogLevel::kTrace);
-    return id;
+    else id = std::max<std::size_t>(registry.slots.size(), kReservedLoggers.back().id + 1);
+    return AddLogger(id, name, LogLevel::kTrace);
 }
 
 void LogManager::DeleteLogger(LoggerID id)
 {
-    auto iterator = loggers_.find(id);
-    if (iterator == loggers_.end()) throw std::out_of_range{"invalid logger identifier"};
-    auto reserved_iter = std::find_if(kReservedLoggers.begin(), kReservedLoggers.end(), [&](const ReservedLoggerInfo& info)->bool{return loggers_[id].GetName() == info.name;});
-    if(reserved_iter != kReservedLoggers.end()) throw std::invalid_argument{"can not explicitly delete reserved loggers"};
-    loggers_.erase(iterator);
-    reusable_ids_.push(id);
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    const Registry& registry = GetRegistry();
+    if (id >= registry.slots.size() || registry.slots[id] == nullptr) throw std::out_of_range{"invalid logger identifier"};
+    if (id <= kReservedLoggers.back().id) throw std::invalid_argument{"can not explicitly delete reserved loggers"};
+    RemoveLogger(id);
 }
 
 void LogManager::DeleteLogger(const std::string& name)
@@ -238,66 +471,164 @@ void LogManager::DeleteLogger(const std::string& name)
     {
         if (name == res_name) throw std::invalid_argument{"can not explicitly delete reserved loggers"};
     }
-    for(auto& [id, logger] : loggers_)
-    {
-        if (logger == name) 
-        {
-            loggers_.erase(id);
-            reusable_ids_.push(id);
-            break;
-        }
-    }
-
+    std::lock_guard<std::mutex> lock{registry_mutex_};
+    const Registry& registry = GetRegistry();
+    auto iterator = registry.names.find(name);
+    if (iterator != registry.names.end()) RemoveLogger(iterator->second);
 }
 
 LoggerID LogManager::GetLogger(const std::string& name) const
 {
-    for(auto& [id, logger_name] : loggers_)
-    {
-        if (logger_name == name) 
-        {
-            return id;
-        }
-    }
-    return -1;
+    logging::EpochGuard guard;
+    const Registry& registry = GetRegistry();
+    auto iterator = registry.names.find(name);
+    if (iterator == registry.names.end()) return -1;
+    return iterator->second;
 }
 LoggerID LogManager::GetSystemLogger() const
 {
-    return GetLogger(kReservedLoggers[0].name);
+    return LoggerExists(kReservedLoggers[0].id) ? kReservedLoggers[0].id : -1;
 }
 LoggerID LogManager::GetDebugLogger() const
 {
-    return GetLogger(kReservedLoggers[1].name);
+    return LoggerExists(kReservedLoggers[1].id) ? kReservedLoggers[1].id : -1;
 }
 LoggerID LogManager::GetGraphicsLogger() const
 {
-    return GetLogger(kReservedLoggers[2].name);
+    return LoggerExists(kReservedLoggers[2].id) ? kReservedLoggers[2].id : -1;
 }
 LoggerID LogManager::GetClientLogger() const
 {
-    return GetLogger(kReservedLoggers[3].name);
+    return LoggerExists(kReservedLoggers[3].id) ? kReservedLoggers[3].id : -1;
 }
 bool LogManager::LoggerExists(LoggerID id) const
 {
-    return loggers_.find(id) != loggers_.end();
+    logging::EpochGuard guard;
+    const Registry& registry = GetRegistry();
+    return id < registry.slots.size() && registry.slots[id] != nullptr;
 }
 bool LogManager::LoggerExists(const std::string& name) const
 {
-    for(auto& [id, logger] : loggers_)
-    {
-        if (logger == name) return true;
-    }
-    return false;
+    logging::EpochGuard guard;
+    const Registry& registry = GetRegistry();
+    return registry.names.find(name) != registry.names.end();
 }
 bool LogManager::DefaultLoggersInitialized() const
 {
     for(const auto& [res_id, res_name, res_level] : kReservedLoggers)
     {
-        if (!LoggerExists(res_name)) return false;
+        if (!LoggerExists(res_id)) return false;
     }
     return true;
 }
+bool LogManager::IsAsync() const
+{
+    return async_writer_.load(std::memory_order_acquire) != nullptr;
+}
+bool LogManager::IsBinaryLogEnabled() const
+{
+    return sinks_->HasBinaryLog();
+}
+std::uint64_t LogManager::DroppedLogCount() const
+{
+    logging::EpochGuard guard;
+    logging::AsyncWriter* writer = async_writer_.load(std::memory_order_acquire);
+    if (writer == nullptr) return 0;
+    return writer->DroppedCount() + writer->OverwrittenCount();
+}
+std::uint64_t LogManager::DroppedNotificationCount() const
+{
+    logging::EpochGuard guard;
+    logging::AsyncWriter* dispatcher = dispatcher_.load(std::memory_order_acquire);
+    if (dispatcher == nullptr) return 0;
+    return dispatcher->DroppedCount();
+}
+
+//----------------------------------------------------------------------
+
+const LogManager::Registry& LogManager::GetRegistry() const
+{
+    return *registry_.load(std::memory_order_acquire);
+}
 
+// Callers hold registry_mutex_. The replaced snapshot and a removed
+// logger are retired under the epoch that was current while they were
+// still reachable.
+void LogManager::Publish(std::unique_ptr<Registry> registry, std::unique_ptr<Logger> logger, std::string_view name)
+{
+    registry_.store(registry.get(), std::memory_order_seq_cst);
+    std::unique_ptr<Registry> previous = std::exchange(current_, std::move(registry));
+    if (previous == nullptr) return;
+    std::uint64_t epoch = logging::AdvanceEpoch();
+    retired_.push_back(Retired{epoch, std::move(previous), std::move(logger), name});
+    Reclaim();
 }
 
-}
\ No newline at end of file
+// Callers hold registry_mutex_
+void LogManager::Reclaim()
+{
+    std::uint64_t oldest = logging::OldestActiveEpoch();
+    auto end = std::find_if(retired_.begin(), retired_.end(), [oldest](const Retired& entry) { return entry.epoch >= oldest; });
+    if (end == retired_.begin()) return;
+    std::pmr::vector<std::pmr::string> names{resource_};
+    for (auto iterator = retired_.begin(); iterator != end; ++iterator)
+    {
+        if (!iterator->name.empty()) names.emplace_back(iterator->name);
+    }
+    retired_.erase(retired_.begin(), end);
+
+    // A name stays while the current or a retired snapshot still refers to it
+    for (const std::pmr::string& name : names)
+    {
+        bool used = current_->names.find(name) != current_->names.end();
+        for (const Retired& entry : retired_)
+        {
+            used = used || entry.registry->names.find(name) != entry.registry->names.end();
+        }
+        if (!used) names_.erase(name);
+    }
+}
+
+LoggerID LogManager::AddLogger(LoggerID id, const std::string& name, LogLevel level)
+{
+    std::unique_ptr<Logger> logger = std::make_unique<Logger>(name, level);
+    logger->id_ = id;
+    logger->manager_ = this;
+
+    std::unique_ptr<Registry> registry = std::make_unique<Registry>(GetRegistry(), resource_);
+    if (registry->slots.size() <= id)
+    {
+        registry->slots.resize(id + 1, nullptr);
+        registry->subscribers.resize(id + 1, 0);
+    }
+    registry->slots[id] = logger.get();
+    registry->names.emplace(*names_.emplace(name).first, id);
+
+    if (loggers_.size() <= id) loggers_.resize(id + 1);
+    loggers_[id] = std::move(logger);
+    Publish(std::move(registry));
+    sinks_->DefineLogger(id, name);
+    return id;
+}
+
+void LogManager::RemoveLogger(LoggerID id)
+{
+    memory::MemoryTagScope scope{memory::MemoryTag::kLogging};
+    std::unique_ptr<Registry> registry = std::make_unique<Registry>(GetRegistry(), resource_);
+    std::string_view name{};
+    std::erase_if(registry->names, [id, &name](const auto& entry)
+    {
+        if (entry.second != id) return false;
+        name = entry.first;
+        return true;
+    });
+    registry->slots[id] = nullptr;
+    registry->subscribers[id] = 0;
+    subscribers_->RemoveLogger(id);
+    Publish(std::move(registry), std::move(loggers_[id]), name);
+    reusable_ids_.push(id);
+}
+
+}
+
+}
@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memory/virtual_arena.h"
+#include "subsys/memory_manager.h"
+
+namespace ruthen
+{
+
+namespace subsys
+{
+
+//----------------------------------------------------------------------
+
+namespace
+{
+
+constexpr int kNoSlot = -1;
+constexpr std::size_t kSlotWords = MemoryManager::kMaxThreadCaches / 64;
+
+// Slot bits are shared by all managers, a slot indexes every manager's cache array
+std::atomic<std::uint64_t> slot_bits[kSlotWords];
+
+// Blocks left in the slot of an exited thread go to the next thread taking it
+struct ThreadSlot
+{
+    ~ThreadSlot()
+    {
+        if (index >= 0) slot_bits[index / 64].fetch_and(~(std::uint64_t{1} << (index % 64)), std::memory_order_release);
+        index = kNoSlot;
+        acquired = true;
+    }
+
+    int index = kNoSlot;
+    // Set once a slot was asked for, also after the slot is gone
+    bool acquired = false;
+};
+
+thread_local ThreadSlot thread_slot;
+
+int AcquireSlot()
+{
+    for (std::size_t word = 0; word < kSlotWords; ++word)
+    {
+        std::uint64_t bits = slot_bits[word].load(std::memory_order_relaxed);
+        while (bits != ~std::uint64_t{0})
+        {
+            int bit = std::countr_one(bits);
+            bits = slot_bits[word].fetch_or(std::uint64_t{1} << bit, std::memory_order_acquire);
+            if ((bits & (std::uint64_t{1} << bit)) == 0) return static_cast<int>(word * 64) + bit;
+        }
+    }
+    return kNoSlot;
+}
+
+struct LargeHeader
+{
+    // From the start of the mapping to the returned pointer
+    std::uint32_t offset;
+    memory::MemoryTag tag;
+    std::size_t length;
+};
+
+constexpr std::size_t kMaxLargeAlignment = std::size_t{1} << 30;
+constexpr int kMinClassShift = std::bit_width(MemoryManager::kMinClassSize - 1);
+
+static_assert(sizeof(LargeHeader) <= MemoryManager::kMinClassSize, "large header must fit the minimum alignment");
+
+std::size_t GetPageSize()
+{
+    long size = ::sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<std::size_t>(size) : 4096;
+}
+
+std::size_t RoundUp(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Blocks of a class are larger than half its size, so one tag byte per
+// half class size of its range gives every block a byte of its own
+int GetTagShift(std::size_t class_index)
+{
+    return kMinClassShift - 1 + static_cast<int>(class_index);
+}
+
+std::size_t GetTagTablesSize(std::size_t class_capacity, std::size_t page_size)
+{
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < MemoryManager::kClassCount; ++i) size += class_capacity >> GetTagShift(i);
+    return RoundUp(size, page_size);
+}
+
+std::array<unsigned char*, MemoryManager::kClassCount> MakeTagTables(unsigned char* start, std::size_t class_capacity)
+{
+    std::array<unsigned char*, MemoryManager::kClassCount> tables{};
+    for (std::size_t i = 0; i < tables.size(); ++i)
+    {
+        tables[i] = start;
+        start += class_capacity >> GetTagShift(i);
+    }
+    return tables;
+}
+
+// Address space only, nothing is charged until Protect commits it
+unsigned char* Reserve(std::size_t size)
+{
+    void* mapping = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc{};
+    return static_cast<unsigned char*>(mapping);
+}
+
+// Commits the pages overlapping the range. Edge pages may be shared with a
+// neighbouring range and committed twice, which is harmless.
+bool Protect(unsigned char* start, unsigned char* end, std::size_t page_size)
+{
+    std::uintptr_t first = reinterpret_cast<std::uintptr_t>(start) / page_size * page_size;
+    std::uintptr_t last = RoundUp(reinterpret_cast<std::uintptr_t>(end), page_size);
+    return first >= last || ::mprotect(reinterpret_cast<void*>(first), last - first, PROT_READ | PROT_WRITE) == 0;
+}
+
+// Largest block count whose blocks and bitfields fit the capacity
+template<typename Pool>
+std::size_t FitBlockCount(std::size_t capacity, std::size_t block_size)
+{
+    std::size_t count = capacity / block_size;
+    count -= count / (8 * block_size + 1);
+    while (count > 0 && Pool::StorageSize(count) > capacity) --count;
+    return std::min<std::size_t>(count, Pool::kNoBlock - 1);
+}
+
+// Calls the function with the pool of a runtime size class index, through
+// a table with one entry per pool
+template<typename Tuple, typename Function>
+void VisitPool(Tuple& pools, std::size_t index, Function&& function)
+{
+    typedef void (*Invoker)(Tuple&, Function&);
+    static constexpr auto kInvokers = []<std::size_t... kIndex>(std::index_sequence<kIndex...>)
+    {
+        return std::array<Invoker, sizeof...(kIndex)>{[](Tuple& pools, Function& function) { function(std::get<kIndex>(pools)); }...};
+    }(std::make_index_sequence<std::tuple_size_v<std::remove_const_t<Tuple>>>{});
+    kInvokers[index](pools, function);
+}
+
+}
+
+//----------------------------------------------------------------------
+
+// Class slices come first, each split into the slices of its sub-classes.
+// The tag tables and the cache array follow them in the same mapping. Only
+// the cache array is committed up front.
+MemoryManager::MemoryManager(std::size_t class_capacity) :
+    class_capacity_{std::bit_ceil(std::max({class_capacity, kSubClassCount * kMaxClassSize, kSubClassCount * GetPageSize()}))},
+    slice_capacity_{class_capacity_ / kSubClassCount},
+    page_size_{GetPageSize()},
+    base_{Reserve(GetReservationSize(class_capacity_, page_size_))},
+    tags_{MakeTagTables(base_ + kClassCount * class_capacity_, class_capacity_)},
+    caches_{reinterpret_cast<ThreadCache*>(base_ + kClassCount * class_capacity_ + GetTagTablesSize(class_capacity_, page_size_))},
+    pools_{MakePools(base_, slice_capacity_, std::make_index_sequence<kSizeClassCount>{})},
+    committed_{},
+    locks_{},
+    large_bytes_{0},
+    large_count_{0}
+{
+    unsigned char* caches = reinterpret_cast<unsigned char*>(caches_);
+    if (!Protect(caches, caches + kMaxThreadCaches * sizeof(ThreadCache), page_size_))
+    {
+        ::munmap(base_, GetReservationSize(class_capacity_, page_size_));
+        throw std::bad_alloc{};
+    }
+}
+
+MemoryManager::~MemoryManager()
+{
+    ::munmap(base_, GetReservationSize(class_capacity_, page_size_));
+}
+
+template<std::size_t... kIndex>
+MemoryManager::Pools MemoryManager::MakePools(unsigned char* base, std::size_t slice_capacity, std::index_sequence<kIndex...>)
+{
+    return Pools{std::tuple_element_t<kIndex, Pools>{
+        base + kIndex * slice_capacity,
+        FitBlockCount<std::tuple_element_t<kIndex, Pools>>(slice_capacity, GetBlockSize(kIndex))}...};
+}
+
+//----------------------------------------------------------------------
+
+void* MemoryManager::Allocate(std::size_t size, std::size_t alignment, memory::MemoryTag tag)
+{
+    std::size_t index = GetSizeClass(size, alignment);
+    if (index == kSizeClassCount) return AllocateLarge(size, alignment, tag);
+    void* pointer = nullptr;
+    ThreadCache* cache = GetThreadCache();
+    if (cache == nullptr) pointer = AllocateShared(index);
+    else
+    {
+        Magazine& magazine = cache->magazines[index];
+        if (magazine.count == 0) Refill(index, magazine);
+        if (magazine.count > 0) pointer = magazine.blocks[--magazine.count];
+    }
+    // A class whose slice is used up leaves the request to the large path
+    if (pointer == nullptr) return AllocateLarge(size, alignment, tag);
+    GetTag(index, pointer) = static_cast<unsigned char>(tag);
+    memory::TrackAllocation(tag, GetBlockSize(index));
+    return pointer;
+}
+
+void MemoryManager::Free(void* pointer)
+{
+    if (pointer == nullptr) return;
+    std::size_t offset = reinterpret_cast<std::uintptr_t>(pointer) - reinterpret_cast<std::uintptr_t>(base_);
+    if (offset >= kClassCount * class_capacity_)
+    {
+        FreeLarge(pointer);
+        return;
+    }
+    std::size_t index = offset >> std::countr_zero(slice_capacity_);
+    memory::TrackFree(static_cast<memory::MemoryTag>(GetTag(index, pointer)), GetBlockSize(index));
+    ThreadCache* cache = GetThreadCache();
+    if (cache == nullptr)
+    {
+        FreeShared(index, pointer);
+        return;
+    }
+    Magazine& magazine = cache->magazines[index];
+    if (magazine.count == 2 * GetBatchSize(index)) Drain(index, magazine, GetBatchSize(index));
+    magazine.blocks[magazine.count++] = pointer;
+}
+
+void MemoryManager::FlushThreadCache()
+{
+    ThreadCache* cache = GetThreadCache();
+    if (cache == nullptr) return;
+    for (std::size_t i = 0; i < kSizeClassCount; ++i)
+    {
+        Drain(i, cache->magazines[i], cache->magazines[i].count);
+    }
+}
+
+//----------------------------------------------------------------------
+
+SizeClassStats MemoryManager::GetSizeClassStats(std::size_t index) const
+{
+    if (index >= kSizeClassCount) throw std::out_of_range{"size class index out of range"};
+    SizeClassStats stats{GetBlockSize(index), 0, 0, 0};
+    std::lock_guard<std::mutex> lock{locks_[index].mutex};
+    VisitPool(pools_, index, [&stats](const auto& pool)
+    {
+        stats.used_blocks = pool.UsedCount();
+        stats.touched_blocks = pool.TouchedCount();
+        stats.block_capacity = pool.BlockCount();
+    });
+    return stats;
+}
+
+std::size_t MemoryManager::GetLargeBytes() const
+{
+    return large_bytes_.load(std::memory_order_relaxed);
+}
+
+std::size_t MemoryManager::GetLargeCount() const
+{
+    return large_count_.load(std::memory_order_relaxed);
+}
+
+std::size_t MemoryManager::GetSizeClass(std::size_t size, std::size_t alignment)
+{
+    static_assert(kSizeClassCount <= 256, "size classes are looked up as bytes");
+    // First size class whose blocks fit, per 16 bytes of request
+    static constexpr std::array<std::uint8_t, kMaxClassSize / kMinClassSize> kSizeClasses = []
+    {
+        std::array<std::uint8_t, kMaxClassSize / kMinClassSize> classes{};
+        std::size_t index = 0;
+        for (std::size_t i = 0; i < classes.size(); ++i)
+        {
+            while (kBlockSizes[index] < (i + 1) * kMinClassSize) ++index;
+            classes[i] = static_cast<std::uint8_t>(index);
+        }
+        return classes;
+    }();
+    std::size_t needed = std::max({size, alignment, kMinClassSize});
+    if (needed > kMaxClassSize) return kSizeClassCount;
+    if (alignment <= kMinClassSize) return kSizeClasses[(needed - 1) / kMinClassSize];
+    // Only the last sub-class of a class has power of two blocks, aligned to their size
+    std::size_t class_index = static_cast<std::size_t>(std::bit_width(needed - 1) - kMinClassShift);
+    return class_index * kSubClassCount + kSubClassCount - 1;
+}
+
+//----------------------------------------------------------------------
+
+MemoryManager::ThreadCache* MemoryManager::GetThreadCache()
+{
+    ThreadSlot& slot = thread_slot;
+    if (!slot.acquired)
+    {
+        slot.index = AcquireSlot();
+        slot.acquired = true;
+    }
+    return slot.index != kNoSlot ? caches_ + slot.index : nullptr;
+}
+
+// Commits whole chunks of blocks past the committed ones, along with their
+// tag bytes and bitfield words. Called under the class lock.
+bool MemoryManager::Commit(std::size_t index, std::size_t blocks)
+{
+    std::size_t committed = committed_[index];
+    if (blocks <= committed) return true;
+    std::size_t block_size = GetBlockSize(index);
+    std::size_t chunk = std::max(memory::VirtualArena::kCommitGranularity, page_size_) / block_size;
+    unsigned char* slice = base_ + index * slice_capacity_;
+    // Tag bytes of the blocks, counted from the start of the class
+    std::size_t class_index = index / kSubClassCount;
+    std::size_t class_offset = index % kSubClassCount * slice_capacity_;
+    int tag_shift = GetTagShift(class_index);
+    bool done = false;
+    VisitPool(pools_, index, [&](const auto& pool)
+    {
+        typedef std::remove_cvref_t<decltype(pool)> Pool;
+        if (blocks > pool.BlockCount()) return;
+        std::size_t target = std::min(RoundUp(blocks, chunk), pool.BlockCount());
+        unsigned char* bitfields = slice + Pool::BitfieldOffset(pool.BlockCount());
+        std::size_t word_size = sizeof(typename Pool::Bitfield);
+        done = Protect(slice + committed * block_size, slice + target * block_size, page_size_)
+            && Protect(tags_[class_index] + ((class_offset + committed * block_size) >> tag_shift),
+                tags_[class_index] + ((class_offset + target * block_size - 1) >> tag_shift) + 1, page_size_)
+            && Protect(bitfields + committed / Pool::kBitfieldBits * word_size,
+                bitfields + (target + Pool::kBitfieldBits - 1) / Pool::kBitfieldBits * word_size, page_size_);
+        if (done) committed_[index] = target;
+    });
+    return done;
+}
+
+// Free blocks below the frontier are committed, the frontier block itself
+// is committed before the pool hands it out
+void* MemoryManager::AllocateShared(std::size_t index)
+{
+    void* pointer = nullptr;
+    std::lock_guard<std::mutex> lock{locks_[index].mutex};
+    VisitPool(pools_, index, [this, &pointer, index](auto& pool)
+    {
+        if (pool.UsedCount() < pool.TouchedCount() || Commit(index, pool.TouchedCount() + 1)) pointer = pool.Allocate(GetBlockSize(index));
+    });
+    return pointer;
+}
+
+void MemoryManager::FreeShared(std::size_t index, void* pointer)
+{
+    std::lock_guard<std::mutex> lock{locks_[index].mutex};
+    VisitPool(pools_, index, [pointer, index](auto& pool) { pool.Free(pointer, GetBlockSize(index)); });
+}
+
+void MemoryManager::Refill(std::size_t index, Magazine& magazine)
+{
+    std::size_t batch = GetBatchSize(index);
+    std::lock_guard<std::mutex> lock{locks_[index].mutex};
+    VisitPool(pools_, index, [this, &magazine, batch, index](auto& pool)
+    {
+        while (magazine.count < batch)
+        {
+            if (pool.UsedCount() == pool.TouchedCount() && !Commit(index, pool.TouchedCount() + 1)) break;
+            void* pointer = pool.Allocate(GetBlockSize(index));
+            if (pointer == nullptr) break;
+            magazine.blocks[magazine.count++] = pointer;
+        }
+    });
+}
+
+void MemoryManager::Drain(std::size_t index, Magazine& magazine, std::size_t count)
+{
+    if (count == 0) return;
+    std::lock_guard<std::mutex> lock{locks_[index].mutex};
+    VisitPool(pools_, index, [&magazine, count, index](auto& pool)
+    {
+        for (std::size_t i = 0; i < count && magazine.count > 0; ++i)
+        {
+            pool.Free(magazine.blocks[--magazine.count], GetBlockSize(index));
+        }
+    });
+}
+
+//----------------------------------------------------------------------
+
+// The header sits right below the returned pointer
+void* MemoryManager::AllocateLarge(std::size_t size, std::size_t alignment, memory::MemoryTag tag)
+{
+    std::size_t align = std::max(alignment, kMinClassSize);
+    if (align > kMaxLargeAlignment || size > std::numeric_limits<std::size_t>::max() / 2 - align - page_size_) return nullptr;
+    std::size_t length = RoundUp(sizeof(LargeHeader) + align - 1 + size, page_size_);
+    void* mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return nullptr;
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(mapping) + sizeof(LargeHeader);
+    address = (address + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    LargeHeader* header = reinterpret_cast<LargeHeader*>(address) - 1;
+    *header = LargeHeader{static_cast<std::uint32_t>(address - reinterpret_cast<std::uintptr_t>(mapping)), tag, length};
+    large_bytes_.fetch_add(length, std::memory_order_relaxed);
+    large_count_.fetch_add(1, std::memory_order_relaxed);
+    memory::TrackAllocation(tag, length);
+    return reinterpret_cast<void*>(address);
+}
+
+void MemoryManager::FreeLarge(void* pointer)
+{
+    LargeHeader header = *(static_cast<LargeHeader*>(pointer) - 1);
+    large_bytes_.fetch_sub(header.length, std::memory_order_relaxed);
+    large_count_.fetch_sub(1, std::memory_order_relaxed);
+    memory::TrackFree(header.tag, header.length);
+    ::munmap(static_cast<unsigned char*>(pointer) - header.offset, header.length);
+}
+
+unsigned char& MemoryManager::GetTag(std::size_t index, const void* pointer) const
+{
+    std::size_t class_index = index / kSubClassCount;
+    std::size_t offset = reinterpret_cast<std::uintptr_t>(pointer) - reinterpret_cast<std::uintptr_t>(base_) - class_index * class_capacity_;
+    return tags_[class_index][offset >> GetTagShift(class_index)];
+}
+
+//----------------------------------------------------------------------
+
+std::size_t MemoryManager::GetBlockSize(std::size_t index)
+{
+    return kBlockSizes[index];
+}
+
+// About 4KB per batch and a magazine holds two, blocks cached for each of
+// the many size classes count towards the footprint
+std::size_t MemoryManager::GetBatchSize(std::size_t index)
+{
+    static constexpr std::array<std::size_t, kSizeClassCount> kBatchSizes = []
+    {
+        std::array<std::size_t, kSizeClassCount> sizes{};
+        for (std::size_t i = 0; i < sizes.size(); ++i) sizes[i] = std::clamp<std::size_t>(4096 / kBlockSizes[i], 2, 32);
+        return sizes;
+    }();
+    return kBatchSizes[index];
+}
+
+std::size_t MemoryManager::GetReservationSize(std::size_t class_capacity, std::size_t page_size)
+{
+    return kClassCount * class_capacity + GetTagTablesSize(class_capacity, page_size) + RoundUp(kMaxThreadCaches * sizeof(ThreadCache), page_size);
+}
+
+//----------------------------------------------------------------------
+
+}
+
+}
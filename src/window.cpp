@@ -79,13 +79,13 @@ void Window::Impl::Open(int width, int height, const char* title)
 {
     if(width <= 0) 
     {
-        SYSLOGF_ERROR("Invalid \'width\' argument for window construction (%1)", std::to_string(width));
+        SYSLOGF_ERROR("Invalid \'width\' argument for window construction (%1)", width);
         THROW(std::invalid_argument{"Invalid \'width\' argument for window construction"});
         return;
     }
     if(height <= 0)
     {
-        SYSLOGF_ERROR("Invalid \'height\' argument for window construction (%1)", std::to_string(height)); 
+        SYSLOGF_ERROR("Invalid \'height\' argument for window construction (%1)", height); 
         THROW(std::invalid_argument{"Invalid \'height\' argument for window construction"});
         return;
     }
@@ -0,0 +1,188 @@
+// Converts binary logs written by LogManager::EnableBinaryLog into the
+// regular text layout.
+//
+// usage: ruthenium-logdecode <binary log> [-o <output file>]
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "logging/binary_log.h"
+#include "logging/log_record.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+class FrameReader
+{
+public:
+    explicit FrameReader(std::string_view data) : data_{data}, offset_{0}, failed_{false} {}
+
+public:
+    template<typename T>
+    T Read()
+    {
+        T value{};
+        if (offset_ + sizeof(T) > data_.size())
+        {
+            failed_ = true;
+            return value;
+        }
+        std::memcpy(&value, data_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+    std::string_view ReadString()
+    {
+        return ReadBytes(Read<std::uint32_t>());
+    }
+    std::string_view ReadBytes(std::size_t size)
+    {
+        if (offset_ + size > data_.size())
+        {
+            failed_ = true;
+            return {};
+        }
+        std::string_view bytes = data_.substr(offset_, size);
+        offset_ += size;
+        return bytes;
+    }
+    std::string_view Rest() { return ReadBytes(data_.size() - offset_); }
+
+public:
+    bool AtEnd() const { return offset_ >= data_.size(); }
+    bool Failed() const { return failed_; }
+    bool StartsWith(std::string_view prefix) const { return data_.substr(offset_, prefix.size()) == prefix; }
+
+private:
+    std::string_view data_;
+    std::size_t offset_;
+    bool failed_;
+};
+
+bool Decode(std::string_view data, std::ostream& output)
+{
+    const std::string_view magic{logging::kBinaryLogMagic, sizeof(logging::kBinaryLogMagic)};
+    std::unordered_map<logging::FormatID, logging::FormatInfo> formats;
+    std::unordered_map<std::uint64_t, std::string> loggers;
+    FrameReader reader{data};
+    std::string text;
+    if (!reader.StartsWith(magic))
+    {
+        std::cerr << "not a binary log file\n";
+        return false;
+    }
+
+    while (!reader.AtEnd())
+    {
+        // Every logging session starts with a fresh header and its own ids
+        if (reader.StartsWith(magic))
+        {
+            reader.ReadBytes(magic.size());
+            formats.clear();
+            loggers.clear();
+            continue;
+        }
+        logging::FrameKind kind = static_cast<logging::FrameKind>(reader.Read<std::uint8_t>());
+        FrameReader frame{reader.ReadBytes(reader.Read<std::uint32_t>())};
+        if (reader.Failed())
+        {
+            std::cerr << "binary log is truncated\n";
+            return false;
+        }
+
+        switch (kind)
+        {
+            case logging::FrameKind::kLogger:
+            {
+                std::uint64_t id = frame.Read<std::uint64_t>();
+                loggers[id] = std::string{frame.ReadString()};
+                break;
+            }
+            case logging::FrameKind::kFormat:
+            {
+                logging::FormatInfo info{};
+                info.id = frame.Read<logging::FormatID>();
+                info.level = static_cast<LogLevel>(frame.Read<std::int32_t>());
+                info.line = frame.Read<std::uint32_t>();
+                info.format = frame.ReadString();
+                info.destination = frame.ReadString();
+                info.file = frame.ReadString();
+                info.signature = frame.ReadString();
+                formats[info.id] = std::move(info);
+                break;
+            }
+            case logging::FrameKind::kRecord:
+            {
+                logging::LogEntry entry{};
+                entry.format = frame.Read<logging::FormatID>();
+                entry.timestamp = frame.Read<std::int64_t>();
+                entry.logger = static_cast<LoggerID>(frame.Read<std::uint64_t>());
+                entry.level = static_cast<LogLevel>(frame.Read<std::int32_t>());
+                std::string_view arguments = frame.Rest();
+                auto format = formats.find(entry.format);
+                if (format == formats.end()) break;
+                auto logger = loggers.find(entry.logger);
+                std::string message = logging::DecodeMessage(format->second.format, format->second.signature, arguments);
+                entry.name = logger != loggers.end() ? std::string_view{logger->second} : std::string_view{"<unknown>"};
+                entry.destination = format->second.destination;
+                entry.message = message;
+                text.clear();
+                logging::AppendEntryText(text, entry);
+                output << text;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::string input_path;
+    std::string output_path;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument{argv[i]};
+        if (argument == "-o" && i + 1 < argc) output_path = argv[++i];
+        else if (input_path.empty()) input_path = argument;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " <binary log> [-o <output file>]\n";
+            return 2;
+        }
+    }
+    if (input_path.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " <binary log> [-o <output file>]\n";
+        return 2;
+    }
+
+    std::ifstream input{input_path, std::ios::binary};
+    if (!input)
+    {
+        std::cerr << "failed to open " << input_path << '\n';
+        return 1;
+    }
+    std::string data{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+
+    if (output_path.empty()) return Decode(data, std::cout) ? 0 : 1;
+    std::ofstream output{output_path, std::ios::app};
+    if (!output)
+    {
+        std::cerr << "failed to open " << output_path << '\n';
+        return 1;
+    }
+    return Decode(data, output) ? 0 : 1;
+}
@@ -0,0 +1,413 @@
+// Prints the entries of a text log that fall into a time range, optionally
+// only from one logger or at a minimum level. The side index written by the
+// sinks (or the block index of a compressed segment) is used to skip the
+// parts of the file that cannot match, only the selected blocks are read.
+//
+// Both entry layouts are understood: the multi-line entries of the
+// LogManager sinks and the one-line entries of the legacy SYSLOG* writer,
+// "[dd.mm.yyyy ss:mm:hh] [name] |Level| : message".
+//
+// Times are nanoseconds since the epoch or local time in the layout of the
+// LogManager entries, "ss:mm:hh dd-mm-yyyy".
+//
+// usage: ruthenium-logquery <log> [--from <time>] [--to <time>] [--level <level>] [--logger <name>] [--stats] [-o <output file>]
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logging/compression.h"
+#include "logging/log_index.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+constexpr std::string_view kUsage = " <log> [--from <time>] [--to <time>] [--level <level>] [--logger <name>] [--stats] [-o <output file>]\n";
+constexpr std::string_view kSeparator = "--------------------------------------------\n";
+constexpr std::int64_t kNanoseconds = 1000000000;
+
+enum class EntryLayout
+{
+    kBlock,
+    kLine
+};
+
+//----------------------------------------------------------------------
+
+struct Query
+{
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    LogLevel level = LogLevel::kTrace;
+    std::string logger;
+};
+
+struct Stats
+{
+    std::size_t blocks = 0;
+    std::size_t blocks_read = 0;
+    std::uint64_t bytes_read = 0;
+    std::size_t entries = 0;
+};
+
+//----------------------------------------------------------------------
+
+// Entries only carry whole seconds, so every comparison is made on seconds
+std::int64_t ToSeconds(std::int64_t timestamp)
+{
+    std::int64_t seconds = timestamp / kNanoseconds;
+    return timestamp % kNanoseconds < 0 ? seconds - 1 : seconds;
+}
+
+// The default is the layout of the "Time:" line written by AppendEntryText
+std::int64_t ParseLocalTime(std::string_view text, const char* layout = "%S:%M:%H %d-%m-%Y")
+{
+    std::tm time{};
+    std::istringstream stream{std::string{text}};
+    stream >> std::get_time(&time, layout);
+    if (stream.fail()) return std::numeric_limits<std::int64_t>::min();
+    time.tm_isdst = -1;
+    return static_cast<std::int64_t>(std::mktime(&time));
+}
+
+std::int64_t ParseTime(std::string_view text, bool end)
+{
+    if (!text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+    {
+        return std::stoll(std::string{text});
+    }
+    std::int64_t seconds = ParseLocalTime(text);
+    if (seconds == std::numeric_limits<std::int64_t>::min()) throw std::invalid_argument{"bad time"};
+    return end ? (seconds + 1) * kNanoseconds - 1 : seconds * kNanoseconds;
+}
+
+LogLevel ParseLevel(std::string_view text)
+{
+    for (int level = LogLevel::kTrace; level <= LogLevel::kCrash; ++level)
+    {
+        std::string_view name = GetLevelName(static_cast<LogLevel>(level));
+        bool equal = name.size() == text.size() && std::equal(name.begin(), name.end(), text.begin(),
+            [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+        if (equal || text == std::to_string(level)) return static_cast<LogLevel>(level);
+    }
+    throw std::invalid_argument{"bad level"};
+}
+
+//----------------------------------------------------------------------
+
+// A text log split into blocks, each described by a mark. Stretches the
+// index does not cover get marks that match everything.
+class LogSource
+{
+public:
+    explicit LogSource(const std::string& path)
+    {
+        if (path.ends_with(logging::kCompressedLogExtension))
+        {
+            compressed_ = std::make_unique<logging::CompressedLogReader>(path);
+            for (const logging::CompressedBlock& block : compressed_->GetBlocks())
+            {
+                blocks_.push_back(logging::TimeMark{block.offset, block.raw_size, block.first_timestamp, block.last_timestamp,
+                    block.logger_mask, block.level_mask});
+            }
+            DetectLayout();
+            return;
+        }
+        file_.open(path, std::ios::binary | std::ios::ate);
+        if (!file_) throw std::runtime_error{"failed to open " + path};
+        std::uint64_t size = static_cast<std::uint64_t>(file_.tellg());
+        std::vector<logging::TimeMark> marks = logging::ReadLogIndex(path + std::string{logging::kLogIndexExtension});
+        std::sort(marks.begin(), marks.end(), [](const logging::TimeMark& a, const logging::TimeMark& b) { return a.offset < b.offset; });
+        std::uint64_t position = 0;
+        for (logging::TimeMark mark : marks)
+        {
+            if (mark.offset < position || mark.offset >= size) continue;
+            AddUnknown(position, mark.offset);
+            mark.size = std::min(mark.size, size - mark.offset);
+            blocks_.push_back(mark);
+            position = mark.offset + mark.size;
+        }
+        AddUnknown(position, size);
+        DetectLayout();
+    }
+
+    // Legacy logs start with the bracketed time of their first line
+    void DetectLayout()
+    {
+        if (blocks_.empty()) return;
+        std::string chunk;
+        Read(0, chunk);
+        if (!chunk.empty() && chunk[0] == '[') layout_ = EntryLayout::kLine;
+    }
+
+public:
+    void Read(std::size_t index, std::string& out)
+    {
+        out.clear();
+        if (compressed_)
+        {
+            compressed_->ReadBlock(index, out);
+            return;
+        }
+        const logging::TimeMark& block = blocks_[index];
+        out.resize(block.size);
+        file_.seekg(static_cast<std::streamoff>(block.offset));
+        file_.read(out.data(), static_cast<std::streamsize>(block.size));
+        out.resize(static_cast<std::size_t>(file_.gcount()));
+        file_.clear();
+    }
+
+    [[nodiscard]] const std::vector<logging::TimeMark>& GetBlocks() const
+    {
+        return blocks_;
+    }
+
+    [[nodiscard]] EntryLayout GetLayout() const
+    {
+        return layout_;
+    }
+
+private:
+    void AddUnknown(std::uint64_t begin, std::uint64_t end)
+    {
+        for (; begin < end; begin += logging::kIndexInterval)
+        {
+            blocks_.push_back(logging::UnknownMark(begin, std::min<std::uint64_t>(logging::kIndexInterval, end - begin)));
+        }
+    }
+
+private:
+    std::unique_ptr<logging::CompressedLogReader> compressed_;
+    std::ifstream file_;
+    std::vector<logging::TimeMark> blocks_;
+    EntryLayout layout_ = EntryLayout::kBlock;
+};
+
+//----------------------------------------------------------------------
+
+bool MayMatch(const logging::TimeMark& block, const Query& query)
+{
+    if (ToSeconds(block.last_timestamp) < ToSeconds(query.from) || ToSeconds(block.first_timestamp) > ToSeconds(query.to)) return false;
+    if ((block.level_mask & ~(logging::LevelMaskBit(query.level) - 1)) == 0) return false;
+    return query.logger.empty() || (block.logger_mask & logging::LoggerMaskBit(query.logger)) != 0;
+}
+
+std::string_view GetField(std::string_view entry, std::string_view key)
+{
+    std::size_t begin = entry.find(key);
+    if (begin == std::string_view::npos) return {};
+    begin = entry.find_first_not_of(' ', begin + key.size());
+    std::size_t end = entry.find('\n', begin);
+    if (begin == std::string_view::npos || end == std::string_view::npos) return {};
+    return entry.substr(begin, end - begin);
+}
+
+// Text between open and close after from, from is moved past close
+std::string_view GetEnclosed(std::string_view entry, std::size_t& from, std::string_view open, std::string_view close)
+{
+    std::size_t begin = entry.find(open, from);
+    if (begin == std::string_view::npos) return {};
+    begin += open.size();
+    std::size_t end = entry.find(close, begin);
+    if (end == std::string_view::npos) return {};
+    from = end + close.size();
+    return entry.substr(begin, end - begin);
+}
+
+bool Matches(std::string_view entry, EntryLayout layout, const Query& query)
+{
+    std::string_view time;
+    std::string_view level_name;
+    std::string_view name;
+    std::int64_t seconds = 0;
+    if (layout == EntryLayout::kLine)
+    {
+        std::size_t position = 0;
+        time = GetEnclosed(entry, position, "[", "] ");
+        name = GetEnclosed(entry, position, "[", "] ");
+        level_name = GetEnclosed(entry, position, "|", "|");
+        seconds = ParseLocalTime(time, "%d.%m.%Y %S:%M:%H");
+    }
+    else
+    {
+        seconds = ParseLocalTime(GetField(entry, "\nTime:"));
+        level_name = GetField(entry, "\nLevel:");
+        name = GetField(entry, "\nName:");
+    }
+    if (seconds < ToSeconds(query.from) || seconds > ToSeconds(query.to)) return false;
+    LogLevel level;
+    try
+    {
+        level = ParseLevel(level_name);
+    }
+    catch (const std::invalid_argument&)
+    {
+        return false;
+    }
+    if (level < query.level) return false;
+    return query.logger.empty() || name == query.logger;
+}
+
+// Entries start with the separator line, or with the bracketed time of a
+// legacy line. Blocks may begin mid-entry.
+std::size_t FindEntry(std::string_view text, std::size_t from, EntryLayout layout)
+{
+    if (layout == EntryLayout::kLine)
+    {
+        for (std::size_t position = from; position < text.size(); ++position)
+        {
+            if (position != 0 && text[position - 1] != '\n')
+            {
+                position = text.find('\n', position);
+                if (position == std::string_view::npos) break;
+                continue;
+            }
+            if (text[position] == '[' && position + 1 < text.size() && std::isdigit(static_cast<unsigned char>(text[position + 1]))) return position;
+        }
+        return std::string_view::npos;
+    }
+    for (std::size_t position = text.find(kSeparator, from); position != std::string_view::npos; position = text.find(kSeparator, position + 1))
+    {
+        if (position == 0 || text[position - 1] == '\n') return position;
+    }
+    return std::string_view::npos;
+}
+
+// Prints the complete entries in pending and keeps the last, open one
+void Emit(std::string& pending, bool complete, EntryLayout layout, const Query& query, std::ostream& output, Stats& stats)
+{
+    std::size_t begin = FindEntry(pending, 0, layout);
+    while (begin != std::string::npos)
+    {
+        std::size_t end = FindEntry(pending, begin + 1, layout);
+        if (end == std::string::npos && !complete) break;
+        std::string_view entry = std::string_view{pending}.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        if (Matches(entry, layout, query))
+        {
+            output << entry;
+            ++stats.entries;
+        }
+        begin = end;
+    }
+    pending.erase(0, begin == std::string::npos ? pending.size() : begin);
+}
+
+// Reads runs of selected blocks, the entry open at the end of a run is
+// completed from the following blocks
+void Run(LogSource& source, const Query& query, std::ostream& output, Stats& stats)
+{
+    const std::vector<logging::TimeMark>& blocks = source.GetBlocks();
+    EntryLayout layout = source.GetLayout();
+    stats.blocks = blocks.size();
+    std::string pending;
+    std::string chunk;
+    bool open = false;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        bool selected = MayMatch(blocks[i], query);
+        if (!selected && !open) continue;
+        source.Read(i, chunk);
+        ++stats.blocks_read;
+        stats.bytes_read += chunk.size();
+        if (selected && !open)
+        {
+            std::size_t begin = FindEntry(chunk, 0, layout);
+            if (begin == std::string::npos) continue;
+            pending.assign(chunk, begin);
+            open = true;
+        }
+        else if (selected) pending += chunk;
+        else
+        {
+            std::size_t end = FindEntry(chunk, 0, layout);
+            pending.append(chunk, 0, end);
+            if (end == std::string::npos) continue;
+            open = false;
+        }
+        Emit(pending, !open, layout, query, output, stats);
+    }
+    Emit(pending, true, layout, query, output, stats);
+}
+
+}
+
+//----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    std::string input_path;
+    std::string output_path;
+    Query query;
+    bool print_stats = false;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string_view argument{argv[i]};
+            if (argument == "-o" && i + 1 < argc) output_path = argv[++i];
+            else if (argument == "--from" && i + 1 < argc) query.from = ParseTime(argv[++i], false);
+            else if (argument == "--to" && i + 1 < argc) query.to = ParseTime(argv[++i], true);
+            else if (argument == "--level" && i + 1 < argc) query.level = ParseLevel(argv[++i]);
+            else if (argument == "--logger" && i + 1 < argc) query.logger = argv[++i];
+            else if (argument == "--stats") print_stats = true;
+            else if (input_path.empty()) input_path = argument;
+            else throw std::invalid_argument{"unexpected argument"};
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        std::cerr << "usage: " << argv[0] << kUsage;
+        return 2;
+    }
+    if (input_path.empty())
+    {
+        std::cerr << "usage: " << argv[0] << kUsage;
+        return 2;
+    }
+
+    try
+    {
+        auto start = std::chrono::steady_clock::now();
+        LogSource source{input_path};
+        std::ofstream file;
+        if (!output_path.empty())
+        {
+            file.open(output_path, std::ios::app | std::ios::binary);
+            if (!file)
+            {
+                std::cerr << "failed to open " << output_path << '\n';
+                return 1;
+            }
+        }
+        std::ostream& output = output_path.empty() ? std::cout : file;
+        Stats stats;
+        Run(source, query, output, stats);
+        output.flush();
+        if (print_stats)
+        {
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+            std::cerr << "entries: " << stats.entries << ", blocks read: " << stats.blocks_read << '/' << stats.blocks
+                      << ", bytes read: " << stats.bytes_read << ", elapsed: " << elapsed.count() << " ms\n";
+        }
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Decompresses log segments written with SinkConfig::compress_rotated,
+// either whole or only the blocks overlapping a time range.
+//
+// usage: ruthenium-logunpack <compressed log> [--from <ns>] [--to <ns>] [--index] [-o <output file>]
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "logging/compression.h"
+
+namespace
+{
+
+using namespace ruthen;
+
+constexpr std::string_view kUsage = " <compressed log> [--from <ns>] [--to <ns>] [--index] [-o <output file>]\n";
+
+void PrintIndex(const logging::CompressedLogReader& reader, std::ostream& output)
+{
+    for (const logging::CompressedBlock& block : reader.GetBlocks())
+    {
+        output << block.offset << ' ' << block.raw_size << ' ' << block.stored_size << ' '
+               << block.first_timestamp << ' ' << block.last_timestamp << '\n';
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::string input_path;
+    std::string output_path;
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    bool index = false;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string_view argument{argv[i]};
+            if (argument == "-o" && i + 1 < argc) output_path = argv[++i];
+            else if (argument == "--from" && i + 1 < argc) from = std::stoll(argv[++i]);
+            else if (argument == "--to" && i + 1 < argc) to = std::stoll(argv[++i]);
+            else if (argument == "--index") index = true;
+            else if (input_path.empty()) input_path = argument;
+            else throw std::invalid_argument{"unexpected argument"};
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        std::cerr << "usage: " << argv[0] << kUsage;
+        return 2;
+    }
+    if (input_path.empty())
+    {
+        std::cerr << "usage: " << argv[0] << kUsage;
+        return 2;
+    }
+
+    try
+    {
+        logging::CompressedLogReader reader{input_path};
+        std::ofstream file;
+        if (!output_path.empty())
+        {
+            file.open(output_path, std::ios::app | std::ios::binary);
+            if (!file)
+            {
+                std::cerr << "failed to open " << output_path << '\n';
+                return 1;
+            }
+        }
+        std::ostream& output = output_path.empty() ? std::cout : file;
+        if (index)
+        {
+            PrintIndex(reader, output);
+            return 0;
+        }
+        std::string text;
+        reader.ReadRange(from, to, text);
+        output << text;
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+    return 0;
+}